@@ -0,0 +1,400 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Coexistence benchmark of FTM ranging and saturated data traffic.
+ * Based on the "ftm-example.cc" scenario.
+ *
+ * The AP sends --dataFlows downlink flows of UDP (OnOff application with a constant --dataRate) or TCP (BulkSend)
+ * to the stations, round robin, while every station runs FTM sessions with the AP back to back. The scenario is
+ * run twice, first with the data traffic only as baseline and then with FTM in addition (--compare=0 only runs
+ * the second one). The traffic starts at 0.5 s, throughput and ranging are measured from 1 s to --duration.
+ * One CSV line is printed per run:
+ *
+ *   mode,protocol,flows,data_rate,stations,throughput_mbps,throughput_loss,sessions_completed,measurements,
+ *   valid_ratio,mean_session_ms,ftm_airtime_ms
+ *
+ * mode is "data" for the baseline and "data+ftm" otherwise. throughput_loss is the relative throughput loss
+ * against the baseline, 0 without one. measurements are the RTTs of the completed sessions, valid_ratio
+ * the dialogs with an RTT per dialog, mean_session_ms the time from SessionBegin to the session over
+ * callback and ftm_airtime_ms the channel time of all sent FTM frames and their ACKs.
+ *
+ * Example:
+ *   for rate in 1Mbps 5Mbps 20Mbps 100Mbps; do
+ *     ./waf --run "ftm-coexistence --numberOfStations=8 --dataFlows=4 --protocol=udp --dataRate=$rate";
+ *   done
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/config.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/pointer.h"
+#include "ns3/log.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/ipv4-interface.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/arp-cache.h"
+#include "ns3/object-vector.h"
+#include "ns3/node-list.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/on-off-helper.h"
+#include "ns3/bulk-send-helper.h"
+#include "ns3/packet-sink-helper.h"
+#include "ns3/packet-sink.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/ftm-header.h"
+#include "ns3/ftm-manager.h"
+#include "ns3/ftm-error-model.h"
+#include "ns3/wifi-mac-helper.h"
+#include "ns3/wifi-helper.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <math.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FtmCoexistence");
+
+int numberOfStations = 8;
+int dataFlows = 4;
+std::string protocol = "udp";
+std::string dataRate = "100Mbps";
+uint32_t packetSize = 1472;
+double distance = 5;
+double duration = 10;
+int channelBandwidth = 20;
+bool compare = true;
+
+//FTM params, same as ftm-passive-ranging
+int numberOfBurstsExponent = 1; //2 bursts
+int burstDuration = 7; //8 ms
+int minDeltaFtm = 10; //1 ms between frames
+int ftmsPerBurst = 2;
+int burstPeriod = 1; //100 ms between burst periods
+
+static const double MEASURE_START = 1; //[s]
+
+struct RunResult
+{
+  double throughput_mbps = 0;
+  uint64_t sessions_completed = 0;
+  uint64_t measurements = 0;
+  double valid_ratio = 0;
+  double mean_session_ms = 0;
+  double ftm_airtime_ms = 0;
+};
+
+std::vector<Ptr<WifiNetDevice>> wifi_stations;
+std::vector<Time> session_start;
+Address recvAddr;
+RunResult result;
+Time session_time_sum;
+bool measuring = false;
+
+// --- Populate ARP cache ---
+static void
+PopulateARPcache ()
+{
+  Ptr<ArpCache> arp = CreateObject<ArpCache> ();
+  arp->SetAliveTimeout (Seconds (3600 * 24 * 365));
+
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      Ptr<Ipv4L3Protocol> ip = (*i)->GetObject<Ipv4L3Protocol> ();
+      NS_ASSERT (ip != 0);
+      ObjectVectorValue interfaces;
+      ip->GetAttribute ("InterfaceList", interfaces);
+
+      for (ObjectVectorValue::Iterator j = interfaces.Begin (); j != interfaces.End (); j++)
+        {
+          Ptr<Ipv4Interface> ipIface = (*j).second->GetObject<Ipv4Interface> ();
+          NS_ASSERT (ipIface != 0);
+          Ptr<NetDevice> device = ipIface->GetDevice ();
+          NS_ASSERT (device != 0);
+          Mac48Address addr = Mac48Address::ConvertFrom (device->GetAddress ());
+
+          for (uint32_t k = 0; k < ipIface->GetNAddresses (); k++)
+            {
+              Ipv4Address ipAddr = ipIface->GetAddress (k).GetLocal ();
+              if (ipAddr == Ipv4Address::GetLoopback ())
+                continue;
+
+              ArpCache::Entry *entry = arp->Add (ipAddr);
+              Ipv4Header ipv4Hdr;
+              ipv4Hdr.SetDestination (ipAddr);
+              Ptr<Packet> p = Create<Packet> (100);
+              entry->MarkWaitReply (ArpCache::Ipv4PayloadHeaderPair (p, ipv4Hdr));
+              entry->MarkAlive (addr);
+            }
+        }
+    }
+
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      Ptr<Ipv4L3Protocol> ip = (*i)->GetObject<Ipv4L3Protocol> ();
+      NS_ASSERT (ip != 0);
+      ObjectVectorValue interfaces;
+      ip->GetAttribute ("InterfaceList", interfaces);
+
+      for (ObjectVectorValue::Iterator j = interfaces.Begin (); j != interfaces.End (); j++)
+        {
+          Ptr<Ipv4Interface> ipIface = (*j).second->GetObject<Ipv4Interface> ();
+          ipIface->SetAttribute ("ArpCache", PointerValue (arp));
+        }
+    }
+}
+
+void StartSession (uint32_t sta_index);
+
+void SessionOver (uint32_t sta_index, FtmSession session)
+{
+  if (measuring)
+    {
+      result.sessions_completed++;
+      result.measurements += session.GetIndividualRTT ().size ();
+      session_time_sum += Simulator::Now () - session_start[sta_index];
+    }
+  //session is removed from the manager after this callback, so start the next one a bit later
+  Simulator::Schedule (MilliSeconds (1), &StartSession, sta_index);
+}
+
+void StartSession (uint32_t sta_index)
+{
+  Ptr<RegularWifiMac> sta_mac = wifi_stations[sta_index]->GetMac ()->GetObject<RegularWifiMac> ();
+  Ptr<FtmSession> session = sta_mac->NewFtmSession (Mac48Address::ConvertFrom (recvAddr));
+  if (session == 0)
+    {
+      //partner blocked or session still open, try again later
+      Simulator::Schedule (MilliSeconds (10), &StartSession, sta_index);
+      return;
+    }
+
+  Ptr<WiredFtmErrorModel> error_model = CreateObject<WiredFtmErrorModel> (sta_index + 1);
+  error_model->SetChannelBandwidth (channelBandwidth == 40 ? WiredFtmErrorModel::Channel_40_MHz
+                                                           : WiredFtmErrorModel::Channel_20_MHz);
+  session->SetFtmErrorModel (error_model);
+
+  FtmParams ftm_params;
+  ftm_params.SetStatusIndication (FtmParams::RESERVED);
+  ftm_params.SetNumberOfBurstsExponent (numberOfBurstsExponent);
+  ftm_params.SetBurstDuration (burstDuration);
+  ftm_params.SetMinDeltaFtm (minDeltaFtm);
+  ftm_params.SetPartialTsfNoPref (true);
+  ftm_params.SetAsap (true);
+  ftm_params.SetFtmsPerBurst (ftmsPerBurst);
+  ftm_params.SetBurstPeriod (burstPeriod);
+  session->SetFtmParams (ftm_params);
+
+  session->SetSessionOverCallback (MakeBoundCallback (&SessionOver, sta_index));
+  session_start[sta_index] = Simulator::Now ();
+  session->SessionBegin ();
+}
+
+/*
+ * the received bytes of all sinks
+ */
+static uint64_t
+TotalRx (const ApplicationContainer &sinks)
+{
+  uint64_t bytes = 0;
+  for (uint32_t i = 0; i < sinks.GetN (); i++)
+    {
+      bytes += DynamicCast<PacketSink> (sinks.Get (i))->GetTotalRx ();
+    }
+  return bytes;
+}
+
+static void
+StartMeasurement (const ApplicationContainer &sinks, uint64_t *rx_start)
+{
+  *rx_start = TotalRx (sinks);
+  measuring = true;
+}
+
+static RunResult
+RunScenario (bool ftm)
+{
+  result = RunResult ();
+  session_time_sum = Time ();
+  measuring = false;
+  wifi_stations.clear ();
+  session_start.assign (numberOfStations, Time ());
+
+  Config::SetDefault ("ns3::RegularWifiMac::FTM_Enabled", BooleanValue (true));
+
+  NodeContainer c;
+  c.Create (numberOfStations + 1); // 1 for the AP
+
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211n_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager");
+
+  YansWifiPhyHelper wifiPhy;
+  wifiPhy.Set ("RxGain", DoubleValue (0));
+
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::ThreeGppIndoorOfficePropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+
+  WifiMacHelper wifiMac;
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, c);
+
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0.0, 0.0, 0.0));
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      double angle = 2 * M_PI * i / numberOfStations;
+      positionAlloc->Add (Vector (distance * cos (angle), distance * sin (angle), 0));
+    }
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (c);
+
+  InternetStackHelper stack;
+  stack.Install (c);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.0.0", "255.255.0.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+  PopulateARPcache ();
+
+  //downlink flows from the AP, round robin over the stations
+  uint16_t port = 9;
+  std::string socket_factory = protocol == "tcp" ? "ns3::TcpSocketFactory" : "ns3::UdpSocketFactory";
+  ApplicationContainer sources;
+  ApplicationContainer sinks;
+  for (int flow = 0; flow < dataFlows && numberOfStations > 0; flow++)
+    {
+      uint32_t sta_node = flow % numberOfStations + 1;
+      InetSocketAddress sink_addr (interfaces.GetAddress (sta_node), port + flow);
+      if (protocol == "tcp")
+        {
+          BulkSendHelper source (socket_factory, sink_addr);
+          source.SetAttribute ("MaxBytes", UintegerValue (0));
+          source.SetAttribute ("SendSize", UintegerValue (packetSize));
+          sources.Add (source.Install (c.Get (0)));
+        }
+      else
+        {
+          OnOffHelper source (socket_factory, sink_addr);
+          source.SetConstantRate (DataRate (dataRate), packetSize);
+          sources.Add (source.Install (c.Get (0)));
+        }
+      PacketSinkHelper sink (socket_factory, InetSocketAddress (Ipv4Address::GetAny (), port + flow));
+      sinks.Add (sink.Install (c.Get (sta_node)));
+    }
+  sinks.Start (Seconds (0));
+  sources.Start (Seconds (0.5));
+  sources.Stop (Seconds (duration));
+
+  Ptr<WifiNetDevice> wifi_ap = devices.Get (0)->GetObject<WifiNetDevice> ();
+  recvAddr = wifi_ap->GetAddress ();
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      wifi_stations.push_back (devices.Get (i + 1)->GetObject<WifiNetDevice> ());
+      if (ftm)
+        {
+          //the stations start within 100 ms, so they do not all collide in the first slot
+          Simulator::Schedule (Seconds (MEASURE_START) + MicroSeconds (100000 * i / numberOfStations),
+                               &StartSession, i);
+        }
+    }
+
+  uint64_t rx_start = 0;
+  Simulator::Schedule (Seconds (MEASURE_START), &StartMeasurement, sinks, &rx_start);
+
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+
+  result.throughput_mbps = (TotalRx (sinks) - rx_start) * 8 / (duration - MEASURE_START) / 1e6;
+  //the dialogs of the stations, as the AP creates a dialog for every FTM frame too
+  FtmMetrics station_metrics;
+  for (Ptr<WifiNetDevice> sta : wifi_stations)
+    {
+      station_metrics.Merge (FtmManager::GetFtmManager (sta->GetPhy ())->GetMetrics ());
+    }
+  FtmAirtime airtime = station_metrics.airtime;
+  airtime.Merge (FtmManager::GetFtmManager (wifi_ap->GetPhy ())->GetMetrics ().airtime);
+  result.valid_ratio = station_metrics.dialogs_created > 0
+      ? (double) station_metrics.rtts_calculated / station_metrics.dialogs_created : 0;
+  result.ftm_airtime_ms = (airtime.tx_requests + airtime.tx_responses + airtime.tx_acks).GetSeconds () * 1000;
+  if (result.sessions_completed > 0)
+    {
+      result.mean_session_ms = session_time_sum.GetSeconds () * 1000 / result.sessions_completed;
+    }
+  Simulator::Destroy ();
+  return result;
+}
+
+static void
+PrintResult (std::string mode, const RunResult &run, double baseline_mbps)
+{
+  double loss = baseline_mbps > 0 ? 1 - run.throughput_mbps / baseline_mbps : 0;
+  std::cout << mode << "," << protocol << "," << dataFlows << "," << dataRate << "," << numberOfStations << ","
+            << run.throughput_mbps << "," << loss << "," << run.sessions_completed << "," << run.measurements << ","
+            << run.valid_ratio << "," << run.mean_session_ms << "," << run.ftm_airtime_ms << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("numberOfStations", "Number of stations, all of them range with the AP", numberOfStations);
+  cmd.AddValue ("dataFlows", "Number of saturated downlink flows", dataFlows);
+  cmd.AddValue ("protocol", "udp or tcp", protocol);
+  cmd.AddValue ("dataRate", "Offered load of every UDP flow", dataRate);
+  cmd.AddValue ("packetSize", "Payload size of the data packets [bytes]", packetSize);
+  cmd.AddValue ("distance", "Distance of the stations to the AP [m]", distance);
+  cmd.AddValue ("duration", "Simulated time [s]", duration);
+  cmd.AddValue ("channelBandwidth", "20 or 40 MHz", channelBandwidth);
+  cmd.AddValue ("compare", "Run the data only baseline first", compare);
+  cmd.AddValue ("numberOfBurstsExponent", "1 - 8", numberOfBurstsExponent);
+  cmd.AddValue ("burstDuration", "2 - 11", burstDuration);
+  cmd.AddValue ("minDeltaFtm", "1 - ...", minDeltaFtm);
+  cmd.AddValue ("ftmsPerBurst", "1 - ...", ftmsPerBurst);
+  cmd.AddValue ("burstPeriod", "1 - ...", burstPeriod);
+  cmd.Parse (argc, argv);
+
+  if (protocol != "udp" && protocol != "tcp")
+    {
+      NS_FATAL_ERROR ("unknown protocol " << protocol << ", use udp or tcp");
+    }
+
+  //set time resolution to pico seconds for the time stamps, as default is in nano seconds. IMPORTANT, once for both runs
+  Time::SetResolution (Time::PS);
+
+  double baseline_mbps = 0;
+  if (compare)
+    {
+      RunResult baseline = RunScenario (false);
+      baseline_mbps = baseline.throughput_mbps;
+      PrintResult ("data", baseline, 0);
+    }
+  PrintResult ("data+ftm", RunScenario (true), baseline_mbps);
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Memory check for the FTM error models.
+ *
+ * Creates many WirelessSigStrFtmErrorModel instances, as ftm-ranging.cc and ftm-localization.cc do with
+ * one model per session, and counts the heap bytes they allocate through a replaced global operator new.
+ * The program fails with exit code 1 if one instance needs more than --maxBytes bytes, so it can be used
+ * as a regression check. The result is printed as one CSV line:
+ *
+ *   instances,sizeof_bytes,heap_bytes_per_instance,construction_ns_per_instance,passed
+ *
+ * Example:
+ *   ./waf --run "ftm-error-model-memory --instances=10000 --maxBytes=512"
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/ftm-error-model.h"
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+using namespace ns3;
+
+static uint64_t g_allocated_bytes = 0;
+
+void *
+operator new (std::size_t size)
+{
+  g_allocated_bytes += size;
+  void *ptr = std::malloc (size == 0 ? 1 : size);
+  if (ptr == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return ptr;
+}
+
+void
+operator delete (void *ptr) noexcept
+{
+  std::free (ptr);
+}
+
+void
+operator delete (void *ptr, std::size_t) noexcept
+{
+  std::free (ptr);
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t instances = 10000;
+  uint64_t maxBytes = 512;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("instances", "Number of error models to create", instances);
+  cmd.AddValue ("maxBytes", "Maximum heap bytes allowed per instance", maxBytes);
+  cmd.Parse (argc, argv);
+
+  //create one model first, so the TypeId and other one time allocations are not counted
+  Ptr<WirelessSigStrFtmErrorModel> warm_up = CreateObject<WirelessSigStrFtmErrorModel> (1);
+  warm_up->GetFtmError (-60);
+
+  std::vector<Ptr<WirelessSigStrFtmErrorModel>> models;
+  models.reserve (instances);
+  uint64_t bytes_start = g_allocated_bytes;
+  auto wall_start = std::chrono::steady_clock::now ();
+  for (uint32_t i = 0; i < instances; i++)
+    {
+      models.push_back (CreateObject<WirelessSigStrFtmErrorModel> (i));
+    }
+  auto wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now () - wall_start).count ();
+  uint64_t bytes_per_instance = instances > 0 ? (g_allocated_bytes - bytes_start) / instances : 0;
+
+  //draw from every model once, the lookup must not allocate per instance state either
+  bytes_start = g_allocated_bytes;
+  for (uint32_t i = 0; i < instances; i++)
+    {
+      models[i]->GetFtmError (-34 - (int) (i % 50));
+    }
+  uint64_t draw_bytes = g_allocated_bytes - bytes_start;
+
+  bool passed = bytes_per_instance <= maxBytes && draw_bytes == 0;
+  std::cout << instances << "," << sizeof (WirelessSigStrFtmErrorModel) << "," << bytes_per_instance << ","
+            << (instances > 0 ? wall_ns / instances : 0) << "," << passed << std::endl;
+  if (!passed)
+    {
+      std::cerr << "FTM error model memory check failed: " << bytes_per_instance << " bytes per instance (max "
+                << maxBytes << "), " << draw_bytes << " bytes allocated while drawing errors" << std::endl;
+      return 1;
+    }
+  return 0;
+}
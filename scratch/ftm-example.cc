@@ -53,6 +53,8 @@
 #include "ns3/ftm-header.h"
 #include "ns3/mgt-headers.h"
 #include "ns3/ftm-error-model.h"
+#include "ns3/ftm-cached-propagation-loss-model.h"
+#include "ns3/three-gpp-propagation-loss-model.h"
 #include "ns3/pointer.h"
 #include "ns3/wifi-mac-helper.h"
 #include "ns3/wifi-helper.h"
@@ -148,6 +150,7 @@ int frequency = 1;
 int numberOfStations = 1;
 int rxGain = 0;
 int propagationLossModel = 0;
+bool cachePropagationLoss = true;
 int channelBandwidth = 20;
 int distance = 5;
 
@@ -166,6 +169,8 @@ void SessionOver (FtmSession session)
   std::cout << "\nMean RTT [ps]: " << session.GetMeanRTT() << std::endl;
   std::cout << "Mean Signal Strength [dBm]: " << session.GetMeanSignalStrength () << std::endl;
   std::cout << "Number of Measurements: " << session.GetIndividualRTT().size() << std::endl;
+  std::cout << "FTM Airtime [us]: " << session.GetAirtime().GetTotal().GetMicroSeconds() << std::endl;
+  std::cout << "Burst Idle Time [us]: " << session.GetAirtime().burst_idle.GetMicroSeconds() << std::endl;
 }
 
 Ptr<WirelessFtmErrorModel::FtmMap> map;
@@ -261,6 +266,7 @@ int main (int argc, char *argv[])
   cmd.AddValue ("frequency", "2.4 (0) or 5 (1) GHz", frequency);
   cmd.AddValue ("rxGain", "(0) - no gain, (1) - add gain", rxGain);
   cmd.AddValue ("propagationLossModel", "ThreeGpp (0) or Nakagami (1)", propagationLossModel);
+  cmd.AddValue ("cachePropagationLoss", "Calculate the ThreeGpp loss once per link (1) or for every frame (0)", cachePropagationLoss);
   cmd.AddValue ("numberOfStations", "1 - ...", numberOfStations);
   cmd.AddValue ("channelBandwidth", "20 / 40 / 80 / 160 MHz", channelBandwidth);
   cmd.AddValue ("distance", "0 - ... m", distance);
@@ -298,7 +304,12 @@ int main (int argc, char *argv[])
   //wifiChannel.AddPropagationLoss ("ns3::FixedRssLossModel","Rss",DoubleValue (rss));
 
   if(!propagationLossModel){
-  	wifiChannel.AddPropagationLoss ("ns3::ThreeGppIndoorOfficePropagationLossModel");
+    //all nodes are static, so the loss of a link does not change and is only calculated once
+    if (cachePropagationLoss)
+      wifiChannel.AddPropagationLoss ("ns3::FtmCachedPropagationLossModel",
+                                      "Model", PointerValue (CreateObject<ThreeGppIndoorOfficePropagationLossModel> ()));
+    else
+      wifiChannel.AddPropagationLoss ("ns3::ThreeGppIndoorOfficePropagationLossModel");
     std::cout << "Propagation Loss Model: ThreeGppIndoorOffice" << std::endl;
   } else{ 
 	  wifiChannel.AddPropagationLoss ("ns3::NakagamiPropagationLossModel");
@@ -0,0 +1,140 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Process pool shared by the FTM scratch programs that simulate independent jobs in forked children,
+ * e.g. the positions of ftm-ranging and ftm-localization or the replication points of
+ * ftm-replication-server. Only the .cc files of the scratch directory are built as programs, this
+ * header is included by them.
+ */
+
+#ifndef FTM_FORK_POOL_H_
+#define FTM_FORK_POOL_H_
+
+#include "ns3/callback.h"
+#include "ns3/fatal-error.h"
+
+#include <map>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <unistd.h>
+#include <sys/wait.h>
+
+namespace ns3 {
+
+/**
+ * Runs a job in the child. Gets the job index and the write end of a pipe to the parent and returns the
+ * exit status of the child.
+ */
+typedef Callback<int, std::size_t, int> FtmForkJob;
+
+/**
+ * Called in the parent for every reaped child. Gets the job index, the read end of the pipe, whether the
+ * child exited with 0 and the wall time from the fork until the child was reaped [ms]. Returns false if
+ * the job failed.
+ */
+typedef Callback<bool, std::size_t, int, bool, double> FtmForkJobDone;
+
+/**
+ * Runs the jobs [0, jobs) in forked children, at most workers at the same time. Every child starts from a
+ * copy-on-write image of the parent, so everything built before the call is shared by all jobs. The
+ * child exits with the return value of run_job and never returns from this function. Both ends of the
+ * pipe of a job are closed by the pool.
+ *
+ * \param jobs the number of jobs
+ * \param job_name the name of a job in the message of a failed job, e.g. "position"
+ * \param workers the number of children running at the same time, at least one
+ * \param run_job runs one job in the child
+ * \param job_done collects the result of a job in the parent, may be null
+ * \return true if every child exited with 0 and job_done accepted every job
+ */
+inline bool
+RunFtmForkPool (std::size_t jobs, const std::string &job_name, int workers, FtmForkJob run_job,
+                FtmForkJobDone job_done)
+{
+  /// A running child.
+  struct Child
+  {
+    std::size_t job; //!< the job index
+    int fd; //!< the read end of the pipe
+    std::chrono::steady_clock::time_point start; //!< the time of the fork
+  };
+
+  std::map<pid_t, Child> running;
+  std::size_t next = 0;
+  bool succeeded = true;
+  while (next < jobs || !running.empty ())
+    {
+      while (next < jobs && running.size () < static_cast<std::size_t> (std::max (workers, 1)))
+        {
+          int fds[2];
+          if (pipe (fds) != 0)
+            {
+              NS_FATAL_ERROR ("pipe failed");
+            }
+          //flush before forking, otherwise buffered output would be written by every child
+          std::cout.flush ();
+          std::cerr.flush ();
+          auto start = std::chrono::steady_clock::now ();
+          pid_t pid = fork ();
+          if (pid < 0)
+            {
+              NS_FATAL_ERROR ("fork failed");
+            }
+          if (pid == 0)
+            {
+              close (fds[0]);
+              int status = run_job (next, fds[1]);
+              close (fds[1]);
+              //skip the destructors of the parent's objects, the parent still owns them
+              _exit (status);
+            }
+          close (fds[1]);
+          running[pid] = {next, fds[0], start};
+          next++;
+        }
+
+      int status;
+      pid_t pid = waitpid (-1, &status, 0);
+      auto it = running.find (pid);
+      if (it == running.end ())
+        {
+          continue;
+        }
+      Child child = it->second;
+      running.erase (it);
+      double wall_ms = std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now ()
+                                                                  - child.start).count ();
+      bool job_succeeded = WIFEXITED (status) && WEXITSTATUS (status) == 0;
+      if (!job_done.IsNull ())
+        {
+          job_succeeded = job_done (child.job, child.fd, job_succeeded, wall_ms) && job_succeeded;
+        }
+      close (child.fd);
+      if (!job_succeeded)
+        {
+          std::cerr << job_name << " " << child.job << " failed" << std::endl;
+          succeeded = false;
+        }
+    }
+  return succeeded;
+}
+
+} /* namespace ns3 */
+
+#endif /* FTM_FORK_POOL_H_ */
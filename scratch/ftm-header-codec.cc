@@ -0,0 +1,228 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Round trip fuzz test and throughput benchmark for the FtmResponseHeader and FtmParams codec.
+ *
+ * The fuzz test runs two kinds of cases:
+ *  - random field values are serialized, compared byte by byte with a reference encoder that writes
+ *    the fields one byte at a time (the previous implementation) and deserialized again,
+ *  - random bytes are deserialized and serialized again, which has to give the same bytes except for
+ *    the reserved bits of the FTM parameters.
+ * Afterwards a response header with FTM parameters (29 bytes) is serialized and deserialized
+ * --iterations times. One CSV line is printed and the program returns 1 if any fuzz case failed:
+ *
+ *   fuzz_cases,fuzz_failures,iterations,serialize_ns,deserialize_ns,passed
+ *
+ * Example:
+ *   ./waf --run "ftm-header-codec --fuzzCases=1000000 --iterations=10000000"
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/buffer.h"
+#include "ns3/ftm-header.h"
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <algorithm>
+
+using namespace ns3;
+
+uint32_t fuzzCases = 100000;
+uint32_t iterations = 1000000;
+uint32_t seed = 1;
+
+static const uint32_t BODY_SIZE = 18;
+static const uint32_t PARAMS_SIZE = 11;
+static const uint32_t SIZE = BODY_SIZE + PARAMS_SIZE;
+
+/*
+ * Encoder that moves every field one byte at a time, the time stamps are in host byte order.
+ */
+static void
+ReferenceSerialize (FtmResponseHeader header, uint8_t *out)
+{
+  union {
+    uint32_t i;
+    char c[4];
+  } bint = {0x01020304};
+  bool big_endian = bint.c[0] == 1;
+
+  out[0] = header.GetDialogToken ();
+  out[1] = header.GetFollowUpDialogToken ();
+  for (int i = 0; i < 6; i++)
+    {
+      int shift = big_endian ? 40 - 8 * i : 8 * i;
+      out[2 + i] = (header.GetTimeOfDeparture () >> shift) & 0xFF;
+      out[8 + i] = (header.GetTimeOfArrival () >> shift) & 0xFF;
+    }
+  out[14] = header.GetTimeOfDepartureError () >> 8;
+  out[15] = header.GetTimeOfDepartureError () & 0xFF;
+  out[16] = header.GetTimeOfArrivalError () >> 8;
+  out[17] = header.GetTimeOfArrivalError () & 0xFF;
+
+  FtmParams params = header.GetFtmParams ();
+  uint8_t *p = out + BODY_SIZE;
+  p[0] = 206;
+  p[1] = 9;
+  p[2] = (params.GetStatusIndication () & 0x03) | ((params.GetStatusIndicationValue () & 0x1F) << 2);
+  p[3] = (params.GetNumberOfBurstsExponent () & 0x0F) | (params.GetBurstDuration () << 4);
+  p[4] = params.GetMinDeltaFtm ();
+  p[5] = params.GetPartialTsfTimer () >> 8;
+  p[6] = params.GetPartialTsfTimer () & 0xFF;
+  p[7] = params.GetPartialTsfNoPref () | (params.GetAsapCapable () << 1) | (params.GetAsap () << 2)
+      | ((params.GetFtmsPerBurst () << 3) & 0xF8);
+  p[8] = params.GetFormatAndBandwidth () << 2;
+  p[9] = params.GetBurstPeriod () >> 8;
+  p[10] = params.GetBurstPeriod () & 0xFF;
+}
+
+static void
+SerializeToBytes (const FtmResponseHeader &header, uint8_t *out)
+{
+  Buffer buffer;
+  buffer.AddAtStart (header.GetSerializedSize ());
+  header.Serialize (buffer.Begin ());
+  buffer.CopyData (out, header.GetSerializedSize ());
+}
+
+static FtmResponseHeader
+DeserializeFromBytes (const uint8_t *in)
+{
+  Buffer buffer;
+  buffer.AddAtStart (SIZE);
+  buffer.Begin ().Write (in, SIZE);
+  FtmResponseHeader header;
+  header.Deserialize (buffer.Begin ());
+  return header;
+}
+
+static FtmResponseHeader
+RandomHeader (std::mt19937_64 &generator)
+{
+  FtmResponseHeader header;
+  header.SetDialogToken (generator ());
+  header.SetFollowUpDialogToken (generator ());
+  header.SetTimeOfDeparture (generator () & 0xFFFFFFFFFFFF);
+  header.SetTimeOfArrival (generator () & 0xFFFFFFFFFFFF);
+  header.SetTimeOfDepartureError (generator ());
+  header.SetTimeOfArrivalError (generator ());
+
+  FtmParams params;
+  params.SetStatusIndication (static_cast<FtmParams::StatusIndication> (generator () % 4));
+  params.SetStatusIndicationValue (generator () & 0x1F);
+  params.SetNumberOfBurstsExponent (generator () & 0x0F);
+  params.SetBurstDuration (generator () & 0x0F);
+  params.SetMinDeltaFtm (generator ());
+  params.SetPartialTsfTimer (generator ());
+  params.SetPartialTsfNoPref (generator () & 1);
+  params.SetAsapCapable (generator () & 1);
+  params.SetAsap (generator () & 1);
+  params.SetFtmsPerBurst (generator () & 0x1F);
+  params.SetFormatAndBandwidth (generator () & 0x3F);
+  params.SetBurstPeriod (generator ());
+  header.SetFtmParams (params);
+  return header;
+}
+
+static bool
+FieldValueCase (std::mt19937_64 &generator)
+{
+  FtmResponseHeader header = RandomHeader (generator);
+  uint8_t expected[SIZE];
+  uint8_t bytes[SIZE];
+  ReferenceSerialize (header, expected);
+  SerializeToBytes (header, bytes);
+  if (std::memcmp (expected, bytes, SIZE) != 0)
+    {
+      return false;
+    }
+
+  uint8_t again[SIZE];
+  SerializeToBytes (DeserializeFromBytes (bytes), again);
+  return std::memcmp (bytes, again, SIZE) == 0;
+}
+
+static bool
+RandomBytesCase (std::mt19937_64 &generator)
+{
+  uint8_t bytes[SIZE];
+  for (uint32_t i = 0; i < SIZE; i++)
+    {
+      bytes[i] = generator ();
+    }
+  bytes[BODY_SIZE] = 206;
+  bytes[BODY_SIZE + 1] = 9;
+
+  uint8_t again[SIZE];
+  SerializeToBytes (DeserializeFromBytes (bytes), again);
+  //bit 7 of the status byte and the lowest 2 bits of the format and bandwidth byte are reserved
+  bytes[BODY_SIZE + 2] &= 0x7F;
+  bytes[BODY_SIZE + 8] &= 0xFC;
+  return std::memcmp (bytes, again, SIZE) == 0;
+}
+
+int main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("fuzzCases", "Number of fuzz cases of each kind", fuzzCases);
+  cmd.AddValue ("iterations", "Number of serialize/deserialize calls to time", iterations);
+  cmd.AddValue ("seed", "Seed of the fuzz cases", seed);
+  cmd.Parse (argc, argv);
+
+  std::mt19937_64 generator (seed);
+  uint32_t failures = 0;
+  for (uint32_t i = 0; i < fuzzCases; i++)
+    {
+      failures += !FieldValueCase (generator);
+      failures += !RandomBytesCase (generator);
+    }
+
+  FtmResponseHeader header = RandomHeader (generator);
+  Buffer buffer;
+  buffer.AddAtStart (SIZE);
+
+  auto start = std::chrono::steady_clock::now ();
+  for (uint32_t i = 0; i < iterations; i++)
+    {
+      header.SetTimeOfDeparture (i);
+      header.Serialize (buffer.Begin ());
+    }
+  double serialize_ns = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - start).count ();
+
+  uint64_t checksum = 0;
+  start = std::chrono::steady_clock::now ();
+  for (uint32_t i = 0; i < iterations; i++)
+    {
+      FtmResponseHeader received;
+      received.Deserialize (buffer.Begin ());
+      checksum += received.GetTimeOfArrival ();
+    }
+  double deserialize_ns = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - start).count ();
+
+  if (checksum != iterations * header.GetTimeOfArrival ())
+    {
+      failures++;
+    }
+
+  std::cout << 2 * fuzzCases << "," << failures << "," << iterations << ","
+            << serialize_ns / std::max (iterations, 1u) << "," << deserialize_ns / std::max (iterations, 1u) << ","
+            << (failures == 0) << std::endl;
+
+  return failures == 0 ? 0 : 1;
+}
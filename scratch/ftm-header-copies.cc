@@ -0,0 +1,177 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Counts the copies of the FTM headers per FTM frame.
+ *
+ * Needs an instrumented build, the copy counters of FtmParams, FtmRequestHeader and FtmResponseHeader
+ * are only compiled in with NS3_FTM_COUNT_COPIES:
+ *
+ *   CXXFLAGS="-DNS3_FTM_COUNT_COPIES" ./waf configure --build-profile=optimized
+ *
+ * Every station runs FTM sessions with the AP back to back for --duration seconds. The FTM frames are
+ * the FTM requests and responses sent by all the FtmManagers. One CSV line is printed:
+ *
+ *   stations,ftm_frames,params_copies,request_copies,response_copies,params_per_frame,request_per_frame,response_per_frame
+ *
+ * A copy of a request or response header also copies its FtmParams, which is counted in params_copies as well.
+ *
+ * To compare with the tree before the headers were passed by const reference, check out the parent of that
+ * commit, copy src/wifi/model/ftm-copy-counter.h into it, include it from ftm-header.h and add the three
+ * m_copy_counter members of FtmParams, FtmRequestHeader and FtmResponseHeader. Run both trees with the same
+ * arguments, the columns are the same.
+ *
+ * Example:
+ *   ./waf --run "ftm-header-copies --numberOfStations=4"
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/config.h"
+#include "ns3/double.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/ftm-header.h"
+#include "ns3/ftm-manager.h"
+#include "ns3/ftm-error-model.h"
+#include "ns3/wifi-mac-helper.h"
+#include "ns3/wifi-helper.h"
+
+#include <iostream>
+#include <math.h>
+#include <algorithm>
+
+using namespace ns3;
+
+int numberOfStations = 1;
+double distance = 5;
+double duration = 10;
+
+std::vector<Ptr<WifiNetDevice>> wifi_stations;
+Address recvAddr;
+
+void StartSession (uint32_t sta_index);
+
+void SessionOver (uint32_t sta_index, FtmSession session)
+{
+  //session is removed from the manager after this callback, so start the next one a bit later
+  Simulator::Schedule (MilliSeconds (10), &StartSession, sta_index);
+}
+
+void StartSession (uint32_t sta_index)
+{
+  Ptr<RegularWifiMac> sta_mac = wifi_stations[sta_index]->GetMac ()->GetObject<RegularWifiMac> ();
+  Ptr<FtmSession> session = sta_mac->NewFtmSession (Mac48Address::ConvertFrom (recvAddr));
+  if (session == 0)
+    {
+      Simulator::Schedule (MilliSeconds (10), &StartSession, sta_index);
+      return;
+    }
+
+  FtmParams ftm_params;
+  ftm_params.SetStatusIndication (FtmParams::RESERVED);
+  ftm_params.SetNumberOfBurstsExponent (1); //2 bursts
+  ftm_params.SetBurstDuration (7); //8 ms burst duration
+  ftm_params.SetMinDeltaFtm (10); //1 ms between frames
+  ftm_params.SetPartialTsfNoPref (true);
+  ftm_params.SetAsap (true);
+  ftm_params.SetFtmsPerBurst (2);
+  ftm_params.SetBurstPeriod (1); //100 ms between burst periods
+  session->SetFtmParams (ftm_params);
+
+  session->SetSessionOverCallback (MakeBoundCallback (&SessionOver, sta_index));
+  session->SessionBegin ();
+}
+
+int main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("numberOfStations", "Number of initiating stations", numberOfStations);
+  cmd.AddValue ("distance", "Distance of the stations to the AP [m]", distance);
+  cmd.AddValue ("duration", "Simulated time [s]", duration);
+  cmd.Parse (argc, argv);
+
+#ifndef NS3_FTM_COUNT_COPIES
+  std::cerr << "ftm-header-copies needs a build with NS3_FTM_COUNT_COPIES defined" << std::endl;
+  return 1;
+#else
+  Config::SetDefault ("ns3::RegularWifiMac::FTM_Enabled", BooleanValue (true));
+
+  NodeContainer c;
+  c.Create (numberOfStations + 1); // 1 for the AP
+
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211n_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager");
+
+  YansWifiPhyHelper wifiPhy;
+  wifiPhy.Set ("RxGain", DoubleValue (0));
+
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::ThreeGppIndoorOfficePropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+
+  WifiMacHelper wifiMac;
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, c);
+
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0.0, 0.0, 0.0));
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      double angle = 2 * M_PI * i / numberOfStations;
+      positionAlloc->Add (Vector (distance * cos (angle), distance * sin (angle), 0));
+    }
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (c);
+
+  Ptr<WifiNetDevice> wifi_ap = devices.Get (0)->GetObject<WifiNetDevice> ();
+  recvAddr = wifi_ap->GetAddress ();
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      wifi_stations.push_back (devices.Get (i + 1)->GetObject<WifiNetDevice> ());
+      Simulator::Schedule (MilliSeconds (i), &StartSession, i);
+    }
+
+  //set time resolution to pico seconds for the time stamps, as default is in nano seconds. IMPORTANT
+  Time::SetResolution (Time::PS);
+
+  //only count the copies of the simulation, not of the setup
+  uint64_t params_start = FtmCopyCounter<FtmParams>::copies;
+  uint64_t request_start = FtmCopyCounter<FtmRequestHeader>::copies;
+  uint64_t response_start = FtmCopyCounter<FtmResponseHeader>::copies;
+
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+
+  uint64_t params_copies = FtmCopyCounter<FtmParams>::copies - params_start;
+  uint64_t request_copies = FtmCopyCounter<FtmRequestHeader>::copies - request_start;
+  uint64_t response_copies = FtmCopyCounter<FtmResponseHeader>::copies - response_start;
+  uint64_t ftm_frames = FtmManager::GetMergedMetrics ().tx_ftm_frames;
+  Simulator::Destroy ();
+
+  double frames = std::max<uint64_t> (ftm_frames, 1);
+  std::cout << numberOfStations << "," << ftm_frames << "," << params_copies << "," << request_copies << ","
+            << response_copies << "," << params_copies / frames << "," << request_copies / frames << ","
+            << response_copies / frames << std::endl;
+
+  return 0;
+#endif
+}
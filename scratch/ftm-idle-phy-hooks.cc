@@ -0,0 +1,178 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Benchmark for the per frame overhead of the FtmManager PHY trace hooks on stations without FTM sessions.
+ * Based on the "ftm-passive-ranging.cc" scenario.
+ *
+ * All stations send data frames to the AP, but only the first station runs FTM sessions with it. With
+ * --lazyHooks=1 the managers of the idle stations have no PHY hooks connected, with --lazyHooks=0 every
+ * manager inspects every frame. The frames inspected by all managers, the number of FTM measurements and
+ * the wall clock time are printed as one CSV line:
+ *
+ *   lazy_hooks,stations,duration_s,data_frames,rx_frames_inspected,tx_frames_inspected,measurements,wall_ms
+ *
+ * Example:
+ *   for lazy in 0 1; do ./waf --run "ftm-idle-phy-hooks --numberOfStations=64 --lazyHooks=$lazy"; done
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/config.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/ftm-header.h"
+#include "ns3/ftm-manager.h"
+#include "ns3/wifi-mac-helper.h"
+#include "ns3/wifi-helper.h"
+
+#include <iostream>
+#include <chrono>
+#include <math.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FtmIdlePhyHooks");
+
+int numberOfStations = 32;
+double distance = 5;
+double duration = 10;
+bool lazyHooks = true;
+int dataInterval = 2; //time between data frames of one station [ms]
+int dataSize = 1000; //data frame payload [byte]
+
+uint64_t data_frames = 0;
+uint64_t measurements = 0;
+
+std::vector<Ptr<WifiNetDevice>> wifi_stations;
+Address recvAddr;
+
+void SendData (uint32_t sta_index)
+{
+  wifi_stations[sta_index]->Send (Create<Packet> (dataSize), recvAddr, 0x0800);
+  data_frames++;
+  Simulator::Schedule (MilliSeconds (dataInterval), &SendData, sta_index);
+}
+
+void StartSession (void);
+
+void SessionOver (FtmSession session)
+{
+  measurements += session.GetIndividualRTT ().size ();
+  //session is removed from the manager after this callback, so start the next one a bit later
+  Simulator::Schedule (MilliSeconds (10), &StartSession);
+}
+
+void StartSession (void)
+{
+  Ptr<RegularWifiMac> sta_mac = wifi_stations[0]->GetMac ()->GetObject<RegularWifiMac> ();
+  Ptr<FtmSession> session = sta_mac->NewFtmSession (Mac48Address::ConvertFrom (recvAddr));
+  if (session == 0)
+    {
+      Simulator::Schedule (MilliSeconds (10), &StartSession);
+      return;
+    }
+
+  FtmParams ftm_params;
+  ftm_params.SetStatusIndication (FtmParams::RESERVED);
+  ftm_params.SetNumberOfBurstsExponent (1); //2 bursts
+  ftm_params.SetBurstDuration (7); //8 ms burst duration
+  ftm_params.SetMinDeltaFtm (10); //1 ms between frames
+  ftm_params.SetPartialTsfNoPref (true);
+  ftm_params.SetAsap (true);
+  ftm_params.SetFtmsPerBurst (2);
+  ftm_params.SetBurstPeriod (1); //100 ms between burst periods
+  session->SetFtmParams (ftm_params);
+
+  session->SetSessionOverCallback (MakeCallback (&SessionOver));
+  session->SessionBegin ();
+}
+
+int main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("numberOfStations", "Number of stations sending data", numberOfStations);
+  cmd.AddValue ("distance", "Distance of the stations to the AP [m]", distance);
+  cmd.AddValue ("duration", "Simulated time [s]", duration);
+  cmd.AddValue ("lazyHooks", "Connect the FTM PHY hooks only while needed (1) or always (0)", lazyHooks);
+  cmd.AddValue ("dataInterval", "Time between data frames of one station [ms]", dataInterval);
+  cmd.AddValue ("dataSize", "Data frame payload [byte]", dataSize);
+  cmd.Parse (argc, argv);
+
+  auto wall_start = std::chrono::steady_clock::now ();
+
+  //enable FTM through attribute system
+  Config::SetDefault ("ns3::RegularWifiMac::FTM_Enabled", BooleanValue (true));
+  Config::SetDefault ("ns3::FtmManager::LazyPhyHooks", BooleanValue (lazyHooks));
+
+  NodeContainer c;
+  c.Create (numberOfStations + 1); // 1 for the AP
+
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211n_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager");
+
+  YansWifiPhyHelper wifiPhy;
+  wifiPhy.Set ("RxGain", DoubleValue (0));
+
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::ThreeGppIndoorOfficePropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+
+  WifiMacHelper wifiMac;
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, c);
+
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0.0, 0.0, 0.0));
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      double angle = 2 * M_PI * i / numberOfStations;
+      positionAlloc->Add (Vector (distance * cos (angle), distance * sin (angle), 0));
+    }
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (c);
+
+  Ptr<WifiNetDevice> wifi_ap = devices.Get (0)->GetObject<WifiNetDevice> ();
+  recvAddr = wifi_ap->GetAddress ();
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      wifi_stations.push_back (devices.Get (i + 1)->GetObject<WifiNetDevice> ());
+      Simulator::Schedule (MicroSeconds (100 * i), &SendData, i);
+    }
+  Simulator::Schedule (MilliSeconds (1), &StartSession);
+
+  //set time resolution to pico seconds for the time stamps, as default is in nano seconds. IMPORTANT
+  Time::SetResolution (Time::PS);
+
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+  FtmMetrics metrics = FtmManager::GetMergedMetrics ();
+  Simulator::Destroy ();
+
+  auto wall_ms = std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::steady_clock::now () - wall_start).count ();
+  std::cout << lazyHooks << "," << numberOfStations << "," << duration << "," << data_frames << ","
+            << metrics.rx_frames_inspected << "," << metrics.tx_frames_inspected << ","
+            << measurements << "," << wall_ms << std::endl;
+
+  return 0;
+}
@@ -20,6 +20,15 @@
  * Based on the "wifi-simple-infra.cc" example.
  * Modified by Christos Laskos.
  * 2022
+ *
+ * The station ranges with the AP from 10 random positions, drawn with --seed. The positions are independent,
+ * so every position is simulated in its own child process, starting from the same parent state, with RngRun
+ * and error model seed --firstRun + position. Up to --workers children run at the same time and their
+ * measurements are written to --filename in the order of the positions, so the output does not depend on
+ * the number of workers.
+ *
+ * Example:
+ *   ./waf --run "ftm-localization --error=2 --seed=13 --filename=ftm_localization/sig_str.txt --workers=4"
  */
 
 #include "ns3/command-line.h"
@@ -42,6 +51,12 @@
 #include "ns3/mgt-headers.h"
 #include "ns3/ftm-error-model.h"
 #include "ns3/pointer.h"
+#include "ns3/rng-seed-manager.h"
+
+#include <fstream>
+#include <cstdio>
+
+#include "ftm-fork-pool.h"
 
 
 using namespace ns3;
@@ -60,6 +75,8 @@ uint8_t curr_position_num = 0;
 const uint8_t total_positions = 10;
 double x_positions[10] = {};
 double y_positions[10] = {};
+int workers = 1;
+uint32_t first_run = 1;
 
 std::list<std::tuple<int64_t, double, double, double>> measurements; //saving RTT, sig str, x pos, y pos
 
@@ -71,18 +88,21 @@ void SessionOver (FtmSession session)
   while (!rtts.empty())
     {
       std::tuple<int64_t, double, double, double> tmp_data_point =
-          std::make_tuple(rtts.front(), sig_strs.front(), x_positions[curr_position_num-1], y_positions[curr_position_num-1]);
+          std::make_tuple(rtts.front(), sig_strs.front(), x_positions[curr_position_num], y_positions[curr_position_num]);
       measurements.push_back(tmp_data_point);
 
       rtts.pop_front();
       sig_strs.pop_front();
     }
-}
 
-void ChangePosition (Ptr<Node> sta) {
-  Ptr<MobilityModel> mobility = sta->GetObject<MobilityModel>();
-  Vector position = mobility->GetPosition();
+  //one session per position, the process is done
+  Simulator::Stop ();
+}
 
+/*
+ * Draws the next position, at least 1 m away from the AP and all previous positions.
+ */
+void GeneratePosition () {
   double x = (double) dist(gen) / 100; //convert cm to m
   double y = (double) dist(gen) / 100; //convert cm to m
 
@@ -102,17 +122,22 @@ void ChangePosition (Ptr<Node> sta) {
 
   if(distance_ap < 1 || too_close)
     {
-      ChangePosition (sta);
+      GeneratePosition ();
       return;
     }
 
   x_positions[curr_position_num] = x;
   y_positions[curr_position_num] = y;
 
-  position.x = x;
-  position.y = y;
-
   curr_position_num++;
+}
+
+void ChangePosition (Ptr<Node> sta) {
+  Ptr<MobilityModel> mobility = sta->GetObject<MobilityModel>();
+  Vector position = mobility->GetPosition();
+
+  position.x = x_positions[curr_position_num];
+  position.y = y_positions[curr_position_num];
 
   mobility->SetPosition(position);
 }
@@ -134,14 +159,14 @@ static void GenerateTraffic (Ptr<WifiNetDevice> ap, Ptr<WifiNetDevice> sta, Addr
   Ptr<FtmErrorModel> error_model;
   if (selected_error_mode == 0) {
       //create the wired error model
-      Ptr<WiredFtmErrorModel> wired_error = CreateObject<WiredFtmErrorModel> ();
+      Ptr<WiredFtmErrorModel> wired_error = CreateObject<WiredFtmErrorModel> (first_run + curr_position_num);
       wired_error->SetChannelBandwidth(WiredFtmErrorModel::Channel_20_MHz);
       error_model = wired_error;
   }
   else if (selected_error_mode == 1) {
       //create wireless error model
       //map has to be created prior
-      Ptr<WirelessFtmErrorModel> wireless_error = CreateObject<WirelessFtmErrorModel> ();
+      Ptr<WirelessFtmErrorModel> wireless_error = CreateObject<WirelessFtmErrorModel> (first_run + curr_position_num);
       wireless_error->SetFtmMap(map);
       wireless_error->SetNode(sta->GetNode());
       wireless_error->SetChannelBandwidth(WiredFtmErrorModel::Channel_20_MHz);
@@ -150,7 +175,7 @@ static void GenerateTraffic (Ptr<WifiNetDevice> ap, Ptr<WifiNetDevice> sta, Addr
   else if (selected_error_mode == 2 || selected_error_mode == 3) {
       //create wireless signal strength error model
       //map has to be created prior
-      Ptr<WirelessSigStrFtmErrorModel> wireless_sig_str_error = CreateObject<WirelessSigStrFtmErrorModel> ();
+      Ptr<WirelessSigStrFtmErrorModel> wireless_sig_str_error = CreateObject<WirelessSigStrFtmErrorModel> (first_run + curr_position_num);
       wireless_sig_str_error->SetFtmMap(map);
       wireless_sig_str_error->SetNode(sta->GetNode());
       wireless_sig_str_error->SetChannelBandwidth(WiredFtmErrorModel::Channel_20_MHz);
@@ -178,23 +203,15 @@ static void GenerateTraffic (Ptr<WifiNetDevice> ap, Ptr<WifiNetDevice> sta, Addr
 
   session->SetSessionOverCallback(MakeCallback(&SessionOver));
   session->SessionBegin();
-
-  if (curr_position_num < total_positions)
-    {
-      Simulator::Schedule(Seconds (5), &GenerateTraffic, ap, sta, recvAddr);
-    }
 }
 
-int main (int argc, char *argv[])
+/*
+ * Simulates the session of one position, called in the child process, and writes its measurements.
+ */
+static void RunPosition (uint8_t index, const std::string &part_name)
 {
-  //double rss = -80;  // -dBm
-  std::uint_least32_t seed = 13;
-
-  CommandLine cmd (__FILE__);
-  cmd.AddValue ("error", "Currently Selected Error Mode", selected_error_mode);
-  cmd.AddValue ("filename", "Used File Name for Saving", file_name);
-  cmd.AddValue ("seed", "Seed for Position Generation", seed);
-  cmd.Parse (argc, argv);
+  curr_position_num = index;
+  RngSeedManager::SetRun (first_run + index);
 
   //enable FTM through attribute system
   Config::SetDefault ("ns3::RegularWifiMac::FTM_Enabled", BooleanValue(true));
@@ -279,31 +296,16 @@ int main (int argc, char *argv[])
 //  ap_mac->EnableFtm();
 //  sta_mac->EnableFtm();
 
-  //load FTM map for usage
-  map = CreateObject<WirelessFtmErrorModel::FtmMap> ();
-  if (selected_error_mode != 0) {
-      map->LoadMap ("src/wifi/ftm_map/FTM_Wireless_Error.map");
-  }
-
-//  std::random_device rd; // obtain a random number from hardware
-  gen = std::mt19937 (seed); // seed the generator
-  dist = std::uniform_int_distribution<> (-3000, 3000); // define the range in cm, -30m to 30m
-
-
   // Tracing
 //  wifiPhy.EnablePcap ("ftm-localization", devices);
 
   Simulator::ScheduleNow (&GenerateTraffic, wifi_ap, wifi_sta, recvAddr);
 
-  //set time resolution to pico seconds for the time stamps, as default is in nano seconds. IMPORTANT
-  Time::SetResolution(Time::PS);
-
-  Simulator::Stop (Seconds (100.0));
+  //the sequential run gave every position 5 s until the next one started
+  Simulator::Stop (Seconds (5.0));
   Simulator::Run ();
-  Simulator::Destroy ();
 
-  std::ofstream output (file_name);
-  output << "#rtt sig_str x y" << "\n";
+  std::ofstream output (part_name);
   while (!measurements.empty())
     {
       auto current = measurements.front();
@@ -314,6 +316,68 @@ int main (int argc, char *argv[])
       measurements.pop_front();
     }
   output.close();
+}
 
+/*
+ * Simulates one position in a child of the fork pool.
+ */
+static int RunPositionJob (std::size_t index, int fd)
+{
+  RunPosition (index, file_name + ".position" + std::to_string (index));
   return 0;
 }
+
+int main (int argc, char *argv[])
+{
+  //double rss = -80;  // -dBm
+  std::uint_least32_t seed = 13;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("error", "Currently Selected Error Mode", selected_error_mode);
+  cmd.AddValue ("filename", "Used File Name for Saving", file_name);
+  cmd.AddValue ("seed", "Seed for Position Generation", seed);
+  cmd.AddValue ("workers", "Number of positions simulated at the same time", workers);
+  cmd.AddValue ("firstRun", "RngRun and error model seed of the first position", first_run);
+  cmd.Parse (argc, argv);
+
+  //load FTM map for usage, before forking so every child uses the loaded map
+  map = CreateObject<WirelessFtmErrorModel::FtmMap> ();
+  if (selected_error_mode != 0) {
+      map->LoadMap ("src/wifi/ftm_map/FTM_Wireless_Error.map");
+  }
+
+//  std::random_device rd; // obtain a random number from hardware
+  gen = std::mt19937 (seed); // seed the generator
+  dist = std::uniform_int_distribution<> (-3000, 3000); // define the range in cm, -30m to 30m
+  //all positions are drawn up front, so they do not depend on which process simulates them
+  while (curr_position_num < total_positions)
+    {
+      GeneratePosition ();
+    }
+
+  //set time resolution to pico seconds for the time stamps, as default is in nano seconds. IMPORTANT
+  Time::SetResolution(Time::PS);
+
+  bool failed = !RunFtmForkPool (total_positions, "position", workers, MakeCallback (&RunPositionJob),
+                                 MakeNullCallback<bool, std::size_t, int, bool, double> ());
+
+  //merge in the order of the positions
+  std::ofstream output (file_name);
+  output << "#rtt sig_str x y" << "\n";
+  for (int i = 0; i < total_positions; i++)
+    {
+      std::string part_name = file_name + ".position" + std::to_string (i);
+      std::ifstream part (part_name);
+      if (!part.is_open ())
+        {
+          failed = true;
+          continue;
+        }
+      output << part.rdbuf ();
+      part.close ();
+      std::remove (part_name.c_str ());
+    }
+  output.close();
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,135 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Lookup benchmark for the FtmMap of the WirelessFtmErrorModel.
+ *
+ * Loads a text .map or a tiled .ftmtiles map (see --totiles of src/wifi/ftm_map/ftm_map_generator.py) and
+ * lets several walkers do a random walk over it, querying the bias at every step. Walkers change the floor
+ * with a small probability. The steps are generated in batches of at least 4096 lookups, which are timed
+ * together, so the clock is not part of the lookup latency. The resident memory before and after the walk,
+ * the number of mapped tiles and the mean lookup latency are printed as one CSV line:
+ *
+ *   map,walkers,steps,max_resident_tiles,resident_tiles,rss_load_kb,rss_end_kb,ns_per_lookup
+ *
+ * Example:
+ *   python3 src/wifi/ftm_map/ftm_map_generator.py --totiles floor0.map floor1.map -o campus
+ *   ./waf --run "ftm-map-benchmark --map=campus.ftmtiles --walkers=100 --maxResidentTiles=16"
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/uinteger.h"
+#include "ns3/ftm-error-model.h"
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace ns3;
+
+/// Returns the resident set size of the process [kB].
+uint64_t ResidentKb (void)
+{
+  std::ifstream status ("/proc/self/status");
+  std::string line;
+  while (std::getline (status, line))
+    {
+      if (line.compare (0, 6, "VmRSS:") == 0)
+        {
+          return std::stoull (line.substr (6));
+        }
+    }
+  return 0;
+}
+
+int main (int argc, char *argv[])
+{
+  std::string mapFile = "src/wifi/ftm_map/FTM_Wireless_Error.map";
+  uint32_t walkers = 100;
+  uint32_t steps = 100000;
+  uint32_t maxResidentTiles = 64;
+  double stepSize = 0.5;
+  double floorChange = 0.01;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("map", "The .map or .ftmtiles file", mapFile);
+  cmd.AddValue ("walkers", "Number of random walkers", walkers);
+  cmd.AddValue ("steps", "Number of steps of every walker", steps);
+  cmd.AddValue ("maxResidentTiles", "Maximum number of tiles mapped into memory", maxResidentTiles);
+  cmd.AddValue ("stepSize", "Maximum step length in x and y [m]", stepSize);
+  cmd.AddValue ("floorChange", "Probability of a floor change per step", floorChange);
+  cmd.Parse (argc, argv);
+
+  Ptr<WirelessFtmErrorModel::FtmMap> map = CreateObject<WirelessFtmErrorModel::FtmMap> ();
+  map->SetAttribute ("MaxResidentTiles", UintegerValue (maxResidentTiles));
+  map->LoadMap (mapFile);
+  uint64_t rss_load = ResidentKb ();
+
+  Box box = map->GetBoundingBox ();
+  double floor_height = box.zMax > box.zMin ? box.zMax - box.zMin : 0;
+  std::mt19937 generator (1);
+  std::uniform_real_distribution<double> x_dist (box.xMin, box.xMax);
+  std::uniform_real_distribution<double> y_dist (box.yMin, box.yMax);
+  std::uniform_real_distribution<double> z_dist (box.zMin, box.zMin + floor_height);
+  std::uniform_real_distribution<double> step_dist (-stepSize, stepSize);
+  std::bernoulli_distribution floor_dist (floorChange);
+  std::vector<Vector> positions;
+  for (uint32_t i = 0; i < walkers; i++)
+    {
+      positions.push_back (Vector (x_dist (generator), y_dist (generator), z_dist (generator)));
+    }
+
+  //walkers take turns, as the stations of a simulation do
+  uint32_t batch_steps = std::max<uint32_t> (1, 4096 / std::max<uint32_t> (walkers, 1));
+  std::vector<Vector> batch;
+  batch.reserve ((std::size_t) batch_steps * walkers);
+  double checksum = 0;
+  uint64_t lookup_ns = 0;
+  for (uint32_t step = 0; step < steps; step += batch_steps)
+    {
+      batch.clear ();
+      for (uint32_t batch_step = 0; batch_step < batch_steps && step + batch_step < steps; batch_step++)
+        {
+          for (Vector &position : positions)
+            {
+              position.x = std::min (std::max (position.x + step_dist (generator), box.xMin), box.xMax);
+              position.y = std::min (std::max (position.y + step_dist (generator), box.yMin), box.yMax);
+              if (floor_dist (generator))
+                {
+                  position.z = z_dist (generator);
+                }
+              batch.push_back (position);
+            }
+        }
+      auto start = std::chrono::steady_clock::now ();
+      for (const Vector &position : batch)
+        {
+          checksum += map->GetBias (position.x, position.y, position.z);
+        }
+      lookup_ns += std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now () - start).count ();
+    }
+  uint64_t lookups = (uint64_t) walkers * steps;
+
+  std::cout << mapFile << "," << walkers << "," << steps << "," << maxResidentTiles << ","
+            << map->GetResidentTiles () << "," << rss_load << "," << ResidentKb () << ","
+            << (lookups > 0 ? (double) lookup_ns / lookups : 0) << std::endl;
+  std::cerr << "checksum " << checksum << std::endl;
+  return 0;
+}
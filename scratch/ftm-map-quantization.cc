@@ -0,0 +1,196 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Check of the quantized FtmMap storage.
+ *
+ * Loads the same text map once with doubles (the default) and once quantized (Quantize=true), compares the
+ * bias of every cell and loads one quantized map per AP into an FtmMapSet. Without --map a smooth random map
+ * in the style of ftm_map_generator.py is written to a temporary file first. The program fails with exit
+ * code 1 if the quantized map does not need at least --minRatio times less memory, if a cell differs by more
+ * than --maxError picoseconds or if an error model does not use the map of its session partner. The partner
+ * selection is checked for the WirelessFtmErrorModel and for an FtmErrorPipeline with an FtmMapBiasStage,
+ * against a second map that only one of the APs uses. The result is printed as one CSV line:
+ *
+ *   cells,double_bytes,quantized_bytes,ratio,max_error_ps,aps,map_set_bytes,partner_errors,passed
+ *
+ * Example:
+ *   ./waf --run "ftm-map-quantization --size=50 --resolution=0.05 --aps=24"
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/boolean.h"
+#include "ns3/ftm-error-model.h"
+#include "ns3/node.h"
+#include "ns3/constant-position-mobility-model.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+/// Writes a smooth random map with a bias of some 10 ns, like the map generator does.
+void WriteMap (std::string filename, double size, double resolution, uint32_t seed)
+{
+  int cells = (int) (size / resolution) + 1;
+  std::mt19937 generator (seed);
+  std::uniform_real_distribution<double> phase (0, 2 * M_PI);
+  std::vector<double> phases;
+  for (int i = 0; i < 8; i++)
+    {
+      phases.push_back (phase (generator));
+    }
+  std::ofstream file (filename);
+  file << "# xmin=0,xmax=" << size << ",ymin=0,ymax=" << size << ",bias=10000,dcorr=0.25,resolution="
+       << resolution << std::endl << "# " << std::endl;
+  file << std::setprecision (18);
+  for (int y = 0; y < cells; y++)
+    {
+      for (int x = 0; x < cells; x++)
+        {
+          double px = x * resolution;
+          double py = y * resolution;
+          double bias = 0;
+          for (int i = 0; i < 4; i++)
+            {
+              bias += 4000 * sin (px * (i + 1) / 1.7 + phases[2 * i]) * cos (py * (i + 1) / 2.3 + phases[2 * i + 1]);
+            }
+          file << bias << (x + 1 < cells ? " " : "");
+        }
+      file << std::endl;
+    }
+}
+
+int main (int argc, char *argv[])
+{
+  std::string mapFile = "";
+  double size = 50;
+  double resolution = 0.05;
+  uint32_t aps = 24;
+  double minRatio = 4;
+  double maxError = 0.5;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("map", "Text .map file to check, a random map is generated if empty", mapFile);
+  cmd.AddValue ("size", "Edge length of the generated map [m]", size);
+  cmd.AddValue ("resolution", "Resolution of the generated map [m]", resolution);
+  cmd.AddValue ("aps", "Number of APs with their own map in the FtmMapSet", aps);
+  cmd.AddValue ("minRatio", "Minimum memory ratio of double to quantized storage", minRatio);
+  cmd.AddValue ("maxError", "Maximum quantization error [ps]", maxError);
+  cmd.Parse (argc, argv);
+
+  if (mapFile.empty ())
+    {
+      mapFile = "/tmp/ftm-map-quantization.map";
+      WriteMap (mapFile, size, resolution, 1);
+    }
+
+  Ptr<WirelessFtmErrorModel::FtmMap> exact = CreateObject<WirelessFtmErrorModel::FtmMap> ();
+  exact->LoadMap (mapFile);
+  Ptr<WirelessFtmErrorModel::FtmMap> quantized = CreateObject<WirelessFtmErrorModel::FtmMap> ();
+  quantized->SetAttribute ("Quantize", BooleanValue (true));
+  quantized->LoadMap (mapFile);
+
+  //compare the cell centers, so that rounding of the coordinates can not select a neighbouring cell
+  Box box = exact->GetBoundingBox ();
+  double map_resolution = resolution;
+  std::ifstream header_file (mapFile);
+  std::string header;
+  std::getline (header_file, header);
+  std::size_t pos = header.find ("resolution=");
+  if (pos != std::string::npos)
+    {
+      map_resolution = std::stod (header.substr (pos + 11));
+    }
+  uint64_t cells = 0;
+  double max_error_ps = 0;
+  for (double y = box.yMax - map_resolution / 2; y >= box.yMin; y -= map_resolution)
+    {
+      for (double x = box.xMin + map_resolution / 2; x <= box.xMax; x += map_resolution)
+        {
+          max_error_ps = std::max (max_error_ps, std::abs (exact->GetBias (x, y) - quantized->GetBias (x, y)));
+          cells++;
+        }
+    }
+
+  //the first AP uses a different map than all other APs
+  std::string otherMapFile = "/tmp/ftm-map-quantization-other.map";
+  WriteMap (otherMapFile, box.xMax - box.xMin, map_resolution, 2);
+  Ptr<WirelessFtmErrorModel::FtmMapSet> map_set = CreateObject<WirelessFtmErrorModel::FtmMapSet> ();
+  std::vector<Mac48Address> ap_addresses;
+  for (uint32_t i = 0; i < std::max<uint32_t> (aps, 2); i++)
+    {
+      ap_addresses.push_back (Mac48Address::Allocate ());
+      Ptr<WirelessFtmErrorModel::FtmMap> map = CreateObject<WirelessFtmErrorModel::FtmMap> ();
+      map->SetAttribute ("Quantize", BooleanValue (true));
+      map->LoadMap (i == 0 ? otherMapFile : mapFile);
+      map_set->AddMap (ap_addresses[i], map);
+    }
+
+  //an error model with the map set has to give the same error as one with the map of its partner
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  node->AggregateObject (mobility);
+  uint32_t partner_errors = 0;
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<WirelessFtmErrorModel::FtmMap> partner_map = map_set->GetMap (ap_addresses[i]);
+      Ptr<WirelessFtmErrorModel> with_set = CreateObject<WirelessFtmErrorModel> (1);
+      with_set->SetFtmMapSet (map_set);
+      with_set->SetNode (node);
+      with_set->SetPartner (ap_addresses[i]);
+      Ptr<WirelessFtmErrorModel> with_map = CreateObject<WirelessFtmErrorModel> (1);
+      with_map->SetFtmMap (partner_map);
+      with_map->SetNode (node);
+      Ptr<FtmErrorModel> pipeline = CreateFtmErrorPipeline (1, FtmMapBiasStage (map_set, node));
+      pipeline->SetPartner (ap_addresses[i]);
+      for (double x = box.xMin + 1; x < box.xMax; x += (box.xMax - box.xMin) / 16)
+        {
+          mobility->SetPosition (Vector (x, (box.yMin + box.yMax) / 2, 0));
+          int bias = partner_map->GetBias (x, (box.yMin + box.yMax) / 2, 0);
+          if (with_set->GetFtmError (-60) != with_map->GetFtmError (-60) || pipeline->GetFtmError (-60) != bias)
+            {
+              partner_errors++;
+            }
+        }
+    }
+  //without a distinct map for the first AP the check above would pass with any map
+  Vector center ((box.xMin + box.xMax) / 2, (box.yMin + box.yMax) / 2, 0);
+  if (map_set->GetMap (ap_addresses[0])->GetBias (center.x, center.y, 0)
+      == map_set->GetMap (ap_addresses[1])->GetBias (center.x, center.y, 0))
+    {
+      partner_errors++;
+    }
+
+  double ratio = (double) exact->GetMemoryUsage () / quantized->GetMemoryUsage ();
+  bool passed = ratio >= minRatio && max_error_ps <= maxError && partner_errors == 0;
+  std::cout << cells << "," << exact->GetMemoryUsage () << "," << quantized->GetMemoryUsage () << "," << ratio
+            << "," << max_error_ps << "," << aps << "," << map_set->GetMemoryUsage () << "," << partner_errors
+            << "," << passed << std::endl;
+  if (!passed)
+    {
+      std::cerr << "FTM map quantization check failed: ratio " << ratio << " (min " << minRatio << "), error "
+                << max_error_ps << " ps (max " << maxError << " ps), " << partner_errors
+                << " errors with the map of the wrong partner" << std::endl;
+      return 1;
+    }
+  return 0;
+}
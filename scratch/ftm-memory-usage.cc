@@ -0,0 +1,197 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Memory usage check of the FTM sessions.
+ *
+ * Every station runs FTM sessions with the AP back to back for --duration seconds, each session with its own
+ * WiredFtmErrorModel. The memory accounts of the FtmManagers are read every --sampleIntervalMs, which updates
+ * their peaks, and once more at the end:
+ *  - initiator_session_bytes is the largest session of a station, with its dialogs and error model, measured
+ *    when the session ended,
+ *  - responder_session_bytes is the same for the sessions of the AP.
+ * One CSV line is printed and the program returns 1 if one of the two is above --maxSessionBytes:
+ *
+ *   stations,initiator_session_bytes,responder_session_bytes,station_peak_bytes,ap_peak_bytes,ap_live_bytes,
+ *   max_session_bytes,passed
+ *
+ * station_peak_bytes is the largest sampled total of a station, including its FtmManager. With --verbose the
+ * peak of every category of the AP is written to stderr as JSON.
+ *
+ * Example:
+ *   ./waf --run "ftm-memory-usage --numberOfStations=64 --maxSessionBytes=4096"
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/config.h"
+#include "ns3/double.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/ftm-header.h"
+#include "ns3/ftm-manager.h"
+#include "ns3/ftm-error-model.h"
+#include "ns3/wifi-mac-helper.h"
+#include "ns3/wifi-helper.h"
+
+#include <iostream>
+#include <math.h>
+#include <algorithm>
+
+using namespace ns3;
+
+int numberOfStations = 16;
+double distance = 5;
+double duration = 10;
+uint64_t maxSessionBytes = 4096;
+bool verbose = false;
+double sampleIntervalMs = 10;
+
+std::vector<Ptr<WifiNetDevice>> wifi_stations;
+Address recvAddr;
+
+void StartSession (uint32_t sta_index);
+
+void SessionOver (uint32_t sta_index, FtmSession session)
+{
+  //session is removed from the manager after this callback, so start the next one a bit later
+  Simulator::Schedule (MilliSeconds (10), &StartSession, sta_index);
+}
+
+void StartSession (uint32_t sta_index)
+{
+  Ptr<RegularWifiMac> sta_mac = wifi_stations[sta_index]->GetMac ()->GetObject<RegularWifiMac> ();
+  Ptr<FtmSession> session = sta_mac->NewFtmSession (Mac48Address::ConvertFrom (recvAddr));
+  if (session == 0)
+    {
+      Simulator::Schedule (MilliSeconds (10), &StartSession, sta_index);
+      return;
+    }
+  session->SetFtmErrorModel (CreateObject<WiredFtmErrorModel> (sta_index + 1));
+
+  FtmParams ftm_params;
+  ftm_params.SetStatusIndication (FtmParams::RESERVED);
+  ftm_params.SetNumberOfBurstsExponent (1); //2 bursts
+  ftm_params.SetBurstDuration (7); //8 ms burst duration
+  ftm_params.SetMinDeltaFtm (10); //1 ms between frames
+  ftm_params.SetPartialTsfNoPref (true);
+  ftm_params.SetAsap (true);
+  ftm_params.SetFtmsPerBurst (2);
+  ftm_params.SetBurstPeriod (1); //100 ms between burst periods
+  session->SetFtmParams (ftm_params);
+
+  session->SetSessionOverCallback (MakeBoundCallback (&SessionOver, sta_index));
+  session->SessionBegin ();
+}
+
+/*
+ * reads the memory accounts, the usage is only computed and the peaks only updated when they are read
+ */
+static void
+SampleMemory (Ptr<WifiNetDevice> wifi_ap)
+{
+  for (Ptr<WifiNetDevice> sta : wifi_stations)
+    {
+      FtmManager::GetFtmManager (sta->GetPhy ())->GetMemoryAccount ();
+    }
+  FtmManager::GetFtmManager (wifi_ap->GetPhy ())->GetMemoryAccount ();
+  Simulator::Schedule (MilliSeconds (sampleIntervalMs), &SampleMemory, wifi_ap);
+}
+
+int main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("numberOfStations", "Number of initiating stations", numberOfStations);
+  cmd.AddValue ("distance", "Distance of the stations to the AP [m]", distance);
+  cmd.AddValue ("duration", "Simulated time [s]", duration);
+  cmd.AddValue ("maxSessionBytes", "Maximum memory of one session [bytes]", maxSessionBytes);
+  cmd.AddValue ("verbose", "Write the peak of every category of the AP to stderr", verbose);
+  cmd.AddValue ("sampleIntervalMs", "Interval of reading the memory accounts [ms]", sampleIntervalMs);
+  cmd.Parse (argc, argv);
+
+  Config::SetDefault ("ns3::RegularWifiMac::FTM_Enabled", BooleanValue (true));
+
+  NodeContainer c;
+  c.Create (numberOfStations + 1); // 1 for the AP
+
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211n_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager");
+
+  YansWifiPhyHelper wifiPhy;
+  wifiPhy.Set ("RxGain", DoubleValue (0));
+
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::ThreeGppIndoorOfficePropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+
+  WifiMacHelper wifiMac;
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, c);
+
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0.0, 0.0, 0.0));
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      double angle = 2 * M_PI * i / numberOfStations;
+      positionAlloc->Add (Vector (distance * cos (angle), distance * sin (angle), 0));
+    }
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (c);
+
+  Ptr<WifiNetDevice> wifi_ap = devices.Get (0)->GetObject<WifiNetDevice> ();
+  recvAddr = wifi_ap->GetAddress ();
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      wifi_stations.push_back (devices.Get (i + 1)->GetObject<WifiNetDevice> ());
+      Simulator::Schedule (MilliSeconds (i), &StartSession, i);
+    }
+  Simulator::Schedule (MilliSeconds (sampleIntervalMs), &SampleMemory, wifi_ap);
+
+  //set time resolution to pico seconds for the time stamps, as default is in nano seconds. IMPORTANT
+  Time::SetResolution (Time::PS);
+
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+
+  uint64_t initiator_session_bytes = 0;
+  uint64_t station_peak_bytes = 0;
+  for (Ptr<WifiNetDevice> sta : wifi_stations)
+    {
+      FtmMemoryAccount account = FtmManager::GetFtmManager (sta->GetPhy ())->GetMemoryAccount ();
+      initiator_session_bytes = std::max (initiator_session_bytes, account.session_peak.GetTotal ());
+      station_peak_bytes = std::max (station_peak_bytes, account.peak_total);
+    }
+  FtmMemoryAccount ap_account = FtmManager::GetFtmManager (wifi_ap->GetPhy ())->GetMemoryAccount ();
+  uint64_t responder_session_bytes = ap_account.session_peak.GetTotal ();
+  Simulator::Destroy ();
+
+  if (verbose)
+    {
+      ap_account.peak.PrintJson (std::cerr);
+      std::cerr << std::endl;
+    }
+  bool passed = initiator_session_bytes <= maxSessionBytes && responder_session_bytes <= maxSessionBytes;
+  std::cout << numberOfStations << "," << initiator_session_bytes << "," << responder_session_bytes << ","
+            << station_peak_bytes << "," << ap_account.peak_total << "," << ap_account.live.GetTotal () << ","
+            << maxSessionBytes << "," << passed << std::endl;
+
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,620 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Microbenchmarks of the FTM model hot paths, without running a simulation:
+ *  - header_*: FtmParams and FtmResponseHeader serialize/deserialize,
+ *  - session_*: the dialog lookup of an FtmSession with <param> dialogs, a dialog from t2 to its follow-up,
+ *    which creates, finds and deletes it, and the same dialog with the RTT calculated with and without live feedback,
+ *  - manager_*: the session and blocked partner lookups of CreateNewSession and ReceivedFtmResponse with
+ *    <param> sessions and blocked partners, manager_rx_ftm_response one received FTM response with <param>
+ *    sessions, delivered to the PHY hooks through WifiPhy::NotifyRxBegin and NotifyMonitorSniffRx; two RX
+ *    implementations are compared by running it on both commits, each with its own --label,
+ *
+ * Everything runs through the public API of the model, so the same program can be built on other commits.
+ *  - error_model_*: GetFtmError of every error model, *_batch the GetFtmErrors of <param> samples per op,
+ *  - map_*: FtmMap::LoadMap of a generated map with <param> cells per side and GetBias,
+ *  - channel_*: the receive powers the channel calculates for one frame of <param> static nodes, so for
+ *    <param> - 1 receivers, with and without the FtmCachedPropagationLossModel.
+ *
+ * Every benchmark runs until it took at least --minTimeMs. The number of iterations, ns/op and the heap
+ * allocations and bytes per op (counted through a replaced global operator new) are written as JSON, to stdout
+ * or to --output, so the results of different commits can be compared on the same machine:
+ *
+ *   {"label": "...", "min_time_ms": 200, "benchmarks": [
+ *     {"name": "header_params_serialize", "param": 0, "iterations": 1000000, "ns_per_op": 12.3,
+ *      "allocs_per_op": 0, "bytes_per_op": 0}, ...]}
+ *
+ * Example:
+ *   ./waf --run "ftm-microbenchmark --label=$(git rev-parse --short HEAD) --output=bench.json"
+ *   ./waf --run "ftm-microbenchmark --filter=session_"
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/buffer.h"
+#include "ns3/double.h"
+#include "ns3/node.h"
+#include "ns3/yans-wifi-phy.h"
+#include "ns3/wifi-psdu.h"
+#include "ns3/txop.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/three-gpp-propagation-loss-model.h"
+#include "ns3/ftm-header.h"
+#include "ns3/ftm-session.h"
+#include "ns3/ftm-manager.h"
+#include "ns3/ftm-error-model.h"
+#include "ns3/ftm-cached-propagation-loss-model.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+#include <math.h>
+
+using namespace ns3;
+
+static uint64_t g_allocations = 0;
+static uint64_t g_allocated_bytes = 0;
+
+void *
+operator new (std::size_t size)
+{
+  g_allocations++;
+  g_allocated_bytes += size;
+  void *ptr = std::malloc (size == 0 ? 1 : size);
+  if (ptr == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return ptr;
+}
+
+void
+operator delete (void *ptr) noexcept
+{
+  std::free (ptr);
+}
+
+void
+operator delete (void *ptr, std::size_t) noexcept
+{
+  std::free (ptr);
+}
+
+double minTimeMs = 200;
+std::string filter = "";
+std::string label = "";
+std::string output = "";
+std::string mapFile = "ftm-microbenchmark.map";
+
+//results of the benchmarked calls are added here, so they are not optimized away
+static volatile int64_t g_sink = 0;
+
+struct BenchmarkResult
+{
+  std::string name;
+  uint64_t param;
+  uint64_t iterations;
+  double ns_per_op;
+  double allocs_per_op;
+  double bytes_per_op;
+};
+
+std::vector<BenchmarkResult> results;
+
+/*
+ * Runs op (i) for i = 0, 1, ... with growing iteration counts until one round took at least minTimeMs.
+ */
+template <typename Op>
+void
+Benchmark (const std::string &name, uint64_t param, Op op)
+{
+  if (!filter.empty () && name.find (filter) == std::string::npos)
+    {
+      return;
+    }
+  op (0); //warm up
+  uint64_t iterations = 1;
+  while (true)
+    {
+      uint64_t allocations = g_allocations;
+      uint64_t bytes = g_allocated_bytes;
+      auto start = std::chrono::steady_clock::now ();
+      for (uint64_t i = 0; i < iterations; i++)
+        {
+          op (i);
+        }
+      double elapsed_ns = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - start).count ();
+      if (elapsed_ns >= minTimeMs * 1e6 || iterations >= (1ull << 32))
+        {
+          results.push_back ({name, param, iterations, elapsed_ns / iterations,
+                              (double) (g_allocations - allocations) / iterations,
+                              (double) (g_allocated_bytes - bytes) / iterations});
+          std::cerr << name << "/" << param << ": " << elapsed_ns / iterations << " ns/op" << std::endl;
+          return;
+        }
+      iterations *= elapsed_ns < minTimeMs * 1e5 ? 10 : 2;
+    }
+}
+
+static void
+SinkRtt (int64_t rtt)
+{
+  g_sink += rtt;
+}
+
+/*
+ * Lets the initiator session answer the dialog of the follow-up token with the t1 and t4 of the responder,
+ * which calculates the RTT of the dialog and deletes it.
+ */
+static void
+FollowUp (Ptr<FtmSession> session, uint8_t dialog_token, uint8_t follow_up_dialog_token)
+{
+  FtmResponseHeader ftm_res;
+  ftm_res.SetDialogToken (dialog_token);
+  ftm_res.SetFollowUpDialogToken (follow_up_dialog_token);
+  ftm_res.SetTimeOfDeparture (1000000);
+  ftm_res.SetTimeOfArrival (1250000);
+  session->ProcessFtmResponse (ftm_res);
+}
+
+/*
+ * Starts an initiator session with the dialogs 1 - dialogs, as after the first FTM frames of a burst.
+ */
+static void
+InitDialogs (Ptr<FtmSession> session, Mac48Address partner, uint32_t dialogs)
+{
+  session->InitSession (partner, FtmSession::FTM_INITIATOR, MakeNullCallback<void, Ptr<Packet>, WifiMacHeader> ());
+  for (uint32_t token = 1; token <= dialogs; token++)
+    {
+      session->SetT2 (token, 1050000, -60);
+    }
+}
+
+static void
+SessionDialogs (uint32_t dialogs)
+{
+  Ptr<FtmSession> session = CreateObject<FtmSession> ();
+  Mac48Address partner = Mac48Address::Allocate ();
+  InitDialogs (session, partner, dialogs);
+  Benchmark ("session_find_dialog", dialogs, [&] (uint64_t i) {
+    session->SetSignalStrength (1 + i % dialogs, -60);
+  });
+  //dialog 255 is never part of the table, it is created by t2, found by t3 and deleted by its follow-up
+  Benchmark ("session_dialog_create_find_delete", dialogs, [&] (uint64_t i) {
+    session->SetT2 (255, 1050000, -60);
+    session->SetT3 (255, 1200000);
+    FollowUp (session, 1, 255);
+    //the RTTs of the session are kept until it is reset, so restart it before the lists get large
+    if ((i + 1) % 65536 == 0)
+      {
+        session->Reset ();
+        InitDialogs (session, partner, dialogs);
+      }
+  });
+  session->Dispose ();
+}
+
+static void
+SessionCalculateRtt (bool live)
+{
+  Ptr<FtmSession> session = CreateObject<FtmSession> ();
+  Mac48Address partner = Mac48Address::Allocate ();
+  InitDialogs (session, partner, 1);
+  if (live)
+    {
+      session->EnableLiveRTTFeedback (MakeCallback (&SinkRtt));
+    }
+  Benchmark (live ? "session_calculate_rtt_live" : "session_calculate_rtt", 1, [&] (uint64_t i) {
+    session->SetT2 (2, 1050000, -60);
+    session->SetT3 (2, 1200000);
+    FollowUp (session, 1, 2);
+    //the lists keep all RTTs of a session, keep them at the size of a long session
+    if ((i + 1) % 1024 == 0)
+      {
+        session->Reset ();
+        InitDialogs (session, partner, 1);
+        if (live)
+          {
+            session->EnableLiveRTTFeedback (MakeCallback (&SinkRtt));
+          }
+      }
+  });
+  session->Dispose ();
+}
+
+/*
+ * Returns an FTM response which denies the session and blocks the initiator for an hour.
+ */
+static FtmResponseHeader
+DenyingResponse (void)
+{
+  FtmParams params;
+  params.SetStatusIndication (FtmParams::REQUEST_FAILED);
+  params.SetStatusIndicationValue (3600);
+  FtmResponseHeader ftm_res;
+  ftm_res.SetFtmParams (params);
+  return ftm_res;
+}
+
+static void
+ManagerTables (uint32_t partners)
+{
+  Ptr<FtmManager> manager = CreateObject<FtmManager> ();
+  Mac48Address own = Mac48Address::Allocate ();
+  manager->SetMacAddress (own);
+  std::vector<Mac48Address> addresses;
+  std::vector<Mac48Address> blocked;
+  for (uint32_t i = 0; i < partners; i++)
+    {
+      Mac48Address address = Mac48Address::Allocate ();
+      addresses.push_back (address);
+      manager->CreateNewSession (address, FtmSession::FTM_INITIATOR);
+      //a partner which denies the session is blocked and its session is removed
+      Mac48Address denying = Mac48Address::Allocate ();
+      blocked.push_back (denying);
+      manager->CreateNewSession (denying, FtmSession::FTM_INITIATOR);
+      manager->ReceivedFtmResponse (denying, DenyingResponse ());
+    }
+  Mac48Address unknown = Mac48Address::Allocate ();
+  FtmResponseHeader ftm_res;
+  ftm_res.SetDialogToken (1);
+  //CreateNewSession returns 0 for a partner with a session after looking it up
+  Benchmark ("manager_find_session", partners, [&] (uint64_t i) {
+    g_sink += manager->CreateNewSession (addresses[i % partners], FtmSession::FTM_INITIATOR) != 0;
+  });
+  //a response of a partner without a session is dropped after the lookup
+  Benchmark ("manager_find_session_miss", partners, [&] (uint64_t i) {
+    manager->ReceivedFtmResponse (unknown, ftm_res);
+  });
+  //a blocked partner has no session, so the session lookup misses before the blocked partners are checked
+  Benchmark ("manager_check_session_blocked", partners, [&] (uint64_t i) {
+    g_sink += manager->CreateNewSession (blocked[i % partners], FtmSession::FTM_INITIATOR) != 0;
+  });
+  //the common case, a partner which is not blocked is compared with the whole list, the own address is
+  //rejected only after that
+  Benchmark ("manager_check_session_blocked_miss", partners, [&] (uint64_t i) {
+    g_sink += manager->CreateNewSession (own, FtmSession::FTM_INITIATOR) != 0;
+  });
+  manager->Dispose ();
+}
+
+static void
+ManagerRx (uint32_t partners)
+{
+  Ptr<YansWifiPhy> phy = CreateObject<YansWifiPhy> ();
+  phy->ConfigureStandardAndBand (WIFI_PHY_STANDARD_80211a, WIFI_PHY_BAND_5GHZ);
+  Ptr<FtmManager> manager = CreateObject<FtmManager> (phy, CreateObject<Txop> ());
+  //the hooks are connected to the traces of the PHY, the frames below are delivered through them
+  manager->SetLazyPhyHooks (false);
+  Mac48Address own = Mac48Address::Allocate ();
+  manager->SetMacAddress (own);
+  std::vector<Mac48Address> addresses;
+  for (uint32_t i = 0; i < partners; i++)
+    {
+      Mac48Address address = Mac48Address::Allocate ();
+      addresses.push_back (address);
+      manager->CreateNewSession (address, FtmSession::FTM_INITIATOR);
+    }
+
+  //an FTM response of every partner, the dialog tokens cycle through 1 - 255
+  std::vector<Ptr<const WifiPsdu>> psdus;
+  for (uint32_t i = 0; i < partners; i++)
+    {
+      Ptr<Packet> packet = Create<Packet> ();
+      FtmResponseHeader ftm_res_hdr;
+      ftm_res_hdr.SetDialogToken (1 + i % 255);
+      packet->AddHeader (ftm_res_hdr);
+      WifiActionHeader action_hdr;
+      WifiActionHeader::ActionValue action;
+      action.publicAction = WifiActionHeader::FTM_RESPONSE;
+      action_hdr.SetAction (WifiActionHeader::PUBLIC_ACTION, action);
+      packet->AddHeader (action_hdr);
+      WifiMacHeader hdr;
+      hdr.SetType (WIFI_MAC_MGT_ACTION);
+      hdr.SetAddr1 (own);
+      hdr.SetAddr2 (addresses[i]);
+      psdus.push_back (Create<WifiPsdu> (packet, hdr));
+    }
+  RxPowerWattPerChannelBand rx_powers;
+  rx_powers[WifiSpectrumBand (0, 0)] = 1e-9;
+  WifiTxVector tx_vector;
+  tx_vector.SetMode (WifiPhy::GetOfdmRate6Mbps ());
+  SignalNoiseDbm signal_noise = {-60, -93};
+  std::vector<bool> status_per_mpdu = {true};
+
+  Benchmark ("manager_rx_ftm_response", partners, [&] (uint64_t i) {
+    Ptr<const WifiPsdu> psdu = psdus[i % partners];
+    phy->NotifyRxBegin (psdu, rx_powers);
+    phy->NotifyMonitorSniffRx (psdu, 5180, tx_vector, signal_noise, status_per_mpdu, SU_STA_ID);
+  });
+  manager->Dispose ();
+  phy->Dispose ();
+}
+
+static void
+HeaderBenchmarks (void)
+{
+  FtmParams params;
+  params.SetStatusIndication (FtmParams::SUCCESSFUL);
+  params.SetNumberOfBurstsExponent (2);
+  params.SetBurstDuration (7);
+  params.SetMinDeltaFtm (10);
+  params.SetPartialTsfTimer (500);
+  params.SetAsap (true);
+  params.SetFtmsPerBurst (8);
+  params.SetBurstPeriod (2);
+
+  Buffer params_buffer;
+  params_buffer.AddAtStart (params.GetSerializedSize ());
+  Benchmark ("header_params_serialize", 0, [&] (uint64_t i) {
+    params.Serialize (params_buffer.Begin ());
+  });
+  Benchmark ("header_params_deserialize", 0, [&] (uint64_t i) {
+    FtmParams received;
+    received.Deserialize (params_buffer.Begin ());
+    g_sink += received.GetFtmsPerBurst ();
+  });
+
+  FtmResponseHeader response;
+  response.SetDialogToken (3);
+  response.SetFollowUpDialogToken (2);
+  response.SetTimeOfDeparture (123456789);
+  response.SetTimeOfArrival (123459999);
+  response.SetFtmParams (params);
+  Buffer response_buffer;
+  response_buffer.AddAtStart (response.GetSerializedSize ());
+  Benchmark ("header_response_serialize", 0, [&] (uint64_t i) {
+    response.SetTimeOfDeparture (i);
+    response.Serialize (response_buffer.Begin ());
+  });
+  Benchmark ("header_response_deserialize", 0, [&] (uint64_t i) {
+    FtmResponseHeader received;
+    received.Deserialize (response_buffer.Begin ());
+    g_sink += received.GetTimeOfArrival ();
+  });
+}
+
+static void
+WriteMap (std::string filename, uint32_t cells)
+{
+  double resolution = 0.1;
+  double size = (cells - 1) * resolution;
+  std::ofstream file (filename);
+  file << "# xmin=0,xmax=" << size << ",ymin=0,ymax=" << size << ",bias=10000,dcorr=0.25,resolution="
+       << resolution << std::endl << "# " << std::endl;
+  for (uint32_t y = 0; y < cells; y++)
+    {
+      for (uint32_t x = 0; x < cells; x++)
+        {
+          file << 4000 * sin (x * resolution / 1.7) * cos (y * resolution / 2.3) << (x + 1 < cells ? " " : "");
+        }
+      file << std::endl;
+    }
+}
+
+static void
+MapAndErrorModelBenchmarks (void)
+{
+  uint32_t cells = 501; //50 m x 50 m with 10 cm resolution
+  WriteMap (mapFile, cells);
+  double size = (cells - 1) * 0.1;
+
+  Benchmark ("map_load", cells, [&] (uint64_t i) {
+    Ptr<WirelessFtmErrorModel::FtmMap> loaded = CreateObject<WirelessFtmErrorModel::FtmMap> ();
+    loaded->LoadMap (mapFile);
+  });
+
+  Ptr<WirelessFtmErrorModel::FtmMap> map = CreateObject<WirelessFtmErrorModel::FtmMap> ();
+  map->LoadMap (mapFile);
+  std::mt19937 generator (1);
+  std::uniform_real_distribution<double> coordinate (0, size);
+  std::vector<double> positions (2 * 4096);
+  for (double &position : positions)
+    {
+      position = coordinate (generator);
+    }
+  Benchmark ("map_get_bias", cells, [&] (uint64_t i) {
+    uint64_t index = 2 * (i % 4096);
+    g_sink += map->GetBias (positions[index], positions[index + 1]);
+  });
+
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  mobility->SetPosition (Vector (size / 3, size / 2, 0));
+  node->AggregateObject (mobility);
+
+  Ptr<WiredFtmErrorModel> wired = CreateObject<WiredFtmErrorModel> (1);
+  wired->SetChannelBandwidth (WiredFtmErrorModel::Channel_20_MHz);
+  Ptr<WirelessFtmErrorModel> wireless = CreateObject<WirelessFtmErrorModel> (1);
+  wireless->SetChannelBandwidth (WiredFtmErrorModel::Channel_20_MHz);
+  wireless->SetFtmMap (map);
+  wireless->SetNode (node);
+  Ptr<WirelessSigStrFtmErrorModel> sig_str = CreateObject<WirelessSigStrFtmErrorModel> (1);
+  sig_str->SetChannelBandwidth (WiredFtmErrorModel::Channel_20_MHz);
+  sig_str->SetFtmMap (map);
+  sig_str->SetNode (node);
+  Ptr<FtmErrorModel> pipeline = CreateFtmErrorPipeline (1, FtmGaussianStage::ForBandwidth (WiredFtmErrorModel::Channel_20_MHz),
+                                                        FtmMapBiasStage (map, node), FtmJohnsonSuStage ());
+
+  std::vector<std::pair<std::string, Ptr<FtmErrorModel>>> models = {
+    {"error_model_none", CreateObject<FtmErrorModel> ()},
+    {"error_model_wired", wired},
+    {"error_model_wireless", wireless},
+    {"error_model_wireless_sig_str", sig_str},
+    {"error_model_pipeline", pipeline},
+  };
+  //signal strengths of a walk away from the responder
+  std::vector<double> sig_strs (64);
+  for (uint32_t i = 0; i < sig_strs.size (); i++)
+    {
+      sig_strs[i] = -40 - (50.0 * i) / sig_strs.size ();
+    }
+  std::vector<int64_t> errors (sig_strs.size ());
+  for (auto &model : models)
+    {
+      Ptr<FtmErrorModel> error_model = model.second;
+      Benchmark (model.first, 1, [&] (uint64_t i) {
+        g_sink += error_model->GetFtmError (sig_strs[i % sig_strs.size ()]);
+      });
+      Benchmark (model.first + "_batch", sig_strs.size (), [&] (uint64_t i) {
+        error_model->GetFtmErrors (sig_strs.data (), errors.data (), sig_strs.size ());
+        g_sink += errors[i % errors.size ()];
+      });
+    }
+  std::remove (mapFile.c_str ());
+}
+
+/*
+ * Wraps a deterministic loss model in the FtmCachedPropagationLossModel, with the optional fading after it.
+ */
+static Ptr<PropagationLossModel>
+CachedLoss (Ptr<PropagationLossModel> model, Ptr<PropagationLossModel> fading)
+{
+  Ptr<FtmCachedPropagationLossModel> cached = CreateObject<FtmCachedPropagationLossModel> ();
+  cached->SetModel (model);
+  if (fading != 0)
+    {
+      cached->SetNext (fading);
+    }
+  return cached;
+}
+
+static void
+ChannelBenchmarks (uint32_t nodes)
+{
+  //static nodes in a 50 m x 50 m office
+  std::mt19937 generator (1);
+  std::uniform_real_distribution<double> coordinate (0, 50);
+  std::vector<Ptr<MobilityModel>> mobilities;
+  for (uint32_t n = 0; n < nodes; n++)
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (Vector (coordinate (generator), coordinate (generator), 1.5));
+      node->AggregateObject (mobility);
+      mobilities.push_back (mobility);
+    }
+
+  Ptr<ThreeGppIndoorOfficePropagationLossModel> three_gpp = CreateObject<ThreeGppIndoorOfficePropagationLossModel> ();
+  three_gpp->SetAttribute ("Frequency", DoubleValue (5.18e9));
+  Ptr<ThreeLogDistancePropagationLossModel> log_distance = CreateObject<ThreeLogDistancePropagationLossModel> ();
+  Ptr<PropagationLossModel> log_distance_nakagami = CreateObject<ThreeLogDistancePropagationLossModel> ();
+  log_distance_nakagami->SetNext (CreateObject<NakagamiPropagationLossModel> ());
+
+  std::vector<std::pair<std::string, Ptr<PropagationLossModel>>> models = {
+    {"channel_three_gpp", three_gpp},
+    {"channel_three_gpp_cached", CachedLoss (three_gpp, 0)},
+    {"channel_log_distance", log_distance},
+    {"channel_log_distance_cached", CachedLoss (log_distance, 0)},
+    {"channel_log_distance_nakagami", log_distance_nakagami},
+    {"channel_log_distance_nakagami_cached", CachedLoss (CreateObject<ThreeLogDistancePropagationLossModel> (),
+                                                         CreateObject<NakagamiPropagationLossModel> ())},
+  };
+  for (auto &model : models)
+    {
+      if (!filter.empty () && model.first.find (filter) == std::string::npos)
+        {
+          continue;
+        }
+      Ptr<PropagationLossModel> loss = model.second;
+      //one frame of every node first, so the per link state of the 3GPP model and the cache are set up
+      for (uint32_t sender = 0; sender < nodes; sender++)
+        {
+          for (uint32_t receiver = 0; receiver < nodes; receiver++)
+            {
+              if (receiver != sender)
+                {
+                  g_sink += loss->CalcRxPower (14, mobilities[sender], mobilities[receiver]);
+                }
+            }
+        }
+      Benchmark (model.first, nodes, [&] (uint64_t i) {
+        uint32_t sender = i % nodes;
+        double rx_power_sum = 0;
+        for (uint32_t receiver = 0; receiver < nodes; receiver++)
+          {
+            if (receiver != sender)
+              {
+                rx_power_sum += loss->CalcRxPower (14, mobilities[sender], mobilities[receiver]);
+              }
+          }
+        g_sink += rx_power_sum;
+      });
+    }
+}
+
+static void
+PrintJson (std::ostream &os)
+{
+  os << "{\"label\": \"" << label << "\", \"min_time_ms\": " << minTimeMs << ", \"benchmarks\": [";
+  for (std::size_t i = 0; i < results.size (); i++)
+    {
+      const BenchmarkResult &r = results[i];
+      os << (i == 0 ? "" : ",") << std::endl
+         << "  {\"name\": \"" << r.name << "\", \"param\": " << r.param << ", \"iterations\": " << r.iterations
+         << ", \"ns_per_op\": " << r.ns_per_op << ", \"allocs_per_op\": " << r.allocs_per_op
+         << ", \"bytes_per_op\": " << r.bytes_per_op << "}";
+    }
+  os << "]}" << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("minTimeMs", "Minimum run time of every benchmark [ms]", minTimeMs);
+  cmd.AddValue ("filter", "Only run the benchmarks whose name contains this string", filter);
+  cmd.AddValue ("label", "Label written to the results, e.g. the commit", label);
+  cmd.AddValue ("output", "JSON output file, stdout when empty", output);
+  cmd.AddValue ("mapFile", "Temporary file for the generated FTM map", mapFile);
+  cmd.Parse (argc, argv);
+
+  HeaderBenchmarks ();
+  for (uint32_t dialogs : {1, 16, 128, 254})
+    {
+      SessionDialogs (dialogs);
+    }
+  SessionCalculateRtt (true);
+  SessionCalculateRtt (false);
+  for (uint32_t partners : {1, 16, 128, 1024})
+    {
+      ManagerTables (partners);
+      ManagerRx (partners);
+    }
+  MapAndErrorModelBenchmarks ();
+  for (uint32_t nodes : {16, 128, 1024})
+    {
+      ChannelBenchmarks (nodes);
+    }
+
+  if (output.empty ())
+    {
+      PrintJson (std::cout);
+    }
+  else
+    {
+      std::ofstream file (output);
+      PrintJson (file);
+    }
+  return 0;
+}
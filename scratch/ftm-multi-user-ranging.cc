@@ -0,0 +1,220 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Comparison of multi user FTM ranging with sequential single user FTM sessions.
+ * Based on the "ftm-example.cc" scenario.
+ *
+ * The stations are placed in a circle around the AP. In the sequential mode (--multiUser=0) the stations
+ * run one FTM session after the other with the AP, each with the given number of FTM frames. In the multi
+ * user mode (--multiUser=1) the AP polls all stations together for the same number of rounds. For both modes
+ * the aggregate airtime of all frames, the number of frames, the number of measurements and the simulated
+ * time until the last measurement are printed as one CSV line:
+ *
+ *   mode,stations,rounds,frames,airtime_us,measurements,completion_ms
+ *
+ * The multi user airtime still grows linearly with the stations: one poll of 52 + 19 * stations bytes and
+ * one reply of 40 bytes per station each round, where the sequential mode sends one FTM response of 48 bytes
+ * and its ACK per station and measurement. The sweep below shows the slope of both modes.
+ *
+ * Example:
+ *   for n in 1 2 4 8 16 32; do ./waf --run "ftm-multi-user-ranging --numberOfStations=$n --multiUser=1"; done
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/config.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/ap-wifi-mac.h"
+#include "ns3/ftm-header.h"
+#include "ns3/ftm-manager.h"
+#include "ns3/ftm-error-model.h"
+#include "ns3/wifi-mac-helper.h"
+#include "ns3/wifi-helper.h"
+
+#include <iostream>
+#include <math.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FtmMultiUserRanging");
+
+int numberOfStations = 8;
+double distance = 5;
+bool multiUser = true;
+int rounds = 8;
+int roundInterval = 10; //time between multi user rounds [ms]
+
+uint64_t frames = 0;
+Time airtime = Seconds (0);
+uint64_t measurements = 0;
+Time completion = Seconds (0);
+
+std::vector<Ptr<WifiNetDevice>> wifi_stations;
+Address recvAddr;
+
+void MonitorTx (Ptr<WifiPhy> phy, Ptr<const Packet> packet, uint16_t channelFreqMhz, WifiTxVector txVector,
+                MpduInfo aMpdu, uint16_t staId)
+{
+  frames++;
+  airtime += phy->CalculateTxDuration (packet->GetSize (), txVector, phy->GetPhyBand ());
+}
+
+void StartSession (uint32_t sta_index);
+
+void SessionOver (uint32_t sta_index, FtmSession session)
+{
+  measurements += session.GetIndividualRTT ().size ();
+  completion = Simulator::Now ();
+  if (!multiUser && sta_index + 1 < wifi_stations.size ())
+    {
+      //session is removed from the manager after this callback, so start the next one a bit later
+      Simulator::Schedule (MilliSeconds (1), &StartSession, sta_index + 1);
+    }
+}
+
+Ptr<WiredFtmErrorModel> CreateErrorModel (void)
+{
+  Ptr<WiredFtmErrorModel> error_model = CreateObject<WiredFtmErrorModel> ();
+  error_model->SetChannelBandwidth (WiredFtmErrorModel::Channel_20_MHz);
+  return error_model;
+}
+
+void StartSession (uint32_t sta_index)
+{
+  Ptr<RegularWifiMac> sta_mac = wifi_stations[sta_index]->GetMac ()->GetObject<RegularWifiMac> ();
+  Ptr<FtmSession> session = sta_mac->NewFtmSession (Mac48Address::ConvertFrom (recvAddr));
+  if (session == 0)
+    {
+      NS_FATAL_ERROR ("Could not create FTM session");
+    }
+
+  FtmParams ftm_params;
+  ftm_params.SetStatusIndication (FtmParams::RESERVED);
+  ftm_params.SetNumberOfBurstsExponent (0); //1 burst
+  //burst duration 11 with 1 ms spacing did not start in earlier sweeps, see FtmParamsFeasibility
+  ftm_params.SetBurstDuration (10); //64 ms burst duration
+  ftm_params.SetMinDeltaFtm (10); //1 ms between frames
+  ftm_params.SetPartialTsfNoPref (true);
+  ftm_params.SetAsap (true);
+  ftm_params.SetFtmsPerBurst (rounds);
+  ftm_params.SetBurstPeriod (0);
+  session->SetFtmParams (ftm_params);
+
+  session->SetFtmErrorModel (CreateErrorModel ());
+  session->SetSessionOverCallback (MakeBoundCallback (&SessionOver, sta_index));
+  session->SessionBegin ();
+}
+
+int main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("numberOfStations", "Number of initiating stations", numberOfStations);
+  cmd.AddValue ("distance", "Distance of the stations to the AP [m]", distance);
+  cmd.AddValue ("multiUser", "Multi user ranging (1) or sequential single user sessions (0)", multiUser);
+  cmd.AddValue ("rounds", "Number of multi user rounds or FTM frames per single user session", rounds);
+  cmd.AddValue ("roundInterval", "Time between multi user rounds [ms]", roundInterval);
+  cmd.Parse (argc, argv);
+
+  //enable FTM through attribute system
+  Config::SetDefault ("ns3::RegularWifiMac::FTM_Enabled", BooleanValue (true));
+
+  NodeContainer c;
+  c.Create (numberOfStations + 1); // 1 for the AP
+
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211n_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager");
+
+  YansWifiPhyHelper wifiPhy;
+  wifiPhy.Set ("RxGain", DoubleValue (0));
+
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::ThreeGppIndoorOfficePropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+
+  WifiMacHelper wifiMac;
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, c);
+
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0.0, 0.0, 0.0));
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      double angle = 2 * M_PI * i / numberOfStations;
+      positionAlloc->Add (Vector (distance * cos (angle), distance * sin (angle), 0));
+    }
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (c);
+
+  Ptr<WifiNetDevice> wifi_ap = devices.Get (0)->GetObject<WifiNetDevice> ();
+  recvAddr = wifi_ap->GetAddress ();
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      wifi_stations.push_back (devices.Get (i + 1)->GetObject<WifiNetDevice> ());
+    }
+
+  for (uint32_t i = 0; i < devices.GetN (); i++)
+    {
+      Ptr<WifiPhy> phy = devices.Get (i)->GetObject<WifiNetDevice> ()->GetPhy ();
+      phy->TraceConnectWithoutContext ("MonitorSnifferTx", MakeBoundCallback (&MonitorTx, phy));
+    }
+
+  if (multiUser)
+    {
+      std::list<Mac48Address> group;
+      for (uint32_t i = 0; i < wifi_stations.size (); i++)
+        {
+          Ptr<FtmManager> manager = FtmManager::GetFtmManager (wifi_stations[i]->GetPhy ());
+          Ptr<FtmSession> session = manager->JoinMultiUserRanging (Mac48Address::ConvertFrom (recvAddr));
+          session->SetFtmErrorModel (CreateErrorModel ());
+          session->SetSessionOverCallback (MakeBoundCallback (&SessionOver, i));
+          group.push_back (Mac48Address::ConvertFrom (wifi_stations[i]->GetAddress ()));
+        }
+      Ptr<FtmManager> ap_manager = FtmManager::GetFtmManager (wifi_ap->GetPhy ());
+      Time spacing = MicroSeconds (200);
+      if (MilliSeconds (roundInterval) <= spacing * numberOfStations)
+        {
+          NS_FATAL_ERROR ("The round interval is too short for the replies of all stations");
+        }
+      ap_manager->SetAttribute ("MultiUserReplySpacing", TimeValue (spacing));
+      ap_manager->StartMultiUserRanging (group, rounds, MilliSeconds (roundInterval));
+    }
+  else
+    {
+      Simulator::ScheduleNow (&StartSession, 0);
+    }
+
+  //set time resolution to pico seconds for the time stamps, as default is in nano seconds. IMPORTANT
+  Time::SetResolution (Time::PS);
+
+  Simulator::Stop (Seconds (1000));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  std::cout << (multiUser ? "multi_user" : "sequential") << "," << numberOfStations << "," << rounds << ","
+            << frames << "," << airtime.GetMicroSeconds () << "," << measurements << ","
+            << completion.GetMilliSeconds () << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,119 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Enumerates the feasible FTM parameter combinations of a sweep, using the same feasibility table as
+ * FtmSession::ValidateFtmParams. Every parameter takes a comma separated list of values, the defaults are the
+ * ones of "ftm-example.cc". The feasible combinations are printed as CSV to stdout, the infeasible ones with the
+ * reason to stderr:
+ *
+ *   numberOfBurstsExponent,burstDuration,minDeltaFtm,ftmsPerBurst
+ *
+ * The values are printed as given, so they can be passed to "ftm-example.cc" as they are. Like "ftm-example.cc",
+ * the min delta FTM is truncated to its 8 bit field before the check.
+ *
+ * Example:
+ *   ./waf --run "ftm-params-feasibility --burstDuration=5,11 --minDeltaFtm=5,10,320,640 --ftmsPerBurst=1,2,3"
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/log.h"
+#include "ns3/ftm-header.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FtmParamsFeasibilityTool");
+
+std::string numberOfBurstsExponent = "1";
+std::string burstDuration = "11";
+std::string minDeltaFtm = "640";
+std::string ftmsPerBurst = "2";
+
+std::vector<int> ParseList (std::string name, std::string list)
+{
+  std::vector<int> values;
+  std::stringstream stream (list);
+  std::string value;
+  while (std::getline (stream, value, ','))
+    {
+      try
+        {
+          values.push_back (std::stoi (value));
+        }
+      catch (const std::exception &e)
+        {
+          NS_FATAL_ERROR ("Invalid value \"" << value << "\" for " << name);
+        }
+    }
+  return values;
+}
+
+int main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("numberOfBurstsExponent", "Comma separated list of number of bursts exponents", numberOfBurstsExponent);
+  cmd.AddValue ("burstDuration", "Comma separated list of burst durations", burstDuration);
+  cmd.AddValue ("minDeltaFtm", "Comma separated list of min delta FTMs [100 us]", minDeltaFtm);
+  cmd.AddValue ("ftmsPerBurst", "Comma separated list of FTMs per burst", ftmsPerBurst);
+  cmd.Parse (argc, argv);
+
+  std::vector<int> bursts_exponents = ParseList ("numberOfBurstsExponent", numberOfBurstsExponent);
+  std::vector<int> burst_durations = ParseList ("burstDuration", burstDuration);
+  std::vector<int> min_delta_ftms = ParseList ("minDeltaFtm", minDeltaFtm);
+  std::vector<int> ftms_per_bursts = ParseList ("ftmsPerBurst", ftmsPerBurst);
+
+  for (int min_delta_ftm : min_delta_ftms)
+    {
+      if (static_cast<uint8_t> (min_delta_ftm) != min_delta_ftm)
+        {
+          std::cerr << "warning: minDeltaFtm=" << min_delta_ftm << " does not fit into 8 bit and is used as "
+                    << static_cast<int> (static_cast<uint8_t> (min_delta_ftm)) << std::endl;
+        }
+    }
+
+  std::cout << "numberOfBurstsExponent,burstDuration,minDeltaFtm,ftmsPerBurst" << std::endl;
+  for (int bursts_exponent : bursts_exponents)
+    {
+      for (int burst_duration : burst_durations)
+        {
+          for (int min_delta_ftm : min_delta_ftms)
+            {
+              for (int ftms_per_burst : ftms_per_bursts)
+                {
+                  FtmParamsFeasibility::Result result = FtmParamsFeasibility::Check (burst_duration, min_delta_ftm,
+                                                                                     ftms_per_burst, bursts_exponent == 0);
+                  if (result == FtmParamsFeasibility::FEASIBLE)
+                    {
+                      std::cout << bursts_exponent << "," << burst_duration << "," << min_delta_ftm << ","
+                                << ftms_per_burst << std::endl;
+                    }
+                  else
+                    {
+                      std::cerr << "skip " << bursts_exponent << "," << burst_duration << "," << min_delta_ftm << ","
+                                << ftms_per_burst << ": " << FtmParamsFeasibility::GetDescription (result) << std::endl;
+                    }
+                }
+            }
+        }
+    }
+
+  return 0;
+}
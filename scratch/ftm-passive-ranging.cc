@@ -0,0 +1,199 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Scaling benchmark for the passive FTM ranging mode.
+ * Based on the "ftm-example.cc" scenario.
+ *
+ * The stations are placed in a circle around the AP. In the session mode (--passive=0) every station
+ * runs its own FTM sessions with the AP back to back. In the passive mode (--passive=1) the AP broadcasts
+ * FTM frames and all stations only listen. For both modes the number of frames sent by the AP, the number
+ * of measurements and the wall clock time are printed as one CSV line:
+ *
+ *   mode,stations,duration_s,responder_tx_frames,measurements,wall_ms
+ *
+ * Example:
+ *   for n in 1 4 16 64 128; do ./waf --run "ftm-passive-ranging --numberOfStations=$n --passive=1"; done
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/config.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/ap-wifi-mac.h"
+#include "ns3/ftm-header.h"
+#include "ns3/ftm-manager.h"
+#include "ns3/ftm-error-model.h"
+#include "ns3/wifi-mac-helper.h"
+#include "ns3/wifi-helper.h"
+
+#include <iostream>
+#include <chrono>
+#include <math.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FtmPassiveRanging");
+
+int numberOfStations = 16;
+double distance = 5;
+double duration = 10;
+bool passive = true;
+int passiveInterval = 10; //time between broadcast FTM frames [ms]
+
+uint64_t responder_tx_frames = 0;
+uint64_t measurements = 0;
+
+std::vector<Ptr<WifiNetDevice>> wifi_stations;
+Address recvAddr;
+
+void ResponderTx (Ptr<const Packet> packet, double power)
+{
+  responder_tx_frames++;
+}
+
+void PassiveMeasurement (Mac48Address responder, int64_t time_difference)
+{
+  measurements++;
+}
+
+void StartSession (uint32_t sta_index);
+
+void SessionOver (uint32_t sta_index, FtmSession session)
+{
+  measurements += session.GetIndividualRTT ().size ();
+  //session is removed from the manager after this callback, so start the next one a bit later
+  Simulator::Schedule (MilliSeconds (10), &StartSession, sta_index);
+}
+
+void StartSession (uint32_t sta_index)
+{
+  Ptr<RegularWifiMac> sta_mac = wifi_stations[sta_index]->GetMac ()->GetObject<RegularWifiMac> ();
+  Ptr<FtmSession> session = sta_mac->NewFtmSession (Mac48Address::ConvertFrom (recvAddr));
+  if (session == 0)
+    {
+      Simulator::Schedule (MilliSeconds (10), &StartSession, sta_index);
+      return;
+    }
+
+  FtmParams ftm_params;
+  ftm_params.SetStatusIndication (FtmParams::RESERVED);
+  ftm_params.SetNumberOfBurstsExponent (1); //2 bursts
+  ftm_params.SetBurstDuration (7); //8 ms burst duration
+  ftm_params.SetMinDeltaFtm (10); //1 ms between frames
+  ftm_params.SetPartialTsfNoPref (true);
+  ftm_params.SetAsap (true);
+  ftm_params.SetFtmsPerBurst (2);
+  ftm_params.SetBurstPeriod (1); //100 ms between burst periods
+  session->SetFtmParams (ftm_params);
+
+  session->SetSessionOverCallback (MakeBoundCallback (&SessionOver, sta_index));
+  session->SessionBegin ();
+}
+
+int main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("numberOfStations", "Number of listening/initiating stations", numberOfStations);
+  cmd.AddValue ("distance", "Distance of the stations to the AP [m]", distance);
+  cmd.AddValue ("duration", "Simulated time [s]", duration);
+  cmd.AddValue ("passive", "Passive broadcast ranging (1) or one session per station (0)", passive);
+  cmd.AddValue ("passiveInterval", "Time between broadcast FTM frames [ms]", passiveInterval);
+  cmd.Parse (argc, argv);
+
+  auto wall_start = std::chrono::steady_clock::now ();
+
+  //enable FTM through attribute system
+  Config::SetDefault ("ns3::RegularWifiMac::FTM_Enabled", BooleanValue (true));
+
+  NodeContainer c;
+  c.Create (numberOfStations + 1); // 1 for the AP
+
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211n_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager");
+
+  YansWifiPhyHelper wifiPhy;
+  wifiPhy.Set ("RxGain", DoubleValue (0));
+
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::ThreeGppIndoorOfficePropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+
+  WifiMacHelper wifiMac;
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, c);
+
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0.0, 0.0, 0.0));
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      double angle = 2 * M_PI * i / numberOfStations;
+      positionAlloc->Add (Vector (distance * cos (angle), distance * sin (angle), 0));
+    }
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (c);
+
+  Ptr<WifiNetDevice> wifi_ap = devices.Get (0)->GetObject<WifiNetDevice> ();
+  recvAddr = wifi_ap->GetAddress ();
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      wifi_stations.push_back (devices.Get (i + 1)->GetObject<WifiNetDevice> ());
+    }
+
+  wifi_ap->GetPhy ()->TraceConnectWithoutContext ("PhyTxBegin", MakeCallback (&ResponderTx));
+
+  if (passive)
+    {
+      for (Ptr<WifiNetDevice> sta : wifi_stations)
+        {
+          Ptr<FtmManager> manager = FtmManager::GetFtmManager (sta->GetPhy ());
+          manager->EnablePassiveListening (MakeCallback (&PassiveMeasurement));
+          Ptr<WiredFtmErrorModel> error_model = CreateObject<WiredFtmErrorModel> ();
+          error_model->SetChannelBandwidth (WiredFtmErrorModel::Channel_20_MHz);
+          manager->SetPassiveFtmErrorModel (error_model);
+        }
+      Ptr<FtmManager> ap_manager = FtmManager::GetFtmManager (wifi_ap->GetPhy ());
+      ap_manager->StartPassiveRanging (MilliSeconds (passiveInterval));
+    }
+  else
+    {
+      for (int i = 0; i < numberOfStations; i++)
+        {
+          Simulator::Schedule (MilliSeconds (i), &StartSession, i);
+        }
+    }
+
+  //set time resolution to pico seconds for the time stamps, as default is in nano seconds. IMPORTANT
+  Time::SetResolution (Time::PS);
+
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  auto wall_ms = std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::steady_clock::now () - wall_start).count ();
+  std::cout << (passive ? "passive" : "sessions") << "," << numberOfStations << "," << duration << ","
+            << responder_tx_frames << "," << measurements << "," << wall_ms << std::endl;
+
+  return 0;
+}
@@ -20,6 +20,15 @@
  * Based on the "wifi-simple-infra.cc" example.
  * Modified by Christos Laskos.
  * 2022
+ *
+ * The station ranges with the AP from 180 positions on a circle. The positions are independent, so every
+ * position is simulated in its own child process, starting from the same parent state, with RngRun and
+ * error model seed --firstRun + position. Up to --workers children run at the same time and their
+ * measurements are appended to --filename in the order of the positions, so the output does not depend
+ * on the number of workers.
+ *
+ * Example:
+ *   ./waf --run "ftm-ranging --error=3 --filename=ftm_ranging/sig_str_fading.txt --workers=$(nproc)"
  */
 
 #include "ns3/command-line.h"
@@ -41,7 +50,15 @@
 #include "ns3/ftm-header.h"
 #include "ns3/mgt-headers.h"
 #include "ns3/ftm-error-model.h"
+#include "ns3/ftm-cached-propagation-loss-model.h"
+#include "ns3/propagation-loss-model.h"
 #include "ns3/pointer.h"
+#include "ns3/rng-seed-manager.h"
+
+#include <fstream>
+#include <cstdio>
+
+#include "ftm-fork-pool.h"
 
 
 using namespace ns3;
@@ -53,6 +70,10 @@ std::string file_name = "ftm_ranging/tmp.txt";
 double circle_positions[180][2] = {};
 int position_index = 0;
 int total_positions = 180;
+bool cache_propagation_loss = true;
+int workers = 1;
+uint32_t first_run = 1;
+std::string position_file_name; //output of the position simulated in this process
 
 void SessionOver (FtmSession session)
 {
@@ -63,7 +84,7 @@ void SessionOver (FtmSession session)
   std::list<int64_t> rtts = session.GetIndividualRTT();
   std::list<double> sig_strs = session.GetIndividualSignalStrength();
 
-  std::ofstream output (file_name, std::ofstream::out | std::ofstream::app);
+  std::ofstream output (position_file_name, std::ofstream::out | std::ofstream::app);
   while (!rtts.empty())
     {
       output << rtts.front() << " " << sig_strs.front() << "\n";
@@ -71,6 +92,9 @@ void SessionOver (FtmSession session)
       sig_strs.pop_front();
     }
   output.close();
+
+  //one session per position, the process is done
+  Simulator::Stop ();
 }
 
 void ChangePosition (Ptr<Node> sta) {
@@ -81,8 +105,6 @@ void ChangePosition (Ptr<Node> sta) {
   position.y = circle_positions[position_index][1];
   position.z = 0;
 
-  position_index++;
-
   mobility->SetPosition(position);
 }
 
@@ -105,14 +127,14 @@ static void GenerateTraffic (Ptr<WifiNetDevice> ap, Ptr<WifiNetDevice> sta, Addr
   Ptr<FtmErrorModel> error_model;
   if (selected_error_mode == 0) {
       //create the wired error model
-      Ptr<WiredFtmErrorModel> wired_error = CreateObject<WiredFtmErrorModel> ();
+      Ptr<WiredFtmErrorModel> wired_error = CreateObject<WiredFtmErrorModel> (first_run + position_index);
       wired_error->SetChannelBandwidth(WiredFtmErrorModel::Channel_20_MHz);
       error_model = wired_error;
   }
   else if (selected_error_mode == 1) {
       //create wireless error model
       //map has to be created prior
-      Ptr<WirelessFtmErrorModel> wireless_error = CreateObject<WirelessFtmErrorModel> ();
+      Ptr<WirelessFtmErrorModel> wireless_error = CreateObject<WirelessFtmErrorModel> (first_run + position_index);
       wireless_error->SetFtmMap(map);
       wireless_error->SetNode(sta->GetNode());
       wireless_error->SetChannelBandwidth(WiredFtmErrorModel::Channel_20_MHz);
@@ -121,7 +143,7 @@ static void GenerateTraffic (Ptr<WifiNetDevice> ap, Ptr<WifiNetDevice> sta, Addr
   else if (selected_error_mode == 2 || selected_error_mode == 3) {
       //create wireless signal strength error model
       //map has to be created prior
-      Ptr<WirelessSigStrFtmErrorModel> wireless_sig_str_error = CreateObject<WirelessSigStrFtmErrorModel> ();
+      Ptr<WirelessSigStrFtmErrorModel> wireless_sig_str_error = CreateObject<WirelessSigStrFtmErrorModel> (first_run + position_index);
       wireless_sig_str_error->SetFtmMap(map);
       wireless_sig_str_error->SetNode(sta->GetNode());
       wireless_sig_str_error->SetChannelBandwidth(WiredFtmErrorModel::Channel_20_MHz);
@@ -149,11 +171,6 @@ static void GenerateTraffic (Ptr<WifiNetDevice> ap, Ptr<WifiNetDevice> sta, Addr
 
   session->SetSessionOverCallback(MakeCallback(&SessionOver));
   session->SessionBegin();
-
-  if (position_index < total_positions)
-    {
-      Simulator::Schedule(Seconds (5), &GenerateTraffic, ap, sta, recvAddr);
-    }
 }
 
 void generateCirclePositions(double r)
@@ -167,18 +184,13 @@ void generateCirclePositions(double r)
   }
 }
 
-int main (int argc, char *argv[])
+/*
+ * Simulates the session of one position, called in the child process.
+ */
+static void RunPosition (int index)
 {
-  //double rss = -80;  // -dBm
-  double distance = 1;
-
-  CommandLine cmd (__FILE__);
-  cmd.AddValue ("distance", "Node Distance", distance);
-  cmd.AddValue ("error", "Currently Selected Error Mode", selected_error_mode);
-  cmd.AddValue ("filename", "Used File Name for Saving", file_name);
-  cmd.Parse (argc, argv);
-
-  generateCirclePositions(distance);
+  position_index = index;
+  RngSeedManager::SetRun (first_run + index);
 
   //enable FTM through attribute system
   Config::SetDefault ("ns3::RegularWifiMac::FTM_Enabled", BooleanValue(true));
@@ -210,6 +222,14 @@ int main (int argc, char *argv[])
       // of the distance between the two stations, and the transmit power
       wifiChannel.AddPropagationLoss ("ns3::FixedRssLossModel","Rss",DoubleValue (-40));
   }
+  else if (cache_propagation_loss && (selected_error_mode == 2 || selected_error_mode == 3)) {
+      //the path loss is calculated again only when the station moves to the next position,
+      //the fading of mode 3 is still drawn for every frame
+      wifiChannel.AddPropagationLoss ("ns3::FtmCachedPropagationLossModel",
+                                      "Model", PointerValue (CreateObject<ThreeLogDistancePropagationLossModel> ()));
+      if (selected_error_mode == 3)
+        wifiChannel.AddPropagationLoss ("ns3::NakagamiPropagationLossModel");
+  }
   else if (selected_error_mode == 2) {
       wifiChannel.AddPropagationLoss ("ns3::ThreeLogDistancePropagationLossModel");
   }
@@ -263,7 +283,60 @@ int main (int argc, char *argv[])
 //  ap_mac->EnableFtm();
 //  sta_mac->EnableFtm();
 
-  //load FTM map for usage
+  // Tracing
+//  wifiPhy.EnablePcap ("ftm-ranging", devices);
+
+  Simulator::ScheduleNow (&GenerateTraffic, wifi_ap, wifi_sta, recvAddr);
+
+  //the sequential run gave every position 5 s until the next one started
+  Simulator::Stop (Seconds (5.0));
+  Simulator::Run ();
+}
+
+/*
+ * Simulates one position in a child of the fork pool, the measurements are written to its own file.
+ */
+static int RunPositionJob (std::size_t index, int fd)
+{
+  position_file_name = file_name + ".position" + std::to_string (index);
+  std::remove (position_file_name.c_str ());
+  RunPosition (index);
+  return 0;
+}
+
+/*
+ * Appends the output of one position to the output file and removes it.
+ */
+static bool AppendPositionFile (const std::string &part_name, std::ofstream &output)
+{
+  std::ifstream part (part_name);
+  if (!part.is_open ())
+    {
+      //no measurement at this position
+      return true;
+    }
+  output << part.rdbuf ();
+  part.close ();
+  return std::remove (part_name.c_str ()) == 0;
+}
+
+int main (int argc, char *argv[])
+{
+  //double rss = -80;  // -dBm
+  double distance = 1;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("distance", "Node Distance", distance);
+  cmd.AddValue ("error", "Currently Selected Error Mode", selected_error_mode);
+  cmd.AddValue ("filename", "Used File Name for Saving", file_name);
+  cmd.AddValue ("cachePropagationLoss", "Calculate the path loss once per position (1) or for every frame (0)", cache_propagation_loss);
+  cmd.AddValue ("workers", "Number of positions simulated at the same time", workers);
+  cmd.AddValue ("firstRun", "RngRun and error model seed of the first position", first_run);
+  cmd.Parse (argc, argv);
+
+  generateCirclePositions(distance);
+
+  //load FTM map for usage, before forking so every child uses the loaded map
   map = CreateObject<WirelessFtmErrorModel::FtmMap> ();
   if (selected_error_mode != 0) {
       map->LoadMap ("src/wifi/ftm_map/FTM_Wireless_Error.map");
@@ -271,17 +344,22 @@ int main (int argc, char *argv[])
   //set FTM map through attribute system
 //  Config::SetDefault ("ns3::WirelessFtmErrorModel::FtmMap", PointerValue (map));
 
-  // Tracing
-//  wifiPhy.EnablePcap ("ftm-ranging", devices);
-
-  Simulator::ScheduleNow (&GenerateTraffic, wifi_ap, wifi_sta, recvAddr);
-
   //set time resolution to pico seconds for the time stamps, as default is in nano seconds. IMPORTANT
   Time::SetResolution(Time::PS);
 
-  Simulator::Stop (Seconds (1000.0));
-  Simulator::Run ();
-  Simulator::Destroy ();
+  bool failed = !RunFtmForkPool (total_positions, "position", workers, MakeCallback (&RunPositionJob),
+                                 MakeNullCallback<bool, std::size_t, int, bool, double> ());
 
-  return 0;
+  //merge in the order of the positions
+  std::ofstream output (file_name, std::ofstream::out | std::ofstream::app);
+  for (int i = 0; i < total_positions; i++)
+    {
+      if (!AppendPositionFile (file_name + ".position" + std::to_string (i), output))
+        {
+          failed = true;
+        }
+    }
+  output.close();
+
+  return failed ? 1 : 0;
 }
@@ -0,0 +1,458 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Replication driver for the "ftm-example.cc" scenario.
+ *
+ * The topology (nodes, channel, PHY/MAC, internet stack, ARP cache and FTM map) is built once.
+ * Afterwards a child process is forked for every replication point, so it starts from a copy-on-write
+ * image of the already built world. The child applies the overrides of its point (RngRun, distance
+ * of the stations and ftmsPerBurst), runs one FTM session per station and sends the result back to
+ * the parent over a pipe. A replication point is every combination of the runs
+ * [firstRun, firstRun + replications) with the comma separated --distances and --ftmsPerBurst lists.
+ *
+ * With --coldStart=1 the child is forked before anything is built and builds the whole topology
+ * itself, which is the cost every replication of simulationTool.py pays (minus process start-up).
+ * Both modes assign the random streams of the devices and the channel after setting the run number,
+ * so a given point produces the same measurements in both modes.
+ *
+ * One CSV line is printed per replication point, in the order of the points:
+ *
+ *   mode,stations,run,distance,ftms_per_burst,measurements,mean_rtt_ps,setup_ms,run_ms,wall_ms
+ *
+ * setup_ms is the time the child spent before Simulator::Run (building the topology for a cold start,
+ * applying the overrides otherwise), run_ms the simulation time and wall_ms the time from the fork
+ * until the child was reaped. The one-time build of the parent is reported on stderr.
+ *
+ * Example:
+ *   for n in 1 16 128; do
+ *     ./waf --run "ftm-replication-server --numberOfStations=$n --replications=16 --coldStart=0";
+ *     ./waf --run "ftm-replication-server --numberOfStations=$n --replications=16 --coldStart=1";
+ *   done
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/config.h"
+#include "ns3/double.h"
+#include "ns3/pointer.h"
+#include "ns3/log.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/yans-wifi-channel.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/ipv4-interface.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/arp-cache.h"
+#include "ns3/object-vector.h"
+#include "ns3/node-list.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/ftm-header.h"
+#include "ns3/ftm-manager.h"
+#include "ns3/ftm-error-model.h"
+#include "ns3/wifi-mac-helper.h"
+#include "ns3/wifi-helper.h"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <math.h>
+#include <unistd.h>
+
+#include "ftm-fork-pool.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FtmReplicationServer");
+
+int numberOfStations = 16;
+int replications = 8;
+int firstRun = 1;
+int jobs = 1;
+bool coldStart = false;
+double duration = 2;
+int channelBandwidth = 20;
+std::string distances = "5";
+std::string ftmsPerBurstList = "2";
+std::string mapFile = "";
+
+//FTM params that are not overridden per point, same defaults as ftm-passive-ranging
+int numberOfBurstsExponent = 1; //2 bursts
+int burstDuration = 7; //8 ms
+int minDeltaFtm = 10; //1 ms between frames
+int burstPeriod = 1; //100 ms between burst periods
+
+struct ReplicationPoint
+{
+  uint32_t run;
+  double distance;
+  int ftms_per_burst;
+};
+
+//sent from the child to the parent, plain data so it can be written to the pipe as is
+struct ReplicationResult
+{
+  uint64_t measurements;
+  double rtt_sum;
+  double setup_ms;
+  double run_ms;
+};
+
+struct Topology
+{
+  NodeContainer nodes;
+  NetDeviceContainer devices;
+  Ptr<YansWifiChannel> channel;
+  Ptr<WifiNetDevice> ap;
+  std::vector<Ptr<WifiNetDevice>> stations;
+  Ptr<WirelessFtmErrorModel::FtmMap> map;
+};
+
+Topology topology;
+ReplicationResult result;
+std::vector<ReplicationPoint> points;
+//filled in the parent, in the order of the points
+std::vector<ReplicationResult> replication_results;
+std::vector<double> replication_wall_ms;
+
+static double
+MillisecondsSince (std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - start).count ();
+}
+
+static std::vector<std::string>
+SplitList (const std::string &list)
+{
+  std::vector<std::string> items;
+  std::stringstream stream (list);
+  std::string item;
+  while (std::getline (stream, item, ','))
+    {
+      if (!item.empty ())
+        {
+          items.push_back (item);
+        }
+    }
+  return items;
+}
+
+// same as in ftm-example.cc
+static void
+PopulateARPcache ()
+{
+  Ptr<ArpCache> arp = CreateObject<ArpCache> ();
+  arp->SetAliveTimeout (Seconds (3600 * 24 * 365));
+
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      Ptr<Ipv4L3Protocol> ip = (*i)->GetObject<Ipv4L3Protocol> ();
+      NS_ASSERT (ip != 0);
+      ObjectVectorValue interfaces;
+      ip->GetAttribute ("InterfaceList", interfaces);
+
+      for (ObjectVectorValue::Iterator j = interfaces.Begin (); j != interfaces.End (); j++)
+        {
+          Ptr<Ipv4Interface> ipIface = (*j).second->GetObject<Ipv4Interface> ();
+          NS_ASSERT (ipIface != 0);
+          Ptr<NetDevice> device = ipIface->GetDevice ();
+          NS_ASSERT (device != 0);
+          Mac48Address addr = Mac48Address::ConvertFrom (device->GetAddress ());
+
+          for (uint32_t k = 0; k < ipIface->GetNAddresses (); k++)
+            {
+              Ipv4Address ipAddr = ipIface->GetAddress (k).GetLocal ();
+              if (ipAddr == Ipv4Address::GetLoopback ())
+                continue;
+
+              ArpCache::Entry *entry = arp->Add (ipAddr);
+              Ipv4Header ipv4Hdr;
+              ipv4Hdr.SetDestination (ipAddr);
+              Ptr<Packet> p = Create<Packet> (100);
+              entry->MarkWaitReply (ArpCache::Ipv4PayloadHeaderPair (p, ipv4Hdr));
+              entry->MarkAlive (addr);
+            }
+        }
+    }
+
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      Ptr<Ipv4L3Protocol> ip = (*i)->GetObject<Ipv4L3Protocol> ();
+      NS_ASSERT (ip != 0);
+      ObjectVectorValue interfaces;
+      ip->GetAttribute ("InterfaceList", interfaces);
+
+      for (ObjectVectorValue::Iterator j = interfaces.Begin (); j != interfaces.End (); j++)
+        {
+          Ptr<Ipv4Interface> ipIface = (*j).second->GetObject<Ipv4Interface> ();
+          ipIface->SetAttribute ("ArpCache", PointerValue (arp));
+        }
+    }
+}
+
+/*
+ * Builds the ftm-example world. All nodes start at the origin, PlaceStations puts the stations in
+ * a circle around the AP for the distance of a replication point.
+ */
+static void
+BuildTopology ()
+{
+  Config::SetDefault ("ns3::RegularWifiMac::FTM_Enabled", BooleanValue (true));
+
+  topology.nodes.Create (numberOfStations + 1); // 1 for the AP
+
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211n_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager");
+
+  YansWifiPhyHelper wifiPhy;
+  wifiPhy.Set ("RxGain", DoubleValue (0));
+
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::ThreeGppIndoorOfficePropagationLossModel");
+  topology.channel = wifiChannel.Create ();
+  wifiPhy.SetChannel (topology.channel);
+
+  WifiMacHelper wifiMac;
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  topology.devices = wifi.Install (wifiPhy, wifiMac, topology.nodes);
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (topology.nodes);
+
+  topology.ap = topology.devices.Get (0)->GetObject<WifiNetDevice> ();
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      topology.stations.push_back (topology.devices.Get (i + 1)->GetObject<WifiNetDevice> ());
+    }
+
+  InternetStackHelper stack;
+  stack.Install (topology.nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.0.0", "255.255.0.0");
+  address.Assign (topology.devices);
+  PopulateARPcache ();
+
+  if (!mapFile.empty ())
+    {
+      topology.map = CreateObject<WirelessFtmErrorModel::FtmMap> ();
+      topology.map->LoadMap (mapFile);
+    }
+
+  //set time resolution to pico seconds for the time stamps, as default is in nano seconds. IMPORTANT
+  Time::SetResolution (Time::PS);
+}
+
+static void
+PlaceStations (double distance)
+{
+  topology.ap->GetNode ()->GetObject<MobilityModel> ()->SetPosition (Vector (0.0, 0.0, 0.0));
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      double angle = 2 * M_PI * i / numberOfStations;
+      Ptr<MobilityModel> mobility = topology.stations[i]->GetNode ()->GetObject<MobilityModel> ();
+      mobility->SetPosition (Vector (distance * cos (angle), distance * sin (angle), 0));
+    }
+}
+
+/*
+ * The random variables of the PHYs, MACs and the loss model already hold a stream that was created
+ * with the run number of the parent, so they are assigned again after the run number was set.
+ */
+static void
+ApplyRun (uint32_t run)
+{
+  RngSeedManager::SetRun (run);
+  int64_t stream = 0;
+  WifiHelper wifi;
+  stream += wifi.AssignStreams (topology.devices, stream);
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.AssignStreams (topology.channel, stream);
+}
+
+static void
+SessionOver (FtmSession session)
+{
+  for (int64_t rtt : session.GetIndividualRTT ())
+    {
+      result.rtt_sum += rtt;
+    }
+  result.measurements += session.GetIndividualRTT ().size ();
+}
+
+static void
+StartSession (uint32_t sta_index, ReplicationPoint point)
+{
+  Ptr<WifiNetDevice> sta = topology.stations[sta_index];
+  Ptr<RegularWifiMac> sta_mac = sta->GetMac ()->GetObject<RegularWifiMac> ();
+  Ptr<FtmSession> session = sta_mac->NewFtmSession (Mac48Address::ConvertFrom (topology.ap->GetAddress ()));
+  if (session == 0)
+    {
+      NS_FATAL_ERROR ("ftm not enabled");
+    }
+
+  //seeded from the run, so the replication is reproducible
+  Ptr<WirelessSigStrFtmErrorModel> error_model =
+      CreateObject<WirelessSigStrFtmErrorModel> (point.run * 65536 + sta_index);
+  if (topology.map != 0)
+    {
+      error_model->SetFtmMap (topology.map);
+    }
+  error_model->SetNode (sta->GetNode ());
+  switch (channelBandwidth)
+    {
+    case 40:
+      error_model->SetChannelBandwidth (WiredFtmErrorModel::Channel_40_MHz);
+      break;
+    case 80:
+      error_model->SetChannelBandwidth (WiredFtmErrorModel::Channel_80_MHz);
+      break;
+    case 160:
+      error_model->SetChannelBandwidth (WiredFtmErrorModel::Channel_160_MHz);
+      break;
+    default:
+      error_model->SetChannelBandwidth (WiredFtmErrorModel::Channel_20_MHz);
+      break;
+    }
+  session->SetFtmErrorModel (error_model);
+
+  FtmParams ftm_params;
+  ftm_params.SetStatusIndication (FtmParams::RESERVED);
+  ftm_params.SetNumberOfBurstsExponent (numberOfBurstsExponent);
+  ftm_params.SetBurstDuration (burstDuration);
+  ftm_params.SetMinDeltaFtm (minDeltaFtm);
+  ftm_params.SetPartialTsfNoPref (true);
+  ftm_params.SetAsap (true);
+  ftm_params.SetFtmsPerBurst (point.ftms_per_burst);
+  ftm_params.SetBurstPeriod (burstPeriod);
+  session->SetFtmParams (ftm_params);
+
+  session->SetSessionOverCallback (MakeCallback (&SessionOver));
+  session->SessionBegin ();
+}
+
+/*
+ * Runs one replication point in the child of the fork pool and writes the result to the pipe. The
+ * simulator is not destroyed, the child exits right after writing the result and the parent owns the
+ * built world.
+ */
+static int
+RunReplication (std::size_t index, int fd)
+{
+  const ReplicationPoint &point = points[index];
+  auto setup_start = std::chrono::steady_clock::now ();
+  if (coldStart)
+    {
+      BuildTopology ();
+    }
+  PlaceStations (point.distance);
+  ApplyRun (point.run);
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      Simulator::Schedule (MilliSeconds (i), &StartSession, i, point);
+    }
+  Simulator::Stop (Seconds (duration));
+  result.setup_ms = MillisecondsSince (setup_start);
+
+  auto run_start = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  result.run_ms = MillisecondsSince (run_start);
+
+  bool written = write (fd, &result, sizeof (result)) == sizeof (result);
+  return written ? 0 : 1;
+}
+
+/*
+ * Reads the result of a replication point in the parent.
+ */
+static bool
+ReplicationDone (std::size_t index, int fd, bool exited, double wall_ms)
+{
+  replication_wall_ms[index] = wall_ms;
+  //the result fits into the pipe buffer, so it is already there once the child exited
+  return read (fd, &replication_results[index], sizeof (ReplicationResult)) == sizeof (ReplicationResult);
+}
+
+int main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("numberOfStations", "Number of initiating stations", numberOfStations);
+  cmd.AddValue ("replications", "Number of runs per parameter point", replications);
+  cmd.AddValue ("firstRun", "RngRun of the first replication", firstRun);
+  cmd.AddValue ("jobs", "Number of children running at the same time", jobs);
+  cmd.AddValue ("coldStart", "Build the topology in every child (1) or once in the parent (0)", coldStart);
+  cmd.AddValue ("duration", "Simulated time per replication [s]", duration);
+  cmd.AddValue ("channelBandwidth", "20, 40, 80 or 160 MHz", channelBandwidth);
+  cmd.AddValue ("distances", "Comma separated distances of the stations to the AP [m]", distances);
+  cmd.AddValue ("ftmsPerBurst", "Comma separated FTMs per burst", ftmsPerBurstList);
+  cmd.AddValue ("numberOfBurstsExponent", "1 - 8", numberOfBurstsExponent);
+  cmd.AddValue ("burstDuration", "2 - 11", burstDuration);
+  cmd.AddValue ("minDeltaFtm", "1 - ...", minDeltaFtm);
+  cmd.AddValue ("burstPeriod", "1 - ...", burstPeriod);
+  cmd.AddValue ("map", "FTM map file, no map is used when empty", mapFile);
+  cmd.Parse (argc, argv);
+
+  for (const std::string &d : SplitList (distances))
+    {
+      for (const std::string &f : SplitList (ftmsPerBurstList))
+        {
+          for (int r = 0; r < replications; r++)
+            {
+              points.push_back ({static_cast<uint32_t> (firstRun + r), std::stod (d), std::stoi (f)});
+            }
+        }
+    }
+  if (points.empty ())
+    {
+      std::cerr << "no replication points" << std::endl;
+      return 1;
+    }
+
+  if (!coldStart)
+    {
+      auto build_start = std::chrono::steady_clock::now ();
+      BuildTopology ();
+      std::cerr << "# topology built once in " << MillisecondsSince (build_start) << " ms" << std::endl;
+    }
+
+  replication_results = std::vector<ReplicationResult> (points.size ());
+  replication_wall_ms = std::vector<double> (points.size ());
+  bool failed = !RunFtmForkPool (points.size (), "replication", jobs, MakeCallback (&RunReplication),
+                                 MakeCallback (&ReplicationDone));
+
+  for (std::size_t i = 0; i < points.size (); i++)
+    {
+      const ReplicationResult &r = replication_results[i];
+      double mean_rtt = r.measurements > 0 ? r.rtt_sum / r.measurements : 0;
+      std::cout << (coldStart ? "cold" : "fork") << "," << numberOfStations << "," << points[i].run << ","
+                << points[i].distance << "," << points[i].ftms_per_burst << "," << r.measurements << ","
+                << mean_rtt << "," << r.setup_ms << "," << r.run_ms << "," << replication_wall_ms[i]
+                << std::endl;
+    }
+
+  if (!coldStart)
+    {
+      Simulator::Destroy ();
+    }
+  return failed ? 1 : 0;
+}
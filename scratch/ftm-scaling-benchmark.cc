@@ -0,0 +1,217 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * End-to-end scaling benchmark of the FTM implementation.
+ * Based on the "ftm-example.cc" scenario.
+ *
+ * The stations are placed in a circle around the AP. Every station starts its first FTM session with the AP
+ * at a random time within the first 100 ms and starts the next one as soon as a session is over, until
+ * --duration seconds of simulated time have passed. At the end one CSV line is printed:
+ *
+ *   stations,duration_s,wall_ms,events,events_per_s,peak_rss_kb,sessions_started,sessions_completed,
+ *   sessions_denied,sessions_expired,dialogs_attempted,dialogs_valid,valid_ratio,ftm_frames
+ *
+ * The session and dialog counters are the FtmMetrics of the stations, sessions_denied are the sessions the AP
+ * denied. dialogs_valid are the dialogs with all four time stamps, so a calculated RTT. peak_rss_kb is the peak
+ * resident set size of the process, so run one process per station count. --header prints the header line first.
+ *
+ * Example:
+ *   ./waf --run "ftm-scaling-benchmark --numberOfStations=1 --header=1" > scaling.csv
+ *   for n in 2 4 8 16 32 64 128 256 512 1024; do ./waf --run "ftm-scaling-benchmark --numberOfStations=$n" >> scaling.csv; done
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/config.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/ftm-header.h"
+#include "ns3/ftm-manager.h"
+#include "ns3/ftm-error-model.h"
+#include "ns3/wifi-mac-helper.h"
+#include "ns3/wifi-helper.h"
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <math.h>
+#include <sys/resource.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FtmScalingBenchmark");
+
+int numberOfStations = 16;
+double distance = 5;
+double duration = 10;
+int channelBandwidth = 20;
+bool header = false;
+
+//FTM params, same as ftm-passive-ranging
+int numberOfBurstsExponent = 1; //2 bursts
+int burstDuration = 7; //8 ms
+int minDeltaFtm = 10; //1 ms between frames
+int ftmsPerBurst = 2;
+int burstPeriod = 1; //100 ms between burst periods
+
+uint64_t sessions_started = 0;
+uint64_t sessions_completed = 0;
+
+std::vector<Ptr<WifiNetDevice>> wifi_stations;
+Address recvAddr;
+
+void StartSession (uint32_t sta_index);
+
+void SessionOver (uint32_t sta_index, FtmSession session)
+{
+  sessions_completed++;
+  //session is removed from the manager after this callback, so start the next one a bit later
+  Simulator::Schedule (MilliSeconds (1), &StartSession, sta_index);
+}
+
+void StartSession (uint32_t sta_index)
+{
+  Ptr<RegularWifiMac> sta_mac = wifi_stations[sta_index]->GetMac ()->GetObject<RegularWifiMac> ();
+  Ptr<FtmSession> session = sta_mac->NewFtmSession (Mac48Address::ConvertFrom (recvAddr));
+  if (session == 0)
+    {
+      //partner blocked or session still open, try again later
+      Simulator::Schedule (MilliSeconds (10), &StartSession, sta_index);
+      return;
+    }
+  sessions_started++;
+
+  Ptr<WiredFtmErrorModel> error_model = CreateObject<WiredFtmErrorModel> (sta_index + 1);
+  error_model->SetChannelBandwidth (channelBandwidth == 40 ? WiredFtmErrorModel::Channel_40_MHz
+                                                           : WiredFtmErrorModel::Channel_20_MHz);
+  session->SetFtmErrorModel (error_model);
+
+  FtmParams ftm_params;
+  ftm_params.SetStatusIndication (FtmParams::RESERVED);
+  ftm_params.SetNumberOfBurstsExponent (numberOfBurstsExponent);
+  ftm_params.SetBurstDuration (burstDuration);
+  ftm_params.SetMinDeltaFtm (minDeltaFtm);
+  ftm_params.SetPartialTsfNoPref (true);
+  ftm_params.SetAsap (true);
+  ftm_params.SetFtmsPerBurst (ftmsPerBurst);
+  ftm_params.SetBurstPeriod (burstPeriod);
+  session->SetFtmParams (ftm_params);
+
+  session->SetSessionOverCallback (MakeBoundCallback (&SessionOver, sta_index));
+  session->SessionBegin ();
+}
+
+int main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("numberOfStations", "Number of initiating stations", numberOfStations);
+  cmd.AddValue ("distance", "Distance of the stations to the AP [m]", distance);
+  cmd.AddValue ("duration", "Simulated time [s]", duration);
+  cmd.AddValue ("channelBandwidth", "20 or 40 MHz", channelBandwidth);
+  cmd.AddValue ("numberOfBurstsExponent", "1 - 8", numberOfBurstsExponent);
+  cmd.AddValue ("burstDuration", "2 - 11", burstDuration);
+  cmd.AddValue ("minDeltaFtm", "1 - ...", minDeltaFtm);
+  cmd.AddValue ("ftmsPerBurst", "1 - ...", ftmsPerBurst);
+  cmd.AddValue ("burstPeriod", "1 - ...", burstPeriod);
+  cmd.AddValue ("header", "Print the CSV header line first", header);
+  cmd.Parse (argc, argv);
+
+  auto wall_start = std::chrono::steady_clock::now ();
+
+  //enable FTM through attribute system
+  Config::SetDefault ("ns3::RegularWifiMac::FTM_Enabled", BooleanValue (true));
+
+  NodeContainer c;
+  c.Create (numberOfStations + 1); // 1 for the AP
+
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211n_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager");
+
+  YansWifiPhyHelper wifiPhy;
+  wifiPhy.Set ("RxGain", DoubleValue (0));
+
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::ThreeGppIndoorOfficePropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+
+  WifiMacHelper wifiMac;
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, c);
+
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0.0, 0.0, 0.0));
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      double angle = 2 * M_PI * i / numberOfStations;
+      positionAlloc->Add (Vector (distance * cos (angle), distance * sin (angle), 0));
+    }
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (c);
+
+  Ptr<WifiNetDevice> wifi_ap = devices.Get (0)->GetObject<WifiNetDevice> ();
+  recvAddr = wifi_ap->GetAddress ();
+  //the start times are spread over the first 100 ms, so the stations do not all collide in the first slot
+  std::mt19937 generator (1);
+  std::uniform_int_distribution<int> start_offset (0, 99999);
+  for (int i = 0; i < numberOfStations; i++)
+    {
+      wifi_stations.push_back (devices.Get (i + 1)->GetObject<WifiNetDevice> ());
+      Simulator::Schedule (MicroSeconds (start_offset (generator)), &StartSession, i);
+    }
+
+  //set time resolution to pico seconds for the time stamps, as default is in nano seconds. IMPORTANT
+  Time::SetResolution (Time::PS);
+
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+  uint64_t events = Simulator::GetEventCount ();
+
+  FtmMetrics station_metrics;
+  for (Ptr<WifiNetDevice> sta : wifi_stations)
+    {
+      station_metrics.Merge (FtmManager::GetFtmManager (sta->GetPhy ())->GetMetrics ());
+    }
+  FtmMetrics ap_metrics = FtmManager::GetFtmManager (wifi_ap->GetPhy ())->GetMetrics ();
+  uint64_t ftm_frames = station_metrics.tx_ftm_frames + ap_metrics.tx_ftm_frames;
+  Simulator::Destroy ();
+
+  double wall_ms = std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - wall_start).count ();
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+
+  if (header)
+    {
+      std::cout << "stations,duration_s,wall_ms,events,events_per_s,peak_rss_kb,sessions_started,sessions_completed,"
+                << "sessions_denied,sessions_expired,dialogs_attempted,dialogs_valid,valid_ratio,ftm_frames" << std::endl;
+    }
+  double valid_ratio = station_metrics.dialogs_created > 0
+      ? (double) station_metrics.rtts_calculated / station_metrics.dialogs_created : 0;
+  std::cout << numberOfStations << "," << duration << "," << wall_ms << "," << events << ","
+            << events / (wall_ms / 1000) << "," << usage.ru_maxrss << "," << sessions_started << ","
+            << sessions_completed << "," << ap_metrics.sessions_denied << "," << station_metrics.sessions_expired << ","
+            << station_metrics.dialogs_created << "," << station_metrics.rtts_calculated << "," << valid_ratio << ","
+            << ftm_frames << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,187 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+/*
+ * Allocation benchmark for the FtmSession pool of the FtmManager.
+ * Based on the "ftm-passive-ranging.cc" scenario.
+ *
+ * One station runs short FTM sessions with the AP back to back until the requested number of sessions is
+ * over. All heap allocations of the process are counted through a replaced global operator new, so the
+ * numbers include packets and events. Comparing --poolSize=0 with the default shows the allocations saved
+ * by reusing sessions and dialogs. The result is printed as one CSV line:
+ *
+ *   pool_size,sessions,allocations,allocations_per_1000_sessions,wall_ms
+ *
+ * Example:
+ *   for pool in 0 16; do ./waf --run "ftm-session-pool --sessions=1000 --poolSize=$pool"; done
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/config.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/log.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/ftm-header.h"
+#include "ns3/ftm-manager.h"
+#include "ns3/wifi-mac-helper.h"
+#include "ns3/wifi-helper.h"
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FtmSessionPool");
+
+static uint64_t g_allocations = 0;
+
+void *
+operator new (std::size_t size)
+{
+  g_allocations++;
+  void *ptr = std::malloc (size == 0 ? 1 : size);
+  if (ptr == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return ptr;
+}
+
+void
+operator delete (void *ptr) noexcept
+{
+  std::free (ptr);
+}
+
+void
+operator delete (void *ptr, std::size_t) noexcept
+{
+  std::free (ptr);
+}
+
+uint32_t numberOfSessions = 1000;
+uint32_t poolSize = 16;
+
+uint32_t sessions_over = 0;
+uint64_t allocations_start = 0;
+uint64_t allocations_end = 0;
+
+Ptr<WifiNetDevice> wifi_sta;
+Address recvAddr;
+
+void StartSession (void);
+
+void SessionOver (FtmSession session)
+{
+  sessions_over++;
+  if (sessions_over == numberOfSessions)
+    {
+      allocations_end = g_allocations;
+      Simulator::Stop ();
+      return;
+    }
+  //session is removed from the manager after this callback, so start the next one a bit later
+  Simulator::Schedule (MilliSeconds (1), &StartSession);
+}
+
+void StartSession (void)
+{
+  Ptr<RegularWifiMac> sta_mac = wifi_sta->GetMac ()->GetObject<RegularWifiMac> ();
+  Ptr<FtmSession> session = sta_mac->NewFtmSession (Mac48Address::ConvertFrom (recvAddr));
+  if (session == 0)
+    {
+      Simulator::Schedule (MilliSeconds (1), &StartSession);
+      return;
+    }
+
+  FtmParams ftm_params;
+  ftm_params.SetStatusIndication (FtmParams::RESERVED);
+  ftm_params.SetNumberOfBurstsExponent (0); //1 burst
+  ftm_params.SetBurstDuration (6); //4 ms burst duration
+  ftm_params.SetMinDeltaFtm (4); //400 us between frames
+  ftm_params.SetPartialTsfNoPref (true);
+  ftm_params.SetAsap (true);
+  ftm_params.SetFtmsPerBurst (4);
+  ftm_params.SetBurstPeriod (1);
+  session->SetFtmParams (ftm_params);
+
+  session->SetSessionOverCallback (MakeCallback (&SessionOver));
+  session->SessionBegin ();
+}
+
+int main (int argc, char *argv[])
+{
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("sessions", "Number of sessions to run", numberOfSessions);
+  cmd.AddValue ("poolSize", "SessionPoolSize of the FtmManagers, 0 disables the pool", poolSize);
+  cmd.Parse (argc, argv);
+
+  //enable FTM through attribute system
+  Config::SetDefault ("ns3::RegularWifiMac::FTM_Enabled", BooleanValue (true));
+  Config::SetDefault ("ns3::FtmManager::SessionPoolSize", UintegerValue (poolSize));
+
+  NodeContainer c;
+  c.Create (2);
+
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211n_5GHZ);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager");
+
+  YansWifiPhyHelper wifiPhy;
+  wifiPhy.Set ("RxGain", DoubleValue (0));
+
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::ThreeGppIndoorOfficePropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+
+  WifiMacHelper wifiMac;
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, c);
+
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0.0, 0.0, 0.0));
+  positionAlloc->Add (Vector (5.0, 0.0, 0.0));
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (c);
+
+  recvAddr = devices.Get (0)->GetAddress ();
+  wifi_sta = devices.Get (1)->GetObject<WifiNetDevice> ();
+
+  //set time resolution to pico seconds for the time stamps, as default is in nano seconds. IMPORTANT
+  Time::SetResolution (Time::PS);
+
+  Simulator::ScheduleNow (&StartSession);
+  auto wall_start = std::chrono::steady_clock::now ();
+  allocations_start = g_allocations;
+  Simulator::Run ();
+  auto wall_ms = std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::steady_clock::now () - wall_start).count ();
+  Simulator::Destroy ();
+
+  uint64_t allocations = allocations_end - allocations_start;
+  std::cout << poolSize << "," << sessions_over << "," << allocations << ","
+            << (sessions_over > 0 ? allocations * 1000 / sessions_over : 0) << "," << wall_ms << std::endl;
+
+  return 0;
+}
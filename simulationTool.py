@@ -3,6 +3,8 @@ import numpy as np
 import matplotlib.pyplot as plt
 import random
 import csv
+import json
+import subprocess
 
 # Initialize dictionaries to store results - for Graphs
 mean_rtt_results = {}
@@ -59,6 +61,26 @@ for param_name, param_values in parameters.items():
             new_combinations.append(combo + [(param_name, param_value)])
     param_combinations = new_combinations
 
+# Ask the feasibility table of the FTM implementation which FTM parameter combinations of the sweep are valid,
+# so that no simulation is started with parameters the session would deny.
+# Parameters that are not swept use the defaults of ftm-example.cc.
+feasibility_defaults = {
+    "numberOfBurstsExponent": 1,
+    "burstDuration": 11,
+    "minDeltaFtm": 640,
+    "ftmsPerBurst": 2
+}
+feasibility_params = " ".join(
+    ["--{}={}".format(name, ",".join(str(value) for value in parameters.get(name, [default])))
+     for name, default in feasibility_defaults.items()])
+feasibility_output = subprocess.run('./waf --run "ftm-params-feasibility {}"'.format(feasibility_params),
+                                    shell=True, capture_output=True, text=True, check=True).stdout
+feasible_combinations = set()
+for line in feasibility_output.splitlines():
+    values = line.strip().split(",")
+    if len(values) == 4 and all(value.lstrip("-").isdigit() for value in values):
+        feasible_combinations.add(tuple(int(value) for value in values))
+
 # Create a CSV file to store the results
 csv_file_path = "simulation_results.csv"
 
@@ -69,21 +91,23 @@ with open(csv_file_path, mode='w', newline='') as csv_file:
     # Write the header row to the CSV file
     csv_writer.writerow(['numberOfStations', 'distance', 'measurementError', 'numberOfBurstsExponent', 'burstDuration', 
                         'minDeltaFtm', 'asap', 'ftmsPerBurst', 'burstPeriod', 'frequency', 
-                        'propagationLossModel', 'channelBandwidth', 'RTT', 'stdDev', 'meanSignalStrength', 'stdDevSS', 'numMeasurements', 'stdDevnumM'])
+                        'propagationLossModel', 'channelBandwidth', 'RTT', 'stdDev', 'meanSignalStrength', 'stdDevSS', 'numMeasurements', 'stdDevnumM', 'zeroTimestampDialogs', 'sessionsDenied', 'ftmAirtimeUs', 'burstIdleUs', 'measurementsPerAirtimeMs'])
 
 # Loop over parameter combinations
     for combination in param_combinations:      
         # Check conditions to skip certain combinations
         combination_dict = dict(combination)
-        if ((combination_dict.get("burstDuration") == 5 and combination_dict.get("minDeltaFtm") in [320, 640]) or
-            (combination_dict.get("burstDuration") == 5 and combination_dict.get("ftmsPerBurst") in [2, 3] and combination_dict.get("minDeltaFtm") == 10) or
-            (combination_dict.get("burstDuration") == 11 and combination_dict.get("minDeltaFtm") in [5, 10]) or
-            (combination_dict.get("burstDuration") == 11 and combination_dict.get("ftmsPerBurst") in [2, 3] and combination_dict.get("minDeltaFtm") == 640)):
+        if tuple(combination_dict.get(name, default) for name, default in feasibility_defaults.items()) not in feasible_combinations:
             continue
 
         mean_rtt_values = []
         mean_signal_strength_values = []
         num_measurements_values = []
+        zero_timestamp_dialogs_values = []
+        sessions_denied_values = []
+        ftm_airtime_values = []
+        burst_idle_values = []
+        measurements_per_airtime_values = []
 
         number_of_runs = 5
         for times in range(1, number_of_runs + 1): # number of runs
@@ -98,6 +122,8 @@ with open(csv_file_path, mode='w', newline='') as csv_file:
             os.makedirs(run_dir, exist_ok=True)
     
             params_str = " ".join([f"--{param_name}={param_value} --pcapPath={run_dir}/{times} --RngRun={seed}" for param_name, param_value in combination])
+            metrics_path = os.path.join(run_dir, "metrics.json")
+            params_str += f" --FtmMetricsSummary={metrics_path}"
             formatted_command = cli_command.format(params=params_str)
         
             # Run the command and capture the output
@@ -136,6 +162,19 @@ with open(csv_file_path, mode='w', newline='') as csv_file:
                     num_measurements = int(line.split(":")[1].strip())
                     # if num_measurements != 0:
                     num_measurements_values.append(num_measurements)
+
+            # Collect the FTM metrics summary written at the end of the run
+            if os.path.exists(metrics_path):
+                with open(metrics_path, "r") as f:
+                    metrics = json.load(f)
+                zero_timestamp_dialogs_values.append(metrics["zero_timestamp_dialogs"])
+                sessions_denied_values.append(metrics["sessions_denied"])
+                # channel time of the FTM frames and their ACKs, every frame is sent by exactly one manager
+                airtime_ns = sum(metrics[key] for key in metrics if key.startswith("airtime_tx_"))
+                ftm_airtime_values.append(airtime_ns / 1000)
+                burst_idle_values.append(metrics["airtime_burst_idle_ns"] / 1000)
+                if airtime_ns > 0:
+                    measurements_per_airtime_values.append(metrics["rtts_calculated"] / (airtime_ns / 1e6))
     
         # Calculate averages and standard deviations
         mean_rtt_avg = np.mean(mean_rtt_values)
@@ -189,7 +228,7 @@ with open(csv_file_path, mode='w', newline='') as csv_file:
             elif param_name == 'channelBandwidth':
                 channelBandwidth_csv = param_value
     
-        csv_writer.writerow([numberOfStations_csv, distance_csv, measurementError, numberOfBurstsExponent_csv, burstDuration_csv, minDeltaFtm_csv, asap_csv, ftmsPerBurst_csv, burstPeriod_csv, frequency_csv, propagationLossModel_csv, channelBandwidth_csv, int(mean_rtt_avg), int(mean_rtt_std), round(mean_signal_strength_avg, 1), round(mean_signal_strength_std, 1), int(num_measurements_avg), int(num_measurements_std)])
+        csv_writer.writerow([numberOfStations_csv, distance_csv, measurementError, numberOfBurstsExponent_csv, burstDuration_csv, minDeltaFtm_csv, asap_csv, ftmsPerBurst_csv, burstPeriod_csv, frequency_csv, propagationLossModel_csv, channelBandwidth_csv, int(mean_rtt_avg), int(mean_rtt_std), round(mean_signal_strength_avg, 1), round(mean_signal_strength_std, 1), int(num_measurements_avg), int(num_measurements_std), np.mean(zero_timestamp_dialogs_values or [0]), np.mean(sessions_denied_values or [0]), round(np.mean(ftm_airtime_values or [0]), 1), round(np.mean(burst_idle_values or [0]), 1), round(np.mean(measurements_per_airtime_values or [0]), 3)])
 
         # if os.path.exists(output_dir_base):
         #     import shutil
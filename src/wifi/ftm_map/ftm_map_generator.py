@@ -22,11 +22,15 @@ import numpy as np
 import matplotlib.pyplot as plt
 import locale
 import scipy.stats as st
+import struct
 
 default_filename = "FTM_Wireless_Error.map"
 default_bias = 10000
 default_dcorr = 0.25
 default_resolution = 0.01
+default_tile_size = 256
+default_floor_height = 3.0
+tile_alignment = 4096
 
 def parseArguments():
 	parser = argparse.ArgumentParser()
@@ -45,6 +49,10 @@ def parseArguments():
 	group3.add_argument("--read", action="store_true", help="If set reads from the default map file and visualizes the map.")
 	group3.add_argument("--readfile", type=str, metavar="Filename", help="Reads from the specified map file and then visualizes the map.")
 	parser.add_argument("--silent", action="store_true", help="Disables the prompt for the file size.")
+	parser.add_argument("--totiles", type=str, nargs="+", metavar="Filename", help="Converts the given map files, one per floor starting with the lowest, into one tiled .ftmtiles map.")
+	parser.add_argument("--tile_size", type=int, help="Edge length of the tiles in cells for --totiles. Default: " + str(default_tile_size))
+	parser.add_argument("--floor_height", type=float, help="Height of one floor for --totiles. Default: " + str(default_floor_height))
+	parser.add_argument("--zmin", type=float, help="Z coordinate of the lowest floor for --totiles. Default: 0")
 	#parser.add_argument("--heavy_multipath", action="store_true", help="Uses an expo norm distribution parameterized from real world data in a heavy multipath environment to create the map. Bias value is ignored when using this option.")
 	return parser.parse_args()
 
@@ -78,6 +86,55 @@ def readFileAndDisplay(filename):
 	plt.show()
 	
 
+def readHeader(filename):
+	f = open(filename, "r")
+	header = f.readline().rstrip()[2:].split(",")
+	f.close()
+	return {entry.split("=")[0]: float(entry.split("=")[1]) for entry in header}
+
+def writeTiledMap(filenames, tile_size, floor_height, zmin, output):
+	# layout: 72 byte header, uint64 file offset per tile (floor, tile row, tile column; 0 for empty tiles),
+	# then the tiles as float32 rows starting at ymax, every tile aligned to tile_alignment bytes
+	if not output.endswith(".ftmtiles"):
+		output += ".ftmtiles"
+	header = readHeader(filenames[0])
+	floors = [np.loadtxt(filenames[0])]
+	for filename in filenames[1:]:
+		if readHeader(filename) != header:
+			print("All floors need the same dimensions and resolution: " + filename)
+			return
+		floors.append(np.loadtxt(filename))
+	ysize, xsize = floors[0].shape
+	tiles_x = (xsize + tile_size - 1) // tile_size
+	tiles_y = (ysize + tile_size - 1) // tile_size
+	tile_bytes = tile_size * tile_size * 4
+
+	offsets = np.zeros(len(floors) * tiles_y * tiles_x, dtype="<u8")
+	index_end = 72 + offsets.nbytes
+	next_offset = (index_end + tile_alignment - 1) // tile_alignment * tile_alignment
+	tiles = []
+	for floor, ftm_map in enumerate(floors):
+		for ty in range(tiles_y):
+			for tx in range(tiles_x):
+				tile = np.zeros((tile_size, tile_size), dtype="<f4")
+				part = ftm_map[ty * tile_size:(ty + 1) * tile_size, tx * tile_size:(tx + 1) * tile_size]
+				tile[:part.shape[0], :part.shape[1]] = part
+				if not tile.any():
+					continue
+				offsets[(floor * tiles_y + ty) * tiles_x + tx] = next_offset
+				tiles.append((next_offset, tile))
+				next_offset += (tile_bytes + tile_alignment - 1) // tile_alignment * tile_alignment
+
+	with open(output, "wb") as f:
+		f.write(b"FTMTILES")
+		f.write(struct.pack("<IIIIII", 1, tile_size, xsize, ysize, len(floors), 0))
+		f.write(struct.pack("<ddddd", header["xmin"], header["ymax"], header["resolution"], zmin, floor_height))
+		f.write(offsets.tobytes())
+		for offset, tile in tiles:
+			f.seek(offset)
+			f.write(tile.tobytes())
+	print("Wrote " + output + ": " + str(len(floors)) + " floors, " + str(len(tiles)) + " of " + str(offsets.size) + " tiles")
+
 def writeMap(ftm_map, xmin, xmax, ymin, ymax, bias, dcorr, resolution, output):
 	if not output.endswith(".map"):
 		output += ".map"
@@ -162,6 +219,13 @@ def main():
 	if args.read or args.readfile:
 		readFileAndDisplay(args.readfile)
 		return
+	if args.totiles:
+		tile_size = args.tile_size if args.tile_size is not None else default_tile_size
+		floor_height = args.floor_height if args.floor_height is not None else default_floor_height
+		zmin = args.zmin if args.zmin is not None else 0.0
+		output = args.output if args.output is not None else args.totiles[0].rsplit(".map", 1)[0]
+		writeTiledMap(args.totiles, tile_size, floor_height, zmin, output)
+		return
 	generateMap(args)
 
 
@@ -0,0 +1,192 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *
+ * Copyright (C) 2022 Christos Laskos
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ftm-cached-propagation-loss-model.h"
+#include <ns3/log.h>
+#include <ns3/pointer.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FtmCachedPropagationLossModel");
+
+NS_OBJECT_ENSURE_REGISTERED (FtmCachedPropagationLossModel);
+
+TypeId
+FtmCachedPropagationLossModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FtmCachedPropagationLossModel")
+    .SetParent<PropagationLossModel> ()
+    .SetGroupName ("FTM")
+    .AddConstructor<FtmCachedPropagationLossModel>()
+    .AddAttribute("Model",
+                  "The deterministic propagation loss model to be cached.",
+                  PointerValue (),
+                  MakePointerAccessor (&FtmCachedPropagationLossModel::SetModel,
+                                       &FtmCachedPropagationLossModel::GetModel),
+                  MakePointerChecker<PropagationLossModel> ())
+    ;
+  return tid;
+}
+
+FtmCachedPropagationLossModel::FtmCachedPropagationLossModel ()
+  : m_hits (0),
+    m_misses (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+FtmCachedPropagationLossModel::~FtmCachedPropagationLossModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+FtmCachedPropagationLossModel::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (auto & tracked : m_tracked)
+    {
+      Tracker *tracker = tracked.second;
+      //detach first, the tracker is destroyed by the disconnect if the trace held its last reference
+      tracker->owner = 0;
+      tracker->model->TraceDisconnectWithoutContext ("CourseChange",
+          MakeCallback (&Tracker::CourseChanged, Ptr<Tracker> (tracker)));
+    }
+  m_tracked.clear ();
+  m_cache.clear ();
+  m_model = 0;
+  PropagationLossModel::DoDispose ();
+}
+
+void
+FtmCachedPropagationLossModel::SetModel (Ptr<PropagationLossModel> model)
+{
+  m_model = model;
+  ClearCache ();
+}
+
+Ptr<PropagationLossModel>
+FtmCachedPropagationLossModel::GetModel (void) const
+{
+  return m_model;
+}
+
+void
+FtmCachedPropagationLossModel::ClearCache (void)
+{
+  m_cache.clear ();
+}
+
+uint64_t
+FtmCachedPropagationLossModel::GetCacheHits (void) const
+{
+  return m_hits;
+}
+
+uint64_t
+FtmCachedPropagationLossModel::GetCacheMisses (void) const
+{
+  return m_misses;
+}
+
+double
+FtmCachedPropagationLossModel::DoCalcRxPower (double txPowerDbm,
+                                              Ptr<MobilityModel> a,
+                                              Ptr<MobilityModel> b) const
+{
+  if (m_model == 0)
+    {
+      return txPowerDbm;
+    }
+  ReceiverCache &receivers = m_cache[PeekPointer (a)];
+  auto it = receivers.find (PeekPointer (b));
+  if (it != receivers.end () && it->second.tx_power_dbm == txPowerDbm)
+    {
+      m_hits++;
+      return it->second.rx_power_dbm;
+    }
+  m_misses++;
+  Track (a);
+  Track (b);
+  double rx_power_dbm = m_model->CalcRxPower (txPowerDbm, a, b);
+  receivers[PeekPointer (b)] = {txPowerDbm, rx_power_dbm};
+  return rx_power_dbm;
+}
+
+int64_t
+FtmCachedPropagationLossModel::DoAssignStreams (int64_t stream)
+{
+  if (m_model == 0)
+    {
+      return 0;
+    }
+  return m_model->AssignStreams (stream);
+}
+
+void
+FtmCachedPropagationLossModel::Track (Ptr<MobilityModel> model) const
+{
+  if (m_tracked.find (PeekPointer (model)) != m_tracked.end ())
+    {
+      return;
+    }
+  Ptr<Tracker> tracker = Create<Tracker> (this, PeekPointer (model));
+  m_tracked[PeekPointer (model)] = PeekPointer (tracker);
+  model->TraceConnectWithoutContext ("CourseChange", MakeCallback (&Tracker::CourseChanged, tracker));
+}
+
+void
+FtmCachedPropagationLossModel::Forget (const MobilityModel *model) const
+{
+  NS_LOG_FUNCTION (this << model);
+  m_cache.erase (model);
+  for (auto & sender : m_cache)
+    {
+      sender.second.erase (model);
+    }
+}
+
+FtmCachedPropagationLossModel::Tracker::Tracker (const FtmCachedPropagationLossModel *loss_model,
+                                                 MobilityModel *mobility_model)
+  : owner (loss_model),
+    model (mobility_model)
+{
+}
+
+FtmCachedPropagationLossModel::Tracker::~Tracker ()
+{
+  //the mobility model is destroyed, or the trace is disconnected by the disposed owner
+  if (owner != 0)
+    {
+      owner->m_tracked.erase (model);
+      owner->Forget (model);
+    }
+}
+
+void
+FtmCachedPropagationLossModel::Tracker::CourseChanged (Ptr<const MobilityModel> moved)
+{
+  if (owner != 0)
+    {
+      owner->Forget (PeekPointer (moved));
+    }
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,157 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *
+ * Copyright (C) 2022 Christos Laskos
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef FTM_CACHED_PROPAGATION_LOSS_MODEL_H_
+#define FTM_CACHED_PROPAGATION_LOSS_MODEL_H_
+
+#include <ns3/propagation-loss-model.h>
+#include <ns3/mobility-model.h>
+#include <unordered_map>
+
+namespace ns3 {
+
+/**
+ * \brief Caches the receive power of a deterministic propagation loss model per link.
+ * \ingroup FTM
+ *
+ * The channel calculates the receive power of every frame for every receiver, so with static nodes the same
+ * path loss is calculated over and over again. This model calculates the receive power of the model set with
+ * the "Model" attribute once per (sender, receiver) pair and transmit power and returns the cached value
+ * afterwards. The entries of a node are removed when its mobility model reports a course change or is
+ * destroyed. The mobility models are not referenced by the cache.
+ *
+ * Only deterministic models may be cached, e.g. the log distance models or the 3GPP models, which keep their
+ * channel condition and shadowing per link. Stochastic fading like the NakagamiPropagationLossModel has to be
+ * chained after this model with SetNext, or added after it to the YansWifiChannelHelper, so it is still
+ * drawn for every frame.
+ */
+class FtmCachedPropagationLossModel : public PropagationLossModel
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  FtmCachedPropagationLossModel ();
+  virtual ~FtmCachedPropagationLossModel ();
+
+  /**
+   * Sets the model to be cached and clears the cache.
+   *
+   * \param model the deterministic propagation loss model
+   */
+  void SetModel (Ptr<PropagationLossModel> model);
+
+  /**
+   * \return the cached model
+   */
+  Ptr<PropagationLossModel> GetModel (void) const;
+
+  /**
+   * Removes all cached receive powers.
+   */
+  void ClearCache (void);
+
+  /**
+   * \return the number of receive powers taken from the cache
+   */
+  uint64_t GetCacheHits (void) const;
+
+  /**
+   * \return the number of receive powers calculated by the cached model
+   */
+  uint64_t GetCacheMisses (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /**
+   * A cached receive power, valid for the transmit power it was calculated with.
+   */
+  struct CacheEntry
+  {
+    double tx_power_dbm; //!< transmit power [dBm]
+    double rx_power_dbm; //!< receive power [dBm]
+  };
+
+  /**
+   * The cached receive powers of one sender, by receiver.
+   */
+  typedef std::unordered_map<const MobilityModel *, CacheEntry> ReceiverCache;
+
+  virtual double DoCalcRxPower (double txPowerDbm,
+                                Ptr<MobilityModel> a,
+                                Ptr<MobilityModel> b) const;
+  virtual int64_t DoAssignStreams (int64_t stream);
+
+  /**
+   * Connected to the course change trace of one mobility model. Only the trace holds a reference to it, so
+   * it is destroyed together with the mobility model and removes the entries of the model, before the
+   * address of the model can be reused by a new one.
+   */
+  class Tracker : public SimpleRefCount<Tracker>
+  {
+  public:
+    /**
+     * \param loss_model the loss model caching the receive powers of the mobility model
+     * \param mobility_model the tracked mobility model
+     */
+    Tracker (const FtmCachedPropagationLossModel *loss_model, MobilityModel *mobility_model);
+    ~Tracker ();
+
+    /**
+     * Removes the entries of the mobility model, if the owner is still alive.
+     *
+     * \param moved the mobility model of the moved node
+     */
+    void CourseChanged (Ptr<const MobilityModel> moved);
+
+    const FtmCachedPropagationLossModel *owner; //!< the loss model, null once it is disposed
+    MobilityModel *model; //!< the tracked mobility model
+  };
+
+  /**
+   * Connects a Tracker to the course change trace of the mobility model, if not already done.
+   *
+   * \param model the mobility model
+   */
+  void Track (Ptr<MobilityModel> model) const;
+
+  /**
+   * Removes all entries of the node.
+   *
+   * \param model the mobility model of the node
+   */
+  void Forget (const MobilityModel *model) const;
+
+  Ptr<PropagationLossModel> m_model; //!< the cached model
+
+  mutable std::unordered_map<const MobilityModel *, ReceiverCache> m_cache; //!< receive powers by sender
+  mutable std::unordered_map<const MobilityModel *, Tracker *> m_tracked; //!< trackers owned by the traces
+  mutable uint64_t m_hits; //!< receive powers taken from the cache
+  mutable uint64_t m_misses; //!< receive powers calculated by the cached model
+};
+
+} /* namespace ns3 */
+
+#endif /* FTM_CACHED_PROPAGATION_LOSS_MODEL_H_ */
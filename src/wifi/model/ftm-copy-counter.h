@@ -0,0 +1,53 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *
+ * Copyright (C) 2021 Christos Laskos
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef FTM_COPY_COUNTER_H_
+#define FTM_COPY_COUNTER_H_
+
+#include <stdint.h>
+
+namespace ns3 {
+
+#ifdef NS3_FTM_COUNT_COPIES
+/**
+ * \brief Counts the copies of the FTM header it is a member of.
+ * \ingroup FTM
+ *
+ * Only compiled in when NS3_FTM_COUNT_COPIES is defined, e.g. with
+ * CXXFLAGS="-DNS3_FTM_COUNT_COPIES" ./waf configure. A copy of a header also copies the headers it contains.
+ */
+template <typename T>
+class FtmCopyCounter
+{
+public:
+  FtmCopyCounter () {}
+  FtmCopyCounter (const FtmCopyCounter &) { copies++; }
+  FtmCopyCounter & operator= (const FtmCopyCounter &) { copies++; return *this; }
+
+  static uint64_t copies; //!< The number of copies since the start of the program.
+};
+
+template <typename T>
+uint64_t FtmCopyCounter<T>::copies = 0;
+#endif
+
+} /* namespace ns3 */
+
+#endif /* FTM_COPY_COUNTER_H_ */
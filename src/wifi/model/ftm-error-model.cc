@@ -24,14 +24,146 @@
 #include <ns3/double.h>
 #include <ns3/enum.h>
 #include <ns3/integer.h>
+#include <ns3/uinteger.h>
+#include <ns3/boolean.h>
 #include <fstream>
 #include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("FtmErrorModel");
 
+/// First bytes of a tiled map file.
+static const char TILED_MAP_MAGIC[8] = {'F', 'T', 'M', 'T', 'I', 'L', 'E', 'S'};
+/// Supported version of the tiled map format.
+static const uint32_t TILED_MAP_VERSION = 1;
+/// Size of the tiled map header, the tile index follows it.
+static const std::size_t TILED_MAP_HEADER_SIZE = 72;
+
+/*
+ * The tiled map files are little endian, the values are converted byte by byte so they are read correctly on
+ * every host.
+ */
+static uint32_t
+ReadLittleEndian32 (const uint8_t *bytes)
+{
+  return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+static uint64_t
+ReadLittleEndian64 (const uint8_t *bytes)
+{
+  return (uint64_t) ReadLittleEndian32 (bytes) | ((uint64_t) ReadLittleEndian32 (bytes + 4) << 32);
+}
+
+static double
+ReadLittleEndianDouble (const uint8_t *bytes)
+{
+  uint64_t bits = ReadLittleEndian64 (bytes);
+  double value;
+  std::memcpy (&value, &bits, sizeof (value));
+  return value;
+}
+
+/*
+ * The cells of a tile are used in place, so on a big endian host they are swapped after mapping.
+ */
+static bool
+IsLittleEndianHost (void)
+{
+  uint32_t probe = 1;
+  uint8_t first;
+  std::memcpy (&first, &probe, 1);
+  return first == 1;
+}
+
+/// Edge length in cells of the tiles that share one scale and offset in a quantized text map.
+static const uint32_t QUANTIZED_TILE_SIZE = 64;
+// bits of a quantized cell, the cells are packed without padding
+static const uint32_t QUANTIZED_BITS = 15;
+static const uint32_t QUANTIZED_MAX = (1 << QUANTIZED_BITS) - 1;
+
+/*
+ * Stores the quantized value of a cell. A cell spans at most 3 bytes, every cell is written once into zeroed
+ * memory.
+ */
+static void
+SetQuantizedCell (std::vector<uint8_t> &cells, std::size_t index, uint32_t value)
+{
+  std::size_t bit = index * QUANTIZED_BITS;
+  uint32_t word = value << (bit % 8);
+  cells[bit / 8] |= word & 0xFF;
+  cells[bit / 8 + 1] |= (word >> 8) & 0xFF;
+  cells[bit / 8 + 2] |= (word >> 16) & 0xFF;
+}
+
+/*
+ * Returns the quantized value of a cell.
+ */
+static uint32_t
+GetQuantizedCell (const std::vector<uint8_t> &cells, std::size_t index)
+{
+  std::size_t bit = index * QUANTIZED_BITS;
+  uint32_t word = cells[bit / 8] | (cells[bit / 8 + 1] << 8) | (cells[bit / 8 + 2] << 16);
+  return (word >> (bit % 8)) & QUANTIZED_MAX;
+}
+
+namespace {
+
+/// Splitmix64 step, used to expand the seed into the generator state.
+uint64_t
+SplitMix64 (uint64_t &x)
+{
+  uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/// Rotates x left by k bits.
+inline uint64_t
+RotateLeft (uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+} // anonymous namespace
+
+FtmErrorRng::FtmErrorRng (uint64_t seed)
+{
+  Seed (seed);
+}
+
+void
+FtmErrorRng::Seed (uint64_t seed)
+{
+  for (uint64_t &word : m_state)
+    {
+      word = SplitMix64 (seed);
+    }
+}
+
+FtmErrorRng::result_type
+FtmErrorRng::operator() (void)
+{
+  uint64_t result = RotateLeft (m_state[1] * 5, 7) * 9;
+  uint64_t t = m_state[1] << 17;
+  m_state[2] ^= m_state[0];
+  m_state[3] ^= m_state[1];
+  m_state[1] ^= m_state[2];
+  m_state[0] ^= m_state[3];
+  m_state[2] ^= t;
+  m_state[3] = RotateLeft (m_state[3], 45);
+  return result;
+}
+
 NS_OBJECT_ENSURE_REGISTERED (FtmErrorModel);
 
 TypeId
@@ -61,6 +193,27 @@ FtmErrorModel::GetFtmError (double sig_str)
   return 0;
 }
 
+void
+FtmErrorModel::SetPartner (Mac48Address partner)
+{
+}
+
+uint64_t
+FtmErrorModel::GetMemoryUsage (void) const
+{
+  //NS_OBJECT_ENSURE_REGISTERED sets the size of every model class
+  return GetInstanceTypeId ().GetSize ();
+}
+
+void
+FtmErrorModel::GetFtmErrors (const double *sig_strs, int64_t *errors, std::size_t count)
+{
+  for (std::size_t i = 0; i < count; i++)
+    {
+      errors[i] = GetFtmError (sig_strs[i]);
+    }
+}
+
 
 NS_OBJECT_ENSURE_REGISTERED (WiredFtmErrorModel);
 
@@ -101,7 +254,7 @@ WiredFtmErrorModel::WiredFtmErrorModel ()
   NS_LOG_FUNCTION (this);
   std::random_device random;
   m_seed = random ();
-  m_generator = std::mt19937 (m_seed);
+  m_generator.Seed (m_seed);
   m_gauss_dist = std::normal_distribution<double> (m_mean, m_standard_deviation_20MHz);
 }
 
@@ -109,7 +262,7 @@ WiredFtmErrorModel::WiredFtmErrorModel (std::uint_least32_t seed)
 {
   NS_LOG_FUNCTION (this);
   m_seed = seed;
-  m_generator = std::mt19937 (m_seed);
+  m_generator.Seed (m_seed);
   m_gauss_dist = std::normal_distribution<double> (m_mean, m_standard_deviation_20MHz);
 }
 
@@ -148,7 +301,7 @@ void
 WiredFtmErrorModel::SetSeed (std::uint_least32_t seed)
 {
   m_seed = seed;
-  m_generator = std::mt19937 (m_seed);
+  m_generator.Seed (m_seed);
 }
 
 std::uint_least32_t
@@ -190,6 +343,9 @@ WiredFtmErrorModel::UpdateDistribution (void)
 }
 
 
+constexpr double WiredFtmErrorModel::m_standard_deviation_20MHz;
+constexpr double WiredFtmErrorModel::m_standard_deviation_40MHz;
+
 NS_OBJECT_ENSURE_REGISTERED (WirelessFtmErrorModel);
 
 TypeId
@@ -206,6 +362,12 @@ WirelessFtmErrorModel::GetTypeId (void)
                   MakePointerAccessor (&WirelessFtmErrorModel::SetFtmMap,
                                        &WirelessFtmErrorModel::GetFtmMap),
                   MakePointerChecker<FtmMap> ())
+    .AddAttribute("FtmMapSet",
+                  "The FtmMapSet with one map per responder. If set, it is used instead of the FtmMap.",
+                  PointerValue (),
+                  MakePointerAccessor (&WirelessFtmErrorModel::SetFtmMapSet,
+                                       &WirelessFtmErrorModel::GetFtmMapSet),
+                  MakePointerChecker<FtmMapSet> ())
     ;
   return tid;
 }
@@ -235,14 +397,15 @@ WirelessFtmErrorModel::~WirelessFtmErrorModel()
 int
 WirelessFtmErrorModel::GetFtmError (double sig_str)
 {
-  if (m_node == 0 || m_map == 0)
+  Ptr<FtmMap> map = m_map_set != 0 ? m_map_set->GetMap (m_partner) : m_map;
+  if (m_node == 0 || map == 0)
     {
       return 0 + WiredFtmErrorModel::GetFtmError (sig_str);
     }
   Ptr<MobilityModel> mobility = m_node->GetObject<MobilityModel> ();
   Vector position = mobility->GetPosition();
 
-  double bias = m_map->GetBias(position.x, position.y);
+  double bias = map->GetBias(position.x, position.y, position.z);
 
   int error = bias + WiredFtmErrorModel::GetFtmError (sig_str);
   return error;
@@ -272,6 +435,24 @@ WirelessFtmErrorModel::GetNode (void)
   return m_node;
 }
 
+void
+WirelessFtmErrorModel::SetFtmMapSet (Ptr<FtmMapSet> map_set)
+{
+  m_map_set = map_set;
+}
+
+Ptr<WirelessFtmErrorModel::FtmMapSet>
+WirelessFtmErrorModel::GetFtmMapSet (void) const
+{
+  return m_map_set;
+}
+
+void
+WirelessFtmErrorModel::SetPartner (Mac48Address partner)
+{
+  m_partner = partner;
+}
+
 //NS_OBJECT_ENSURE_REGISTERED (WirelessFtmErrorModel::FtmMap); //does not work for some reason
 
 TypeId
@@ -281,6 +462,18 @@ WirelessFtmErrorModel::FtmMap::GetTypeId (void)
     .SetParent<Object> ()
     .SetGroupName ("FTM")
     .AddConstructor<WirelessFtmErrorModel::FtmMap>()
+    .AddAttribute ("MaxResidentTiles",
+                   "The maximum number of tiles of a tiled map that are mapped into memory at the same time.",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&WirelessFtmErrorModel::FtmMap::SetMaxResidentTiles),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Quantize",
+                   "Store the bias of text maps as packed 15 bit values with a scale and offset per tile instead "
+                   "of doubles. Needs less than a quarter of the memory, the quantization error stays below 1 ps, "
+                   "but the bias is no longer bit identical to the map file.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&WirelessFtmErrorModel::FtmMap::m_quantize),
+                   MakeBooleanChecker ())
     ;
   return tid;
 }
@@ -298,6 +491,19 @@ WirelessFtmErrorModel::FtmMap::FtmMap ()
   resolution = 0;
   xsize = 0;
   ysize = 0;
+
+  m_fd = -1;
+  m_tile_size = 0;
+  m_tiles_x = 0;
+  m_tiles_y = 0;
+  m_floors = 1;
+  m_zmin = 0;
+  m_floor_height = 0;
+  m_max_resident_tiles = 64;
+  m_last_tile_index = 0;
+  m_last_tile = 0;
+  m_quantize = false;
+  m_quantized_tiles_x = 0;
 }
 
 WirelessFtmErrorModel::FtmMap::~FtmMap ()
@@ -305,6 +511,7 @@ WirelessFtmErrorModel::FtmMap::~FtmMap ()
   NS_LOG_FUNCTION (this);
 
   delete [] map;
+  CloseTiledMap ();
 }
 
 void
@@ -317,6 +524,26 @@ WirelessFtmErrorModel::FtmMap::LoadMap (std::string filename)
       NS_FATAL_ERROR ("Specified map file can not be opened!");
       return;
     }
+  char magic[sizeof (TILED_MAP_MAGIC)] = {};
+  file.read (magic, sizeof (magic));
+  if (file.gcount () == sizeof (magic) && std::memcmp (magic, TILED_MAP_MAGIC, sizeof (magic)) == 0)
+    {
+      file.close ();
+      LoadTiledMap (filename);
+      return;
+    }
+  file.clear ();
+  file.seekg (0);
+  delete [] map;
+  map = 0;
+  CloseTiledMap ();
+  m_cells.clear ();
+  m_tile_offsets_q.clear ();
+  m_tile_scales_q.clear ();
+  m_floors = 1;
+  m_zmin = 0;
+  m_floor_height = 0;
+
   std::string line;
   std::getline(file, line);
 
@@ -356,19 +583,35 @@ WirelessFtmErrorModel::FtmMap::LoadMap (std::string filename)
 
   xsize = ((xmax - xmin) / resolution) + 1;
   ysize = ((ymax - ymin) / resolution) + 1;
-  map = new double [xsize * ysize];
+  // quantized maps are read in bands of tile rows, so the doubles of the whole map are never in memory
+  std::vector<double> band;
+  if (m_quantize)
+    {
+      m_quantized_tiles_x = (xsize + QUANTIZED_TILE_SIZE - 1) / QUANTIZED_TILE_SIZE;
+      std::size_t tiles = (std::size_t) m_quantized_tiles_x * ((ysize + QUANTIZED_TILE_SIZE - 1) / QUANTIZED_TILE_SIZE);
+      //two bytes of padding, so the last cell can be read as 3 bytes
+      m_cells.assign (((std::size_t) xsize * ysize * QUANTIZED_BITS + 7) / 8 + 2, 0);
+      m_tile_offsets_q.assign (tiles, 0.0);
+      m_tile_scales_q.assign (tiles, 0.0);
+      band.assign ((std::size_t) QUANTIZED_TILE_SIZE * xsize, 0.0);
+    }
+  else
+    {
+      map = new double [xsize * ysize];
+    }
 
   std::getline(file, line);
   int y = 0;
-  while(std::getline(file, line))
+  while(y < ysize && std::getline(file, line))
     {
+      double *row = m_quantize ? &band[(y % QUANTIZED_TILE_SIZE) * xsize] : &map[y * xsize];
       int x = 0;
       std::string tmp = "";
       for (auto it = line.begin(); it != line.end(); ++it)
         {
           if (*it == ' ')
             {
-              map [y * xsize + x] = std::stod (tmp);
+              row [x] = std::stod (tmp);
               tmp = "";
               ++x;
             }
@@ -377,14 +620,220 @@ WirelessFtmErrorModel::FtmMap::LoadMap (std::string filename)
               tmp += *it;
             }
         }
-      map [y * xsize + x] = std::stod (tmp);
+      row [x] = std::stod (tmp);
       ++y;
+      if (m_quantize && y % QUANTIZED_TILE_SIZE == 0)
+        {
+          QuantizeBand (band, y / QUANTIZED_TILE_SIZE - 1, QUANTIZED_TILE_SIZE);
+        }
+    }
+  if (m_quantize && y % QUANTIZED_TILE_SIZE != 0)
+    {
+      QuantizeBand (band, y / QUANTIZED_TILE_SIZE, y % QUANTIZED_TILE_SIZE);
     }
   file.close();
 }
 
+void
+WirelessFtmErrorModel::FtmMap::QuantizeBand (const std::vector<double> &band, uint32_t band_index, uint32_t rows)
+{
+  for (uint32_t tile_x = 0; tile_x < m_quantized_tiles_x; tile_x++)
+    {
+      uint32_t x_begin = tile_x * QUANTIZED_TILE_SIZE;
+      uint32_t x_end = std::min<uint32_t> (x_begin + QUANTIZED_TILE_SIZE, xsize);
+      double min = band[x_begin];
+      double max = band[x_begin];
+      for (uint32_t row = 0; row < rows; row++)
+        {
+          for (uint32_t x = x_begin; x < x_end; x++)
+            {
+              min = std::min (min, band[row * xsize + x]);
+              max = std::max (max, band[row * xsize + x]);
+            }
+        }
+      std::size_t tile = (std::size_t) band_index * m_quantized_tiles_x + tile_x;
+      double scale = (max - min) / QUANTIZED_MAX;
+      m_tile_offsets_q[tile] = min;
+      m_tile_scales_q[tile] = scale;
+      for (uint32_t row = 0; row < rows; row++)
+        {
+          std::size_t y = (std::size_t) band_index * QUANTIZED_TILE_SIZE + row;
+          for (uint32_t x = x_begin; x < x_end; x++)
+            {
+              SetQuantizedCell (m_cells, y * xsize + x,
+                                scale > 0 ? std::lround ((band[row * xsize + x] - min) / scale) : 0);
+            }
+        }
+    }
+}
+
+void
+WirelessFtmErrorModel::FtmMap::LoadTiledMap (std::string filename)
+{
+  delete [] map;
+  map = 0;
+  CloseTiledMap ();
+
+  m_fd = open (filename.c_str (), O_RDONLY);
+  if (m_fd < 0)
+    {
+      NS_FATAL_ERROR ("Specified map file can not be opened!");
+      return;
+    }
+  // header: magic, version, tile size, x size, y size, floors, reserved, xmin, ymax, resolution, zmin,
+  // floor height; all values in little endian
+  uint8_t header[TILED_MAP_HEADER_SIZE];
+  if (pread (m_fd, header, sizeof (header), 0) != (ssize_t) sizeof (header))
+    {
+      NS_FATAL_ERROR ("Tiled map " << filename << " has no valid header!");
+      return;
+    }
+  uint32_t version = ReadLittleEndian32 (header + 8);
+  if (version != TILED_MAP_VERSION)
+    {
+      NS_FATAL_ERROR ("Tiled map " << filename << " has the unsupported version " << version);
+      return;
+    }
+  m_tile_size = ReadLittleEndian32 (header + 12);
+  xsize = ReadLittleEndian32 (header + 16);
+  ysize = ReadLittleEndian32 (header + 20);
+  m_floors = ReadLittleEndian32 (header + 24);
+  xmin = ReadLittleEndianDouble (header + 32);
+  ymax = ReadLittleEndianDouble (header + 40);
+  resolution = ReadLittleEndianDouble (header + 48);
+  m_zmin = ReadLittleEndianDouble (header + 56);
+  m_floor_height = ReadLittleEndianDouble (header + 64);
+  xmax = xmin + (xsize - 1) * resolution;
+  ymin = ymax - (ysize - 1) * resolution;
+  NS_ABORT_MSG_IF (m_tile_size == 0 || m_tile_size > 65535 || xsize <= 0 || ysize <= 0 || m_floors == 0
+                   || resolution <= 0, "Tiled map " << filename << " has an invalid header!");
+
+  // a truncated file would only fail when a tile is accessed, with a SIGBUS, so everything is checked here
+  struct stat file_stat;
+  if (fstat (m_fd, &file_stat) != 0)
+    {
+      NS_FATAL_ERROR ("Tiled map " << filename << " can not be read: " << std::strerror (errno));
+      return;
+    }
+  uint64_t file_size = file_stat.st_size;
+  m_tiles_x = (xsize + m_tile_size - 1) / m_tile_size;
+  m_tiles_y = (ysize + m_tile_size - 1) / m_tile_size;
+  uint64_t max_tiles = (file_size - sizeof (header)) / sizeof (uint64_t);
+  uint64_t floor_tiles = (uint64_t) m_tiles_x * m_tiles_y;
+  NS_ABORT_MSG_IF (floor_tiles > max_tiles || m_floors > max_tiles / floor_tiles,
+                   "Tiled map " << filename << " is too short for its tile index!");
+  uint64_t tiles = floor_tiles * m_floors;
+  std::vector<uint8_t> index (tiles * sizeof (uint64_t));
+  if (pread (m_fd, index.data (), index.size (), sizeof (header)) != (ssize_t) index.size ())
+    {
+      NS_FATAL_ERROR ("Tiled map " << filename << " has no valid tile index!");
+      return;
+    }
+  uint64_t index_end = sizeof (header) + index.size ();
+  uint64_t tile_bytes = (uint64_t) m_tile_size * m_tile_size * sizeof (float);
+  m_tile_offsets.resize (tiles);
+  for (uint64_t tile = 0; tile < tiles; tile++)
+    {
+      uint64_t offset = ReadLittleEndian64 (index.data () + tile * sizeof (uint64_t));
+      // 0 marks an empty tile
+      NS_ABORT_MSG_IF (offset != 0 && (offset < index_end || offset % sizeof (float) != 0
+                                       || offset > file_size || file_size - offset < tile_bytes),
+                       "Tile " << tile << " of the tiled map " << filename << " is outside of the file!");
+      m_tile_offsets[tile] = offset;
+    }
+  NS_LOG_INFO ("Tiled map " << filename << ": " << xsize << "x" << ysize << " cells, " << m_floors
+               << " floors, " << m_tile_offsets.size () << " tiles");
+}
+
+const float *
+WirelessFtmErrorModel::FtmMap::GetTile (uint32_t index)
+{
+  if (m_last_tile != 0 && m_last_tile_index == index)
+    {
+      return m_last_tile;
+    }
+  uint64_t offset = m_tile_offsets[index];
+  if (offset == 0)
+    {
+      return 0;
+    }
+  auto search = m_resident_tiles.find (index);
+  if (search != m_resident_tiles.end ())
+    {
+      m_lru.splice (m_lru.begin (), m_lru, search->second.lru);
+      m_last_tile_index = index;
+      m_last_tile = search->second.data;
+      return m_last_tile;
+    }
+
+  while (m_resident_tiles.size () >= m_max_resident_tiles)
+    {
+      auto evicted = m_resident_tiles.find (m_lru.back ());
+      munmap (evicted->second.mapping, evicted->second.length);
+      m_resident_tiles.erase (evicted);
+      m_lru.pop_back ();
+    }
+
+  // the mapping has to start at a page boundary
+  static const uint64_t page_size = sysconf (_SC_PAGESIZE);
+  uint64_t mapping_offset = offset - offset % page_size;
+  std::size_t length = (std::size_t) m_tile_size * m_tile_size * sizeof (float) + (offset - mapping_offset);
+  static const bool little_endian = IsLittleEndianHost ();
+  // the private mapping is only written to, and so copied, on big endian hosts
+  void *mapping = mmap (0, length, little_endian ? PROT_READ : PROT_READ | PROT_WRITE, MAP_PRIVATE, m_fd,
+                        mapping_offset);
+  if (mapping == MAP_FAILED)
+    {
+      NS_FATAL_ERROR ("Tile " << index << " of the tiled map can not be mapped: " << std::strerror (errno));
+      return 0;
+    }
+  uint8_t *cells = static_cast<uint8_t *> (mapping) + (offset - mapping_offset);
+  if (!little_endian)
+    {
+      for (uint32_t cell = 0; cell < m_tile_size * m_tile_size; cell++)
+        {
+          uint32_t bits = ReadLittleEndian32 (cells + cell * sizeof (float));
+          std::memcpy (cells + cell * sizeof (float), &bits, sizeof (bits));
+        }
+    }
+  Tile tile;
+  tile.mapping = mapping;
+  tile.length = length;
+  tile.data = reinterpret_cast<const float *> (cells);
+  m_lru.push_front (index);
+  tile.lru = m_lru.begin ();
+  m_resident_tiles.insert ({index, tile});
+  m_last_tile_index = index;
+  m_last_tile = tile.data;
+  return m_last_tile;
+}
+
+void
+WirelessFtmErrorModel::FtmMap::CloseTiledMap (void)
+{
+  for (auto &entry : m_resident_tiles)
+    {
+      munmap (entry.second.mapping, entry.second.length);
+    }
+  m_resident_tiles.clear ();
+  m_lru.clear ();
+  m_tile_offsets.clear ();
+  m_last_tile = 0;
+  if (m_fd >= 0)
+    {
+      close (m_fd);
+      m_fd = -1;
+    }
+}
+
 double
 WirelessFtmErrorModel::FtmMap::GetBias (double x, double y)
+{
+  return GetBias (x, y, m_zmin);
+}
+
+double
+WirelessFtmErrorModel::FtmMap::GetBias (double x, double y, double z)
 {
   if (x < xmin || y < ymin || x > xmax || y > ymax)
     {
@@ -394,7 +843,141 @@ WirelessFtmErrorModel::FtmMap::GetBias (double x, double y)
   int x_val = (std::abs(xmin - x)) / resolution;
   int y_val = (std::abs(ymax - y)) / resolution;
 
-  return map[y_val * xsize + x_val];
+  if (m_fd < 0)
+    {
+      if (!m_cells.empty ())
+        {
+          std::size_t tile = (std::size_t) (y_val / QUANTIZED_TILE_SIZE) * m_quantized_tiles_x + x_val / QUANTIZED_TILE_SIZE;
+          return m_tile_offsets_q[tile] + m_tile_scales_q[tile] * GetQuantizedCell (m_cells, (std::size_t) y_val * xsize + x_val);
+        }
+      if (map == 0)
+        {
+          return 0.0;
+        }
+      return map[y_val * xsize + x_val];
+    }
+
+  uint32_t floor = 0;
+  if (m_floors > 1 && m_floor_height > 0 && z > m_zmin)
+    {
+      floor = std::min<uint32_t> ((z - m_zmin) / m_floor_height, m_floors - 1);
+    }
+  uint32_t tile_x = x_val / m_tile_size;
+  uint32_t tile_y = y_val / m_tile_size;
+  const float *tile = GetTile ((floor * m_tiles_y + tile_y) * m_tiles_x + tile_x);
+  if (tile == 0)
+    {
+      return 0.0;
+    }
+  return tile[(y_val % m_tile_size) * m_tile_size + (x_val % m_tile_size)];
+}
+
+Box
+WirelessFtmErrorModel::FtmMap::GetBoundingBox (void) const
+{
+  return Box (xmin, xmax, ymin, ymax, m_zmin, m_zmin + m_floors * m_floor_height);
+}
+
+void
+WirelessFtmErrorModel::FtmMap::SetMaxResidentTiles (uint32_t tiles)
+{
+  m_max_resident_tiles = std::max<uint32_t> (tiles, 1);
+}
+
+uint32_t
+WirelessFtmErrorModel::FtmMap::GetResidentTiles (void) const
+{
+  return m_resident_tiles.size ();
+}
+
+uint64_t
+WirelessFtmErrorModel::FtmMap::GetMemoryUsage (void) const
+{
+  if (m_fd >= 0)
+    {
+      return (uint64_t) m_resident_tiles.size () * m_tile_size * m_tile_size * sizeof (float)
+             + m_tile_offsets.size () * sizeof (uint64_t);
+    }
+  if (!m_cells.empty ())
+    {
+      return m_cells.size () + (m_tile_offsets_q.size () + m_tile_scales_q.size ()) * sizeof (double);
+    }
+  return map != 0 ? (uint64_t) xsize * ysize * sizeof (double) : 0;
+}
+
+
+//NS_OBJECT_ENSURE_REGISTERED (WirelessFtmErrorModel::FtmMapSet); //does not work for the nested class either
+
+TypeId
+WirelessFtmErrorModel::FtmMapSet::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::WirelessFtmErrorModel::FtmMapSet")
+    .SetParent<Object> ()
+    .SetGroupName ("FTM")
+    .AddConstructor<WirelessFtmErrorModel::FtmMapSet>()
+    .AddAttribute ("DefaultMap",
+                   "The map for responders without their own map.",
+                   PointerValue (),
+                   MakePointerAccessor (&WirelessFtmErrorModel::FtmMapSet::m_default_map),
+                   MakePointerChecker<FtmMap> ())
+    ;
+  return tid;
+}
+
+WirelessFtmErrorModel::FtmMapSet::FtmMapSet ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+WirelessFtmErrorModel::FtmMapSet::~FtmMapSet ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+WirelessFtmErrorModel::FtmMapSet::AddMap (Mac48Address responder, Ptr<FtmMap> map)
+{
+  m_maps[responder] = map;
+}
+
+Ptr<WirelessFtmErrorModel::FtmMap>
+WirelessFtmErrorModel::FtmMapSet::LoadMap (Mac48Address responder, std::string filename)
+{
+  Ptr<FtmMap> map = CreateObject<FtmMap> ();
+  map->LoadMap (filename);
+  AddMap (responder, map);
+  return map;
+}
+
+void
+WirelessFtmErrorModel::FtmMapSet::SetDefaultMap (Ptr<FtmMap> map)
+{
+  m_default_map = map;
+}
+
+Ptr<WirelessFtmErrorModel::FtmMap>
+WirelessFtmErrorModel::FtmMapSet::GetMap (Mac48Address responder) const
+{
+  auto search = m_maps.find (responder);
+  if (search != m_maps.end ())
+    {
+      return search->second;
+    }
+  return m_default_map;
+}
+
+uint64_t
+WirelessFtmErrorModel::FtmMapSet::GetMemoryUsage (void) const
+{
+  uint64_t bytes = m_default_map != 0 ? m_default_map->GetMemoryUsage () : 0;
+  for (auto &entry : m_maps)
+    {
+      if (entry.second != m_default_map)
+        {
+          bytes += entry.second->GetMemoryUsage ();
+        }
+    }
+  return bytes;
 }
 
 
@@ -414,13 +997,11 @@ WirelessSigStrFtmErrorModel::GetTypeId (void)
 WirelessSigStrFtmErrorModel::WirelessSigStrFtmErrorModel()
 {
   NS_LOG_FUNCTION (this);
-  initDistributions ();
 }
 
 WirelessSigStrFtmErrorModel::WirelessSigStrFtmErrorModel(std::uint_least32_t seed)
 : WirelessFtmErrorModel (seed) {
   NS_LOG_FUNCTION (this);
-  initDistributions ();
 }
 
 WirelessSigStrFtmErrorModel::~WirelessSigStrFtmErrorModel()
@@ -432,13 +1013,14 @@ WirelessSigStrFtmErrorModel::~WirelessSigStrFtmErrorModel()
 int
 WirelessSigStrFtmErrorModel::GetFtmError(double sig_str)
 {
-  int closest_sig_str = getClosestSigStr(sig_str);
-  johnsonsuParams j_p = m_sig_str_map[closest_sig_str];
+  const johnsonsuParams &j_p = getClosestSigStr(sig_str);
 
-  double u = m_uniform_generator(m_generator);
+  // generator for values between 0 and 1
+  std::uniform_real_distribution<double> uniform_generator (0, 1);
+  double u = uniform_generator(m_generator);
   // for safety to not get exactly 0 and throw an error in the normal cdf inverse function
   while(u == 0.0) {
-      u = m_uniform_generator(m_generator);
+      u = uniform_generator(m_generator);
   }
   double phi_inv_u = NormalCDFInverse(u);
   double johnson_error_value = j_p.lamda * sinh((phi_inv_u - j_p.gamma) / j_p.delta) + j_p.xi;
@@ -449,146 +1031,40 @@ WirelessSigStrFtmErrorModel::GetFtmError(double sig_str)
   return error + WirelessFtmErrorModel::GetFtmError(sig_str);
 }
 
-void
-WirelessSigStrFtmErrorModel::initDistributions (void)
-{
-  // generator for values between 0 and 1
-  m_uniform_generator = std::uniform_real_distribution<double> (0, 1);
-
-  // set the distributions parameters for each signal strength
-  johnsonsuParams sig_34_db;
-  sig_34_db.gamma = 3.185354317604147;
-  sig_34_db.delta = 5.478262165530669;
-  sig_34_db.xi = 6607.306595955903;
-  sig_34_db.lamda = 10570.049082397905;
-  m_sig_str_map[-34] = sig_34_db;
-
-  johnsonsuParams sig_54_db;
-  sig_54_db.gamma = 5.244677635165819;
-  sig_54_db.delta = 6.7849632493308984;
-  sig_54_db.xi = 11337.621653529686;
-  sig_54_db.lamda = 13422.49177763342;
-  m_sig_str_map[-54] = sig_54_db;
-
-  johnsonsuParams sig_57_db;
-  sig_57_db.gamma = 11.526219535401548;
-  sig_57_db.delta = 11.752569979080313;
-  sig_57_db.xi = 23972.68246527834;
-  sig_57_db.lamda = 21157.45764517224;
-  m_sig_str_map[-57] = sig_57_db;
-
-  johnsonsuParams sig_60_db;
-  sig_60_db.gamma = 2.9557921354424597;
-  sig_60_db.delta = 5.964536004213013;
-  sig_60_db.xi = 7871.392874146462;
-  sig_60_db.lamda = 16622.55659360096;
-  m_sig_str_map[-60] = sig_60_db;
-
-  johnsonsuParams sig_63_db;
-  sig_63_db.gamma = 6.531332615907574;
-  sig_63_db.delta = 9.919020162635562;
-  sig_63_db.xi = 20472.998112906615;
-  sig_63_db.lamda = 30324.20728528186;
-  m_sig_str_map[-63] = sig_63_db;
-
-  johnsonsuParams sig_66_db;
-  sig_66_db.gamma = 1.5679223209733015;
-  sig_66_db.delta = 2.651102194031285;
-  sig_66_db.xi = 6467.335055986082;
-  sig_66_db.lamda = 10780.685947891918;
-  m_sig_str_map[-66] = sig_66_db;
-
-  johnsonsuParams sig_69_db;
-  sig_69_db.gamma = 1.1919025159806425;
-  sig_69_db.delta = 1.7569740011989712;
-  sig_69_db.xi = 5315.277549936767;
-  sig_69_db.lamda = 9231.043791364496;
-  m_sig_str_map[-69] = sig_69_db;
-
-  johnsonsuParams sig_72_db;
-  sig_72_db.gamma = 1.6836266134414828;
-  sig_72_db.delta = 1.5382463243606552;
-  sig_72_db.xi = 9816.63892830534;
-  sig_72_db.lamda = 9491.487540612658;
-  m_sig_str_map[-72] = sig_72_db;
-
-  johnsonsuParams sig_74_db;
-  sig_74_db.gamma = 4.689858735589265;
-  sig_74_db.delta = 1.9587337465051236;
-  sig_74_db.xi = 28439.426802970185;
-  sig_74_db.lamda = 6570.588773099477;
-  m_sig_str_map[-74] = sig_74_db;
-
-  johnsonsuParams sig_75_db;
-  sig_75_db.gamma = 5.456350713475308;
-  sig_75_db.delta = 1.9477684103673694;
-  sig_75_db.xi = 30054.10998533451;
-  sig_75_db.lamda = 4864.245629274696;
-  m_sig_str_map[-75] = sig_75_db;
-
-  johnsonsuParams sig_76_db;
-  sig_76_db.gamma = 7.139744646153247;
-  sig_76_db.delta = 2.1710686890594744;
-  sig_76_db.xi = 38988.747394210804;
-  sig_76_db.lamda = 3882.820051622388;
-  m_sig_str_map[-76] = sig_76_db;
-
-  johnsonsuParams sig_77_db;
-  sig_77_db.gamma = 8.262140730541272;
-  sig_77_db.delta = 2.1345127965798465;
-  sig_77_db.xi = 42133.22288891718;
-  sig_77_db.lamda = 2389.29904971697;
-  m_sig_str_map[-77] = sig_77_db;
-
-  johnsonsuParams sig_78_db;
-  sig_78_db.gamma = 8.522080144367578;
-  sig_78_db.delta = 2.687266469105907;
-  sig_78_db.xi = 64794.77378244052;
-  sig_78_db.lamda = 7235.395990126872;
-  m_sig_str_map[-78] = sig_78_db;
-
-  johnsonsuParams sig_79_db;
-  sig_79_db.gamma = 9.641640107814577;
-  sig_79_db.delta = 3.0128025233396336;
-  sig_79_db.xi = 81275.30052138754;
-  sig_79_db.lamda = 8765.970931713084;
-  m_sig_str_map[-79] = sig_79_db;
-
-  johnsonsuParams sig_80_db;
-  sig_80_db.gamma = 10.561011243252771;
-  sig_80_db.delta = 3.34567183184721;
-  sig_80_db.xi = 99724.65034040553;
-  sig_80_db.lamda = 11258.496064080893;
-  m_sig_str_map[-80] = sig_80_db;
-
-  johnsonsuParams sig_81_db;
-  sig_81_db.gamma = 15.27327368062722;
-  sig_81_db.delta = 5.383312465271288;
-  sig_81_db.xi = 190229.12414263037;
-  sig_81_db.lamda = 27177.723635919916;
-  m_sig_str_map[-81] = sig_81_db;
-
-  johnsonsuParams sig_82_db;
-  sig_82_db.gamma = 21.623359857149143;
-  sig_82_db.delta = 7.2130572012096055;
-  sig_82_db.xi = 282943.14579305204;
-  sig_82_db.lamda = 33155.660042021365;
-  m_sig_str_map[-82] = sig_82_db;
-}
-
-int
+// {signal strength, gamma, delta, lamda, xi} for each measured signal strength, shared by all instances
+const WirelessSigStrFtmErrorModel::johnsonsuParams WirelessSigStrFtmErrorModel::m_johnsonsu_params[17] = {
+    {-34, 3.185354317604147, 5.478262165530669, 10570.049082397905, 6607.306595955903},
+    {-54, 5.244677635165819, 6.7849632493308984, 13422.49177763342, 11337.621653529686},
+    {-57, 11.526219535401548, 11.752569979080313, 21157.45764517224, 23972.68246527834},
+    {-60, 2.9557921354424597, 5.964536004213013, 16622.55659360096, 7871.392874146462},
+    {-63, 6.531332615907574, 9.919020162635562, 30324.20728528186, 20472.998112906615},
+    {-66, 1.5679223209733015, 2.651102194031285, 10780.685947891918, 6467.335055986082},
+    {-69, 1.1919025159806425, 1.7569740011989712, 9231.043791364496, 5315.277549936767},
+    {-72, 1.6836266134414828, 1.5382463243606552, 9491.487540612658, 9816.63892830534},
+    {-74, 4.689858735589265, 1.9587337465051236, 6570.588773099477, 28439.426802970185},
+    {-75, 5.456350713475308, 1.9477684103673694, 4864.245629274696, 30054.10998533451},
+    {-76, 7.139744646153247, 2.1710686890594744, 3882.820051622388, 38988.747394210804},
+    {-77, 8.262140730541272, 2.1345127965798465, 2389.29904971697, 42133.22288891718},
+    {-78, 8.522080144367578, 2.687266469105907, 7235.395990126872, 64794.77378244052},
+    {-79, 9.641640107814577, 3.0128025233396336, 8765.970931713084, 81275.30052138754},
+    {-80, 10.561011243252771, 3.34567183184721, 11258.496064080893, 99724.65034040553},
+    {-81, 15.27327368062722, 5.383312465271288, 27177.723635919916, 190229.12414263037},
+    {-82, 21.623359857149143, 7.2130572012096055, 33155.660042021365, 282943.14579305204},
+};
+
+const WirelessSigStrFtmErrorModel::johnsonsuParams &
 WirelessSigStrFtmErrorModel::getClosestSigStr (double sig_str)
 {
   int sig_str_int = (int) std::round(sig_str);
-  int closest = signal_strengths[0];
-  for(int strength : signal_strengths)
+  const johnsonsuParams *closest = &m_johnsonsu_params[0];
+  for(const johnsonsuParams &params : m_johnsonsu_params)
     {
-      if (std::abs(sig_str_int - strength) < std::abs(sig_str_int - closest))
+      if (std::abs(sig_str_int - params.sig_str) < std::abs(sig_str_int - closest->sig_str))
       {
-          closest = strength;
+          closest = &params;
       }
     }
-  return closest;
+  return *closest;
 }
 
 // source start here
@@ -629,4 +1105,99 @@ WirelessSigStrFtmErrorModel::NormalCDFInverse(double p)
 }
 // source end here
 
+
+FtmGaussianStage::FtmGaussianStage (double standard_deviation, double mean)
+  : m_gauss_dist (mean, standard_deviation)
+{
+}
+
+FtmGaussianStage
+FtmGaussianStage::ForBandwidth (WiredFtmErrorModel::ChannelBandwidth bandwidth)
+{
+  if (bandwidth == WiredFtmErrorModel::Channel_40_MHz)
+    {
+      return FtmGaussianStage (WiredFtmErrorModel::m_standard_deviation_40MHz);
+    }
+  return FtmGaussianStage (WiredFtmErrorModel::m_standard_deviation_20MHz);
+}
+
+void
+FtmGaussianStage::Apply (FtmErrorRng &rng, const double *sig_strs, double *errors, std::size_t count)
+{
+  for (std::size_t i = 0; i < count; i++)
+    {
+      errors[i] += m_gauss_dist (rng);
+    }
+}
+
+FtmMapBiasStage::FtmMapBiasStage (Ptr<WirelessFtmErrorModel::FtmMap> map, Ptr<Node> node)
+  : m_map (map),
+    m_node (node)
+{
+}
+
+FtmMapBiasStage::FtmMapBiasStage (Ptr<WirelessFtmErrorModel::FtmMapSet> map_set, Ptr<Node> node)
+  : m_map_set (map_set),
+    m_node (node)
+{
+}
+
+void
+FtmMapBiasStage::SetPartner (Mac48Address partner)
+{
+  m_partner = partner;
+}
+
+void
+FtmMapBiasStage::Apply (FtmErrorRng &rng, const double *sig_strs, double *errors, std::size_t count)
+{
+  Ptr<WirelessFtmErrorModel::FtmMap> map = m_map_set != 0 ? m_map_set->GetMap (m_partner) : m_map;
+  if (m_node == 0 || map == 0)
+    {
+      return;
+    }
+  Vector position = m_node->GetObject<MobilityModel> ()->GetPosition ();
+  double bias = map->GetBias (position.x, position.y, position.z);
+  for (std::size_t i = 0; i < count; i++)
+    {
+      errors[i] += bias;
+    }
+}
+
+void
+FtmJohnsonSuStage::Apply (FtmErrorRng &rng, const double *sig_strs, double *errors, std::size_t count)
+{
+  std::uniform_real_distribution<double> uniform_generator (0, 1);
+  for (std::size_t i = 0; i < count; i++)
+    {
+      const WirelessSigStrFtmErrorModel::johnsonsuParams &j_p =
+        WirelessSigStrFtmErrorModel::getClosestSigStr (sig_strs[i]);
+      double u = uniform_generator (rng);
+      while (u == 0.0)
+        {
+          u = uniform_generator (rng);
+        }
+      double phi_inv_u = WirelessSigStrFtmErrorModel::NormalCDFInverse (u);
+      errors[i] += std::round (j_p.lamda * sinh ((phi_inv_u - j_p.gamma) / j_p.delta) + j_p.xi);
+    }
+}
+
+FtmNlosStage::FtmNlosStage (double probability, double mean_bias)
+  : m_nlos_dist (probability),
+    m_bias_dist (mean_bias > 0 ? 1.0 / mean_bias : 1.0)
+{
+}
+
+void
+FtmNlosStage::Apply (FtmErrorRng &rng, const double *sig_strs, double *errors, std::size_t count)
+{
+  for (std::size_t i = 0; i < count; i++)
+    {
+      if (m_nlos_dist (rng))
+        {
+          errors[i] += m_bias_dist (rng);
+        }
+    }
+}
+
 } /* namespace ns3 */
@@ -23,10 +23,65 @@
 
 #include <ns3/object.h>
 #include <random>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <algorithm>
 #include <ns3/node.h>
+#include <ns3/box.h>
+#include <ns3/mac48-address.h>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
 
 namespace ns3 {
 
+/**
+ * \brief Small random bit generator for the FTM error models.
+ * \ingroup FTM
+ *
+ * xoshiro256** generator seeded through splitmix64. It can drive the std distributions like a std::mt19937,
+ * but only needs 32 bytes of state instead of 2.5 kB, which matters when every session has its own model.
+ */
+class FtmErrorRng
+{
+public:
+  typedef uint64_t result_type; //!< Type of the generated values.
+
+  /**
+   * Creates the generator with the given seed.
+   *
+   * \param seed the seed
+   */
+  explicit FtmErrorRng (uint64_t seed = 5489u);
+
+  /**
+   * Seeds the generator.
+   *
+   * \param seed the seed
+   */
+  void Seed (uint64_t seed);
+
+  /**
+   * \return the smallest value the generator returns
+   */
+  static constexpr result_type min (void) { return 0; }
+
+  /**
+   * \return the largest value the generator returns
+   */
+  static constexpr result_type max (void) { return UINT64_MAX; }
+
+  /**
+   * \return the next value
+   */
+  result_type operator() (void);
+
+private:
+  uint64_t m_state[4]; //!< The generator state.
+};
+
 /**
  * \brief base class for all FTM Error models
  * \ingroup FTM
@@ -52,6 +107,33 @@ public:
    * \return always returns 0 as by default no error model is used.
    */
   virtual int GetFtmError (double sig_str);
+
+  /**
+   * Retrieves the errors of a whole burst in one call. By default GetFtmError is called for every sample,
+   * models that can evaluate several samples at once override this.
+   *
+   * \param sig_strs the signal strengths of the samples [dBm]
+   * \param errors array of at least count values the errors are written to
+   * \param count the number of samples
+   */
+  virtual void GetFtmErrors (const double *sig_strs, int64_t *errors, std::size_t count);
+
+  /**
+   * Tells the model the partner of the session it is used for. FtmSession calls this when the model is set.
+   * By default the partner is ignored, models with responder specific data override this.
+   *
+   * \param partner the MAC address of the partner
+   */
+  virtual void SetPartner (Mac48Address partner);
+
+  /**
+   * Returns the memory used by the model, including the state of the random generator. This is the size of the
+   * registered TypeId of the model, classes without an own TypeId override it. The FtmMap and FtmMapSet are
+   * shared between models and not included, see FtmMap::GetMemoryUsage.
+   *
+   * \return the memory usage in bytes
+   */
+  virtual uint64_t GetMemoryUsage (void) const;
 };
 
 /**
@@ -98,13 +180,13 @@ public:
   };
 
   /**
-   * Set the seed for the mt19937 generator.
+   * Set the seed for the random generator.
    * \param seed the seed
    */
   void SetSeed (std::uint_least32_t seed);
 
   /**
-   * Returns the currently used seed for the mt19937 generator.
+   * Returns the currently used seed for the random generator.
    * \return the seed
    */
   std::uint_least32_t GetSeed (void) const;
@@ -141,19 +223,21 @@ public:
   double GetStandardDeviation (void) const;
 
 protected:
-  std::mt19937 m_generator; //!< random generator
+  FtmErrorRng m_generator; //!< random generator
   std::normal_distribution<double> m_gauss_dist; //!< the distribution
   std::uint_least32_t m_seed;
 
   double m_mean = 0; //!< mean currently used
   double m_standard_deviation = 0; //!< standard deviation currently used
-  const double m_standard_deviation_20MHz = 2562.69; //!< value for 20MHz channel bandwidth
-  const double m_standard_deviation_40MHz = 1074.91; //!< value for 40MHz channel bandwidth
+  static constexpr double m_standard_deviation_20MHz = 2562.69; //!< value for 20MHz channel bandwidth
+  static constexpr double m_standard_deviation_40MHz = 1074.91; //!< value for 40MHz channel bandwidth
 
   /**
    * Updates the distribution when mean or standard deviation changes.
    */
   void UpdateDistribution (void);
+
+  friend class FtmGaussianStage;
 };
 
 /**
@@ -168,6 +252,7 @@ class WirelessFtmErrorModel : public WiredFtmErrorModel
 {
 public:
   class FtmMap;
+  class FtmMapSet;
 
   /**
    * \brief Get the type ID.
@@ -202,6 +287,21 @@ public:
    */
   Ptr<FtmMap> GetFtmMap (void) const;
 
+  /**
+   * Sets the FtmMapSet with one map per responder. If set, the map of the session partner is used instead
+   * of the map set with SetFtmMap.
+   *
+   * \param map_set the FtmMapSet to be used
+   */
+  void SetFtmMapSet (Ptr<FtmMapSet> map_set);
+
+  /**
+   * \return the FtmMapSet used by this model
+   */
+  Ptr<FtmMapSet> GetFtmMapSet (void) const;
+
+  void SetPartner (Mac48Address partner);
+
   /**
    * Sets the Node which is associated with this error model. Used to determine its position.
    *
@@ -216,6 +316,8 @@ public:
 
 private:
   Ptr<FtmMap> m_map; //!< Pointer to the map.
+  Ptr<FtmMapSet> m_map_set; //!< Pointer to the per responder maps.
+  Mac48Address m_partner; //!< The session partner.
   Ptr<Node> m_node; //!< Pointer to the node.
 };
 
@@ -241,14 +343,17 @@ public:
   virtual ~FtmMap ();
 
   /**
-   * Loads an existing map file created by the map generator.
+   * Loads an existing map file created by the map generator. Text .map files are read completely into
+   * memory. Tiled .ftmtiles files, created with the --totiles option of the generator, are only opened;
+   * their tiles are mapped into memory on first use and unmapped again when more than MaxResidentTiles
+   * tiles are in use.
    *
-   * \param filename the path/name to an existing .map file to be loaded
+   * \param filename the path/name to an existing .map or .ftmtiles file to be loaded
    */
   void LoadMap (std::string filename);
 
   /**
-   * Returns the bias from the map at a given point.
+   * Returns the bias from the map at a given point. For maps with several floors the lowest floor is used.
    *
    * \param x the x coordinate
    * \param y the y coordinate
@@ -256,7 +361,80 @@ public:
    */
   double GetBias (double x, double y);
 
+  /**
+   * Returns the bias from the map at a given point. The z coordinate selects the floor, maps with a single
+   * floor ignore it.
+   *
+   * \param x the x coordinate
+   * \param y the y coordinate
+   * \param z the z coordinate
+   * \return the bias at the given point
+   */
+  double GetBias (double x, double y, double z);
+
+  /**
+   * \return the area covered by the map, z covers all floors
+   */
+  Box GetBoundingBox (void) const;
+
+  /**
+   * Sets the maximum number of tiles of a tiled map that are mapped into memory at the same time.
+   *
+   * \param tiles the number of tiles, at least 1
+   */
+  void SetMaxResidentTiles (uint32_t tiles);
+
+  /**
+   * \return the number of tiles currently mapped into memory
+   */
+  uint32_t GetResidentTiles (void) const;
+
+  /**
+   * \return the memory used by the bias values of the map in bytes
+   */
+  uint64_t GetMemoryUsage (void) const;
+
 private:
+  /**
+   * A tile of a tiled map that is mapped into memory.
+   */
+  struct Tile
+  {
+    const float *data; //!< the bias values of the tile
+    void *mapping; //!< start of the memory mapping
+    std::size_t length; //!< length of the memory mapping
+    std::list<uint32_t>::iterator lru; //!< position in the LRU list
+  };
+
+  /**
+   * Opens a tiled map.
+   *
+   * \param filename the path/name of the .ftmtiles file
+   */
+  void LoadTiledMap (std::string filename);
+
+  /**
+   * Returns the tile with the given index, mapping it into memory on first use.
+   *
+   * \param index the tile index
+   * \return the bias values of the tile or 0 if the tile is empty
+   */
+  const float * GetTile (uint32_t index);
+
+  /**
+   * Unmaps all tiles and closes the tiled map.
+   */
+  void CloseTiledMap (void);
+
+  /**
+   * Quantizes a band of rows of a text map into packed 15 bit cells with a scale and an offset per tile.
+   *
+   * \param band the rows of the band
+   * \param band_index the index of the band
+   * \param rows the number of rows in the band
+   */
+  void QuantizeBand (const std::vector<double> &band, uint32_t band_index, uint32_t rows);
+
   double *map; //!< the map
 
   double xmin; //!< x axis minimum
@@ -267,6 +445,85 @@ private:
 
   int xsize; //!< x axis size
   int ysize; //!< y axis size
+
+  int m_fd; //!< file descriptor of the tiled map, -1 for text maps
+  uint32_t m_tile_size; //!< tile edge length in cells
+  uint32_t m_tiles_x; //!< tiles per row
+  uint32_t m_tiles_y; //!< tiles per column
+  uint32_t m_floors; //!< number of floors
+  double m_zmin; //!< z coordinate of the lowest floor
+  double m_floor_height; //!< height of one floor
+  std::vector<uint64_t> m_tile_offsets; //!< file offset of every tile, 0 for empty tiles
+  std::unordered_map<uint32_t, Tile> m_resident_tiles; //!< the tiles mapped into memory
+  std::list<uint32_t> m_lru; //!< resident tile indices, most recently used first
+  uint32_t m_max_resident_tiles; //!< maximum number of resident tiles
+  uint32_t m_last_tile_index; //!< index of the last used tile
+  const float *m_last_tile; //!< the last used tile
+
+  bool m_quantize; //!< if text maps are stored quantized
+  std::vector<uint8_t> m_cells; //!< the packed quantized cells of a text map
+  std::vector<double> m_tile_offsets_q; //!< bias of the quantized value 0 per tile
+  std::vector<double> m_tile_scales_q; //!< bias per quantization step per tile
+  uint32_t m_quantized_tiles_x; //!< quantization tiles per row
+};
+
+/**
+ * \brief Set of FtmMaps with one map per responder.
+ * \ingroup FTM
+ *
+ * The bias of a position depends on the responder, so every responder can have its own map. Responders
+ * without a map use the default map.
+ */
+class WirelessFtmErrorModel::FtmMapSet : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  FtmMapSet ();
+  virtual ~FtmMapSet ();
+
+  /**
+   * Adds the map of a responder, replacing an existing one.
+   *
+   * \param responder the MAC address of the responder
+   * \param map the map
+   */
+  void AddMap (Mac48Address responder, Ptr<FtmMap> map);
+
+  /**
+   * Loads the map of a responder from a file and adds it.
+   *
+   * \param responder the MAC address of the responder
+   * \param filename the path/name to an existing .map or .ftmtiles file to be loaded
+   * \return the loaded map
+   */
+  Ptr<FtmMap> LoadMap (Mac48Address responder, std::string filename);
+
+  /**
+   * Sets the map for responders without their own map.
+   *
+   * \param map the map, 0 for no bias
+   */
+  void SetDefaultMap (Ptr<FtmMap> map);
+
+  /**
+   * \param responder the MAC address of the responder
+   * \return the map of the responder, the default map if it has none
+   */
+  Ptr<FtmMap> GetMap (Mac48Address responder) const;
+
+  /**
+   * \return the memory used by the bias values of all maps in bytes
+   */
+  uint64_t GetMemoryUsage (void) const;
+
+private:
+  std::map<Mac48Address, Ptr<FtmMap>> m_maps; //!< the maps of the responders
+  Ptr<FtmMap> m_default_map; //!< the map for all other responders
 };
 
 /**
@@ -301,30 +558,362 @@ public:
   int GetFtmError (double sig_str);
 
 protected:
+  /**
+   * Johnson's SU distribution parameters measured at one signal strength.
+   */
   struct johnsonsuParams {
-    double gamma;
-    double delta;
-    double lamda;
-    double xi;
+    int sig_str; //!< the signal strength [dBm]
+    double gamma; //!< shape parameter
+    double delta; //!< shape parameter
+    double lamda; //!< scale parameter
+    double xi; //!< location parameter
   };
 
-  std::uniform_real_distribution<double> m_uniform_generator;
+  /**
+   * Returns the distribution parameters measured closest to the given signal strength. The parameters are
+   * stored once in a read only table shared by all instances.
+   *
+   * \param sig_str the signal strength [dBm]
+   * \return the parameters
+   */
+  static const johnsonsuParams & getClosestSigStr (double sig_str);
+
+  static const johnsonsuParams m_johnsonsu_params[17]; //!< the parameters of all measured signal strengths
+
+private:
+  static double NormalCDFInverse(double p);
+  static double RationalApproximation(double t);
+
+  friend class FtmJohnsonSuStage;
+};
+
+/**
+ * \brief Gaussian noise stage of an FtmErrorPipeline.
+ * \ingroup FTM
+ *
+ * Adds the gaussian error of the WiredFtmErrorModel to every sample.
+ */
+class FtmGaussianStage
+{
+public:
+  /**
+   * \param standard_deviation the standard deviation [ps]
+   * \param mean the mean [ps]
+   */
+  FtmGaussianStage (double standard_deviation, double mean = 0);
+
+  /**
+   * Creates the stage with the measured standard deviation of the given channel bandwidth.
+   *
+   * \param bandwidth the channel bandwidth, 20 or 40 MHz
+   * \return the stage
+   */
+  static FtmGaussianStage ForBandwidth (WiredFtmErrorModel::ChannelBandwidth bandwidth);
+
+  /**
+   * Adds the error of this stage to the samples.
+   *
+   * \param rng the random generator of the pipeline
+   * \param sig_strs the signal strengths of the samples [dBm]
+   * \param errors the errors, the stage adds to them
+   * \param count the number of samples
+   */
+  void Apply (FtmErrorRng &rng, const double *sig_strs, double *errors, std::size_t count);
+
+private:
+  std::normal_distribution<double> m_gauss_dist; //!< the distribution
+};
 
-  std::map<int, johnsonsuParams> m_sig_str_map;
+/**
+ * \brief Map bias stage of an FtmErrorPipeline.
+ * \ingroup FTM
+ *
+ * Adds the bias of the FtmMap at the position of the node, like the WirelessFtmErrorModel. With an FtmMapSet
+ * the map of the session partner is used. The position is looked up once per call, so a burst only needs one
+ * lookup.
+ */
+class FtmMapBiasStage
+{
+public:
+  /**
+   * \param map the map with the bias
+   * \param node the node whose position is used
+   */
+  FtmMapBiasStage (Ptr<WirelessFtmErrorModel::FtmMap> map, Ptr<Node> node);
 
-  // set the available signal strengths
-  const int signal_strengths[17] = {-34, -54, -57, -60, -63, -66, -69, -72, -74,
-                                  -75, -76, -77, -78, -79, -80, -81, -82};
+  /**
+   * \param map_set the maps of the responders
+   * \param node the node whose position is used
+   */
+  FtmMapBiasStage (Ptr<WirelessFtmErrorModel::FtmMapSet> map_set, Ptr<Node> node);
 
-  void initDistributions (void);
+  /**
+   * Selects the map of the partner from the FtmMapSet.
+   *
+   * \param partner the MAC address of the partner
+   */
+  void SetPartner (Mac48Address partner);
 
-  int getClosestSigStr (double sig_str);
+  /**
+   * Adds the error of this stage to the samples.
+   *
+   * \param rng the random generator of the pipeline
+   * \param sig_strs the signal strengths of the samples [dBm]
+   * \param errors the errors, the stage adds to them
+   * \param count the number of samples
+   */
+  void Apply (FtmErrorRng &rng, const double *sig_strs, double *errors, std::size_t count);
 
 private:
-  double NormalCDFInverse(double p);
-  double RationalApproximation(double t);
+  Ptr<WirelessFtmErrorModel::FtmMap> m_map; //!< the map
+  Ptr<WirelessFtmErrorModel::FtmMapSet> m_map_set; //!< the maps of the responders
+  Mac48Address m_partner; //!< the session partner
+  Ptr<Node> m_node; //!< the node
+};
+
+/**
+ * \brief Signal strength dependent Johnson's SU stage of an FtmErrorPipeline.
+ * \ingroup FTM
+ *
+ * Adds the signal strength dependent error of the WirelessSigStrFtmErrorModel, without its gaussian and
+ * map terms.
+ */
+class FtmJohnsonSuStage
+{
+public:
+  /**
+   * Adds the error of this stage to the samples.
+   *
+   * \param rng the random generator of the pipeline
+   * \param sig_strs the signal strengths of the samples [dBm]
+   * \param errors the errors, the stage adds to them
+   * \param count the number of samples
+   */
+  void Apply (FtmErrorRng &rng, const double *sig_strs, double *errors, std::size_t count);
 };
 
+/**
+ * \brief Non line of sight stage of an FtmErrorPipeline.
+ * \ingroup FTM
+ *
+ * With the given probability a sample travels over a longer, reflected path, which adds an exponentially
+ * distributed positive bias.
+ */
+class FtmNlosStage
+{
+public:
+  /**
+   * \param probability the probability of a non line of sight sample, between 0 and 1
+   * \param mean_bias the mean of the additional bias [ps]
+   */
+  FtmNlosStage (double probability, double mean_bias);
+
+  /**
+   * Adds the error of this stage to the samples.
+   *
+   * \param rng the random generator of the pipeline
+   * \param sig_strs the signal strengths of the samples [dBm]
+   * \param errors the errors, the stage adds to them
+   * \param count the number of samples
+   */
+  void Apply (FtmErrorRng &rng, const double *sig_strs, double *errors, std::size_t count);
+
+private:
+  std::bernoulli_distribution m_nlos_dist; //!< if a sample is non line of sight
+  std::exponential_distribution<double> m_bias_dist; //!< the additional bias
+};
+
+/**
+ * \brief Error model pipeline composed of independent stages.
+ * \ingroup FTM
+ *
+ * The stages are fixed at compile time, so all stage calls are direct and can be inlined, instead of going
+ * through the virtual chain of the error model classes. Every stage adds its error to all samples of a call,
+ * in the order the stages are given. A stage is any class with a method
+ * void Apply (FtmErrorRng &rng, const double *sig_strs, double *errors, std::size_t count).
+ * Stages with a method void SetPartner (Mac48Address partner) are told the session partner.
+ *
+ * Every stage has its own random generator, so the errors do not depend on how the samples are split into
+ * calls: one call with a whole burst gives the same errors as one call per sample.
+ *
+ * There is no SIMD path, the stages loop over the samples one by one. The draws cannot be vectorized:
+ * std::normal_distribution and the u == 0 redraw of the Johnson SU stage reject a variable number of values,
+ * so the state of the generator after a sample depends on the samples before it, and a lane wise generator
+ * would change the errors compared to WirelessFtmErrorModel and WirelessSigStrFtmErrorModel. The Johnson SU
+ * transform after the draw calls log, sqrt and sinh and looks up the closest signal strength per sample,
+ * which the compiler only vectorizes with -ffast-math and a vector math library, and the ns-3 build uses
+ * neither. The buffer of GetFtmErrors only batches the stage calls.
+ */
+template <typename... Stages>
+class FtmErrorPipeline
+{
+public:
+  /**
+   * \param seed the seed of the random generators
+   * \param stages the stages, applied in this order
+   */
+  explicit FtmErrorPipeline (std::uint_least32_t seed, Stages... stages)
+    : m_stages (stages...)
+  {
+    for (std::size_t i = 0; i < sizeof... (Stages); i++)
+      {
+        m_generators[i].Seed (((uint64_t) i << 32) | seed);
+      }
+  }
+
+  /**
+   * Evaluates the errors of all samples.
+   *
+   * \param sig_strs the signal strengths of the samples [dBm]
+   * \param errors array of at least count values the errors are written to [ps]
+   * \param count the number of samples
+   */
+  void Evaluate (const double *sig_strs, double *errors, std::size_t count)
+  {
+    std::fill (errors, errors + count, 0.0);
+    ApplyStages (sig_strs, errors, count, std::index_sequence_for<Stages...> ());
+  }
+
+  /**
+   * Tells all stages with a SetPartner method the partner of the session.
+   *
+   * \param partner the MAC address of the partner
+   */
+  void SetPartner (Mac48Address partner)
+  {
+    SetPartnerStages (partner, std::index_sequence_for<Stages...> ());
+  }
+
+  /**
+   * \return the stage at position I, e.g. to change its configuration
+   */
+  template <std::size_t I>
+  typename std::tuple_element<I, std::tuple<Stages...>>::type & GetStage (void)
+  {
+    return std::get<I> (m_stages);
+  }
+
+private:
+  /**
+   * Applies all stages in order.
+   */
+  template <std::size_t... I>
+  void ApplyStages (const double *sig_strs, double *errors, std::size_t count, std::index_sequence<I...>)
+  {
+    int expand[] = {0, (std::get<I> (m_stages).Apply (m_generators[I], sig_strs, errors, count), 0)...};
+    (void) expand;
+  }
+
+  /**
+   * Calls SetPartner of all stages that have one.
+   */
+  template <std::size_t... I>
+  void SetPartnerStages (Mac48Address partner, std::index_sequence<I...>)
+  {
+    int expand[] = {0, (SetStagePartner (std::get<I> (m_stages), partner, 0), 0)...};
+    (void) expand;
+  }
+
+  /**
+   * Sets the partner of a stage with a SetPartner method.
+   */
+  template <typename Stage>
+  static auto SetStagePartner (Stage &stage, Mac48Address partner, int) -> decltype (stage.SetPartner (partner), void ())
+  {
+    stage.SetPartner (partner);
+  }
+
+  /**
+   * Stages without a SetPartner method do not depend on the partner.
+   */
+  template <typename Stage>
+  static void SetStagePartner (Stage &stage, Mac48Address partner, long)
+  {
+  }
+
+  std::tuple<Stages...> m_stages; //!< the stages
+  FtmErrorRng m_generators[sizeof... (Stages) > 0 ? sizeof... (Stages) : 1]; //!< random generator per stage
+};
+
+/**
+ * \brief FtmErrorModel adapter for an FtmErrorPipeline.
+ * \ingroup FTM
+ *
+ * Makes a pipeline usable everywhere an FtmErrorModel is accepted, e.g. FtmSession::SetFtmErrorModel.
+ * Use CreateFtmErrorPipeline to create it.
+ */
+template <typename... Stages>
+class FtmPipelineErrorModel : public FtmErrorModel
+{
+public:
+  /**
+   * \param seed the seed of the random generator
+   * \param stages the stages, applied in this order
+   */
+  FtmPipelineErrorModel (std::uint_least32_t seed, Stages... stages)
+    : m_pipeline (seed, stages...)
+  {
+  }
+
+  int GetFtmError (double sig_str)
+  {
+    double error;
+    m_pipeline.Evaluate (&sig_str, &error, 1);
+    return (int) error;
+  }
+
+  void GetFtmErrors (const double *sig_strs, int64_t *errors, std::size_t count)
+  {
+    double buffer[64];
+    for (std::size_t offset = 0; offset < count; offset += 64)
+      {
+        std::size_t chunk = std::min<std::size_t> (64, count - offset);
+        m_pipeline.Evaluate (sig_strs + offset, buffer, chunk);
+        for (std::size_t i = 0; i < chunk; i++)
+          {
+            errors[offset + i] = (int64_t) buffer[i];
+          }
+      }
+  }
+
+  void SetPartner (Mac48Address partner)
+  {
+    m_pipeline.SetPartner (partner);
+  }
+
+  uint64_t GetMemoryUsage (void) const
+  {
+    return sizeof (*this);
+  }
+
+  /**
+   * \return the pipeline, e.g. to change the configuration of a stage
+   */
+  FtmErrorPipeline<Stages...> & GetPipeline (void)
+  {
+    return m_pipeline;
+  }
+
+private:
+  FtmErrorPipeline<Stages...> m_pipeline; //!< the pipeline
+};
+
+/**
+ * Creates an FtmErrorModel from the given stages, e.g.
+ * CreateFtmErrorPipeline (seed, FtmJohnsonSuStage (), FtmNlosStage (0.2, 3000)) for the signal strength
+ * dependent error without the gaussian term.
+ *
+ * \param seed the seed of the random generator
+ * \param stages the stages, applied in this order
+ * \return the error model
+ */
+template <typename... Stages>
+Ptr<FtmPipelineErrorModel<Stages...>>
+CreateFtmErrorPipeline (std::uint_least32_t seed, Stages... stages)
+{
+  return CreateObject<FtmPipelineErrorModel<Stages...>> (seed, stages...);
+}
+
 } /* namespace ns3 */
 
 #endif /* FTM_ERROR_MODEL_H_ */
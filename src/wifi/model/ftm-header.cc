@@ -19,9 +19,72 @@
  */
 
 #include "ftm-header.h"
+#include "ns3/mgt-headers.h"
+#include <cstring>
 
 namespace ns3 {
 
+/*
+ * Helpers for the fixed size parts of the FTM frames. The fields are assembled in a local buffer and
+ * moved with unaligned memcpy loads and stores, the byte order of the host is known at compile time.
+ */
+#if defined (__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+static const bool HOST_BIG_ENDIAN = true;
+#else
+static const bool HOST_BIG_ENDIAN = false;
+#endif
+
+static const uint64_t TIMESTAMP_MASK = 0xFFFFFFFFFFFF;
+
+static inline uint16_t
+HostToNetwork16 (uint16_t value)
+{
+  return HOST_BIG_ENDIAN ? value : __builtin_bswap16 (value);
+}
+
+static inline void
+StoreNetwork16 (uint8_t *buffer, uint16_t value)
+{
+  value = HostToNetwork16 (value);
+  std::memcpy (buffer, &value, 2);
+}
+
+static inline uint16_t
+LoadNetwork16 (const uint8_t *buffer)
+{
+  uint16_t value;
+  std::memcpy (&value, buffer, 2);
+  return HostToNetwork16 (value);
+}
+
+/*
+ * The 48 bit time stamps of the FTM response are in the byte order of the host,
+ * i.e. the least significant 6 bytes of the 64 bit value as they are in memory.
+ */
+static inline void
+StoreTimeStamp (uint8_t *buffer, uint64_t timestamp)
+{
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *> (&timestamp);
+  std::memcpy (buffer, bytes + (HOST_BIG_ENDIAN ? 2 : 0), 6);
+}
+
+/*
+ * Loads a time stamp written by StoreTimeStamp with one 64 bit load, so at least
+ * 8 bytes have to be readable from buffer (HOST_BIG_ENDIAN: from buffer - 2).
+ */
+static inline uint64_t
+LoadTimeStamp (const uint8_t *buffer)
+{
+  uint64_t timestamp;
+  if (HOST_BIG_ENDIAN)
+    {
+      std::memcpy (&timestamp, buffer - 2, 8);
+      return timestamp & TIMESTAMP_MASK;
+    }
+  std::memcpy (&timestamp, buffer, 8);
+  return timestamp & TIMESTAMP_MASK;
+}
+
 NS_OBJECT_ENSURE_REGISTERED (FtmParams);
 
 TypeId
@@ -70,43 +133,47 @@ FtmParams::GetSerializedSize (void) const
 void
 FtmParams::Serialize (Buffer::Iterator start) const
 {
-  start.WriteU8(m_element_id);
-  start.WriteU8(m_tag_length);
-  uint8_t tmp = (m_status_indication & 0x03) | ((m_status_indication_value & 0x1F) << 2);
-  start.WriteU8(tmp);
-  start.WriteU8((m_number_of_bursts_exponent & 0x0F) | (m_burst_duration << 4));
-  start.WriteU8(m_min_delta_ftm);
-  start.WriteHtonU16(m_partial_tsf_timer); //weird in wireshark
-  tmp = (m_partial_tsf_no_pref & 0x01) | ((m_asap_capable << 1) & 0x02) | ((m_asap << 2) & 0x04);
-  tmp |= ((m_ftms_per_burst << 3) & 0xF8);
-//  std::cout << (int) tmp << " " << (int) ((m_ftms_per_burst << 3) & 0xF8) << std::endl;
-  start.WriteU8(tmp);
-  start.WriteU8(m_format_and_bandwidth << 2);
-  start.WriteHtonU16(m_burst_period);
+  uint8_t buffer[11];
+  buffer[0] = m_element_id;
+  buffer[1] = m_tag_length;
+  buffer[2] = (m_status_indication & 0x03) | ((m_status_indication_value & 0x1F) << 2);
+  buffer[3] = (m_number_of_bursts_exponent & 0x0F) | (m_burst_duration << 4);
+  buffer[4] = m_min_delta_ftm;
+  StoreNetwork16 (buffer + 5, m_partial_tsf_timer); //weird in wireshark
+  buffer[7] = (m_partial_tsf_no_pref & 0x01) | ((m_asap_capable << 1) & 0x02) | ((m_asap << 2) & 0x04)
+      | ((m_ftms_per_burst << 3) & 0xF8);
+  buffer[8] = m_format_and_bandwidth << 2;
+  StoreNetwork16 (buffer + 9, m_burst_period);
+  start.Write (buffer, 11);
 }
 
 uint32_t
 FtmParams::Deserialize (Buffer::Iterator start)
 {
-  uint8_t element_id = start.ReadU8();
-  NS_ASSERT_MSG(element_id == m_element_id, "Received unsupported Tag in FTM Packet");
-  uint8_t length = start.ReadU8();
-  NS_ASSERT(length == m_tag_length);
-  uint8_t tmp = start.ReadU8();
-  m_status_indication = IntToStatusIndication (tmp & 0x03);
-  m_status_indication_value = (tmp >> 2) & 0x1F;
-  tmp = start.ReadU8();
-  m_number_of_bursts_exponent = tmp & 0x0F;
-  m_burst_duration = tmp >> 4;
-  m_min_delta_ftm = start.ReadU8();
-  m_partial_tsf_timer = start.ReadNtohU16(); //TODO weird in wireshark
-  tmp = start.ReadU8();
-  m_partial_tsf_no_pref = tmp & 0x01 ;
-  m_asap_capable = (tmp >> 1) & 0x01;
-  m_asap = (tmp >> 2) & 0x01;
-  m_ftms_per_burst = (tmp >> 3) & 0x1F;
-  m_format_and_bandwidth = start.ReadU8() >> 2;
-  m_burst_period = start.ReadNtohU16();
+  uint8_t buffer[11];
+  start.Read (buffer, 11);
+  NS_ASSERT_MSG (LoadNetwork16 (buffer) == ((m_element_id << 8) | m_tag_length),
+                 "Received unsupported Tag in FTM Packet");
+
+  //bytes 2 to 9 in one load, byte 2 ends up in the lowest bits
+  uint64_t fields;
+  std::memcpy (&fields, buffer + 2, 8);
+  if (HOST_BIG_ENDIAN)
+    {
+      fields = __builtin_bswap64 (fields);
+    }
+  m_status_indication = IntToStatusIndication (fields & 0x03);
+  m_status_indication_value = (fields >> 2) & 0x1F;
+  m_number_of_bursts_exponent = (fields >> 8) & 0x0F;
+  m_burst_duration = (fields >> 12) & 0x0F;
+  m_min_delta_ftm = (fields >> 16) & 0xFF;
+  m_partial_tsf_timer = LoadNetwork16 (buffer + 5); //TODO weird in wireshark
+  m_partial_tsf_no_pref = (fields >> 40) & 0x01;
+  m_asap_capable = (fields >> 41) & 0x01;
+  m_asap = (fields >> 42) & 0x01;
+  m_ftms_per_burst = (fields >> 43) & 0x1F;
+  m_format_and_bandwidth = (fields >> 50) & 0x3F;
+  m_burst_period = LoadNetwork16 (buffer + 9);
   return 11; // the number of bytes consumed.
 }
 
@@ -136,7 +203,7 @@ FtmParams::SetStatusIndication (StatusIndication status)
 }
 
 FtmParams::StatusIndication
-FtmParams::GetStatusIndication (void)
+FtmParams::GetStatusIndication (void) const
 {
   return m_status_indication;
 }
@@ -148,7 +215,7 @@ FtmParams::SetStatusIndicationValue (uint8_t value)
 }
 
 uint8_t
-FtmParams::GetStatusIndicationValue (void)
+FtmParams::GetStatusIndicationValue (void) const
 {
   return m_status_indication_value;
 }
@@ -160,7 +227,7 @@ FtmParams::SetNumberOfBurstsExponent (uint8_t burst_exponent)
 }
 
 uint8_t
-FtmParams::GetNumberOfBurstsExponent (void)
+FtmParams::GetNumberOfBurstsExponent (void) const
 {
   return m_number_of_bursts_exponent;
 }
@@ -172,7 +239,7 @@ FtmParams::SetBurstDuration (uint8_t burst_duration)
 }
 
 uint8_t
-FtmParams::GetBurstDuration (void)
+FtmParams::GetBurstDuration (void) const
 {
   return m_burst_duration;
 }
@@ -183,7 +250,7 @@ FtmParams::SetMinDeltaFtm (uint8_t min_delta_ftm)
   m_min_delta_ftm = min_delta_ftm;
 }
 uint8_t
-FtmParams::GetMinDeltaFtm (void)
+FtmParams::GetMinDeltaFtm (void) const
 {
   return m_min_delta_ftm;
 }
@@ -195,7 +262,7 @@ FtmParams::SetPartialTsfTimer (uint16_t partial_tsf_timer)
 }
 
 uint16_t
-FtmParams::GetPartialTsfTimer (void)
+FtmParams::GetPartialTsfTimer (void) const
 {
   return m_partial_tsf_timer;
 }
@@ -207,7 +274,7 @@ FtmParams::SetPartialTsfNoPref (bool tsf_no_pref)
 }
 
 bool
-FtmParams::GetPartialTsfNoPref (void)
+FtmParams::GetPartialTsfNoPref (void) const
 {
   return m_partial_tsf_no_pref;
 }
@@ -219,7 +286,7 @@ FtmParams::SetAsapCapable (bool asap_capable)
 }
 
 bool
-FtmParams::GetAsapCapable (void)
+FtmParams::GetAsapCapable (void) const
 {
   return m_asap_capable;
 }
@@ -231,7 +298,7 @@ FtmParams::SetAsap (bool asap)
 }
 
 bool
-FtmParams::GetAsap (void)
+FtmParams::GetAsap (void) const
 {
   return m_asap;
 }
@@ -243,7 +310,7 @@ FtmParams::SetFtmsPerBurst (uint8_t ftms_per_burst)
 }
 
 uint8_t
-FtmParams::GetFtmsPerBurst (void)
+FtmParams::GetFtmsPerBurst (void) const
 {
   return m_ftms_per_burst;
 }
@@ -255,7 +322,7 @@ FtmParams::SetFormatAndBandwidth (uint8_t format_bandwidth)
 }
 
 uint8_t
-FtmParams::GetFormatAndBandwidth (void)
+FtmParams::GetFormatAndBandwidth (void) const
 {
   return m_format_and_bandwidth;
 }
@@ -267,7 +334,7 @@ FtmParams::SetBurstPeriod (uint16_t burst_period)
 }
 
 uint16_t
-FtmParams::GetBurstPeriod (void)
+FtmParams::GetBurstPeriod (void) const
 {
   return m_burst_period;
 }
@@ -291,7 +358,7 @@ FtmParams::IntToStatusIndication (uint8_t status)
 
 // returns the burst duration in micro seconds
 uint32_t
-FtmParams::DecodeBurstDuration (void)
+FtmParams::DecodeBurstDuration (void) const
 {
   if (m_burst_duration < 2 || m_burst_duration > 11)
     {
@@ -300,6 +367,138 @@ FtmParams::DecodeBurstDuration (void)
   return 125 * (1 << (m_burst_duration - 1)); //125 * (2 ^ (m_burst_duration - 1))
 }
 
+namespace {
+
+/**
+ * The largest feasible min delta FTM for every burst duration and number of FTMs per burst,
+ * -1 if the burst duration is a reserved value.
+ * A min delta FTM is feasible if all FTMs plus one fit into the burst duration with this spacing.
+ */
+class FeasibilityTable
+{
+public:
+  constexpr FeasibilityTable ()
+    : m_max_min_delta_ftm {}
+  {
+    for (uint32_t burst_duration = 0; burst_duration < 16; burst_duration++)
+      {
+        for (uint32_t ftms_per_burst = 0; ftms_per_burst < 32; ftms_per_burst++)
+          {
+            m_max_min_delta_ftm[burst_duration][ftms_per_burst] = Evaluate (burst_duration, ftms_per_burst);
+          }
+      }
+  }
+
+  constexpr int16_t Get (uint8_t burst_duration, uint8_t ftms_per_burst) const
+  {
+    return m_max_min_delta_ftm[burst_duration & 0xF][ftms_per_burst & 0x1F];
+  }
+
+  /*
+   * if the combination is one of the combinations that did not start in earlier sweeps
+   */
+  constexpr bool FailedInSweeps (uint8_t burst_duration, uint8_t min_delta_ftm, uint8_t ftms_per_burst) const
+  {
+    for (const FailedCombination &failed : m_failed_in_sweeps)
+      {
+        if (failed.burst_duration == burst_duration && failed.min_delta_ftm == min_delta_ftm
+            && (failed.ftms_per_burst == 0 || failed.ftms_per_burst == ftms_per_burst))
+          {
+            return true;
+          }
+      }
+    return false;
+  }
+
+private:
+  /**
+   * A combination that did not start in earlier sweeps, FTMs per burst 0 matches any number of FTMs.
+   */
+  struct FailedCombination
+  {
+    uint8_t burst_duration; //!< the encoded burst duration
+    uint8_t min_delta_ftm; //!< the min delta FTM in 100 us, as stored in the 8 bit field
+    uint8_t ftms_per_burst; //!< the FTMs per burst, 0 for any
+  };
+
+  //the sweeps used a min delta FTM of 640, which is truncated to 128 in the 8 bit field
+  static constexpr FailedCombination m_failed_in_sweeps[] = {
+    {11, 5, 0}, {11, 10, 0}, {11, 128, 2}, {11, 128, 3}
+  };
+
+  /*
+   * same rules as in FtmParams::DecodeBurstDuration
+   */
+  static constexpr int16_t Evaluate (uint32_t burst_duration, uint32_t ftms_per_burst)
+  {
+    if (burst_duration <= 1 || burst_duration >= 12)
+      {
+        return -1;
+      }
+    uint32_t decoded_burst_duration = 125 * (1 << (burst_duration - 1));
+    uint32_t max_min_delta_ftm = decoded_burst_duration / ((ftms_per_burst + 1) * 100);
+    return max_min_delta_ftm > 255 ? 255 : max_min_delta_ftm;
+  }
+
+  int16_t m_max_min_delta_ftm[16][32];
+};
+
+constexpr FeasibilityTable::FailedCombination FeasibilityTable::m_failed_in_sweeps[];
+constexpr FeasibilityTable g_feasibility_table;
+
+} // anonymous namespace
+
+FtmParamsFeasibility::Result
+FtmParamsFeasibility::Check (uint8_t burst_duration, uint8_t min_delta_ftm, uint8_t ftms_per_burst, bool single_burst)
+{
+  int16_t max_min_delta_ftm = g_feasibility_table.Get (burst_duration, ftms_per_burst);
+  if (max_min_delta_ftm < 0)
+    {
+      return RESERVED_BURST_DURATION;
+    }
+  if (min_delta_ftm > max_min_delta_ftm)
+    {
+      return BURST_TOO_SHORT;
+    }
+  if (ftms_per_burst == 1 && single_burst)
+    {
+      return SINGLE_FTM;
+    }
+  if (g_feasibility_table.FailedInSweeps (burst_duration, min_delta_ftm, ftms_per_burst))
+    {
+      return FAILED_IN_SWEEPS;
+    }
+  return FEASIBLE;
+}
+
+FtmParamsFeasibility::Result
+FtmParamsFeasibility::Check (const FtmParams &params)
+{
+  return Check (params.GetBurstDuration (), params.GetMinDeltaFtm (), params.GetFtmsPerBurst (),
+                params.GetNumberOfBurstsExponent () == 0);
+}
+
+const char *
+FtmParamsFeasibility::GetDescription (Result result)
+{
+  switch (result)
+    {
+    case FEASIBLE:
+      return "Feasible.";
+    case RESERVED_BURST_DURATION:
+      return "Burst duration set to a reserved value. Should be in range [2, 11] or 15 if no preference.";
+    case BURST_TOO_SHORT:
+      return "This may be caused by a too small burst duration, too many FTMs per burst for the specified burst "
+             "duration or a too large min delta FTM for the specified burst duration and FTMs per burst.";
+    case SINGLE_FTM:
+      return "Can not do anything useful with 1 FTM per burst and 1 burst.";
+    case FAILED_IN_SWEEPS:
+      return "The session did not start with this combination in earlier simulation sweeps: burst duration 11 with "
+             "min delta FTM 5 or 10, or with 2 or 3 FTMs per burst and min delta FTM 640 (128 in the 8 bit field).";
+    }
+  return "unknown";
+}
+
 NS_OBJECT_ENSURE_REGISTERED (FtmParamsHolder);
 
 TypeId
@@ -324,13 +523,13 @@ FtmParamsHolder::~FtmParamsHolder ()
 }
 
 void
-FtmParamsHolder::SetFtmParams (FtmParams params)
+FtmParamsHolder::SetFtmParams (const FtmParams &params)
 {
   m_ftm_params = params;
 }
 
-FtmParams
-FtmParamsHolder::GetFtmParams ()
+const FtmParams &
+FtmParamsHolder::GetFtmParams () const
 {
   return m_ftm_params;
 }
@@ -425,31 +624,32 @@ FtmRequestHeader::SetTrigger (uint8_t trigger)
 }
 
 uint8_t
-FtmRequestHeader::GetTrigger (void)
+FtmRequestHeader::GetTrigger (void) const
 {
   return m_trigger;
 }
 
 void
-FtmRequestHeader::SetFtmParams (FtmParams ftm_params)
+FtmRequestHeader::SetFtmParams (const FtmParams &ftm_params)
 {
   m_ftm_params = ftm_params;
   m_ftm_params_set = true;
 }
 
 
-FtmParams
-FtmRequestHeader::GetFtmParams (void)
+const FtmParams &
+FtmRequestHeader::GetFtmParams (void) const
 {
   if (m_ftm_params_set)
     {
       return m_ftm_params;
     }
-  return FtmParams();
+  static const FtmParams unset_params;
+  return unset_params;
 }
 
 bool
-FtmRequestHeader::GetFtmParamsSet (void)
+FtmRequestHeader::GetFtmParamsSet (void) const
 {
   return m_ftm_params_set;
 }
@@ -486,12 +686,6 @@ FtmResponseHeader::FtmResponseHeader ()
   m_tod_error = 0;
   m_toa_error = 0;
 
-  union { //source: https://stackoverflow.com/a/1001373
-    uint32_t i;
-    char c[4];
-  } bint = {0x01020304};
-  m_big_endian = bint.c[0] == 1;
-
   m_ftm_params_set = false;
 }
 
@@ -519,28 +713,14 @@ FtmResponseHeader::GetSerializedSize (void) const
 void
 FtmResponseHeader::Serialize (Buffer::Iterator start) const
 {
-  start.WriteU8(m_dialog_token);
-  start.WriteU8(m_follow_up_dialog_token);
-
-  if(m_big_endian) {
-      for(int i = 0; i < 6; i++) {
-          start.WriteU8((m_tod >> (40 - 8 * i)) &0xFF);
-      }
-      for(int i = 0; i < 6; i++) {
-          start.WriteU8((m_toa >> (40 - 8 * i)) &0xFF);
-      }
-  }
-  else {
-      for(int i = 0; i < 6; i++) {
-          start.WriteU8((m_tod >> (8 * i)) &0xFF);
-      }
-      for(int i = 0; i < 6; i++) {
-          start.WriteU8((m_toa >> (8 * i)) &0xFF);
-      }
-  }
-
-  start.WriteHtonU16(m_tod_error);
-  start.WriteHtonU16(m_toa_error);
+  uint8_t buffer[18];
+  buffer[0] = m_dialog_token;
+  buffer[1] = m_follow_up_dialog_token;
+  StoreTimeStamp (buffer + 2, m_tod);
+  StoreTimeStamp (buffer + 8, m_toa);
+  StoreNetwork16 (buffer + 14, m_tod_error);
+  StoreNetwork16 (buffer + 16, m_toa_error);
+  start.Write (buffer, 18);
 
   if (m_ftm_params_set)
     {
@@ -551,42 +731,14 @@ FtmResponseHeader::Serialize (Buffer::Iterator start) const
 uint32_t
 FtmResponseHeader::Deserialize (Buffer::Iterator start)
 {
-  m_dialog_token = start.ReadU8();
-  m_follow_up_dialog_token = start.ReadU8();
-  uint8_t tod_buffer[6];
-  start.Read (tod_buffer, 6);
-  uint8_t toa_buffer[6];
-  start.Read (toa_buffer, 6);
-  m_tod = 0;
-  m_toa = 0;
-
-  if(m_big_endian) {
-      int i;
-      for(i = 0; i < 5; i++) {
-          m_tod |= tod_buffer[i];
-          m_tod <<= 8;
-
-          m_toa |= toa_buffer[i];
-          m_toa <<= 8;
-      }
-      m_tod |= tod_buffer[i];
-      m_toa |= toa_buffer[i];
-  }
-  else {
-      int i;
-      for(i = 5; i > 0; i--) {
-          m_tod |= tod_buffer[i];
-          m_tod <<= 8;
-
-          m_toa |= toa_buffer[i];
-          m_toa <<= 8;
-      }
-      m_tod |= tod_buffer[i];
-      m_toa |= toa_buffer[i];
-  }
-
-  m_tod_error = start.ReadNtohU16();
-  m_toa_error = start.ReadNtohU16();
+  uint8_t buffer[18];
+  start.Read (buffer, 18);
+  m_dialog_token = buffer[0];
+  m_follow_up_dialog_token = buffer[1];
+  m_tod = LoadTimeStamp (buffer + 2);
+  m_toa = LoadTimeStamp (buffer + 8);
+  m_tod_error = LoadNetwork16 (buffer + 14);
+  m_toa_error = LoadNetwork16 (buffer + 16);
 
   if (start.GetRemainingSize() >= m_ftm_params.GetSerializedSize()
       && start.PeekU8() == 206)
@@ -617,7 +769,7 @@ FtmResponseHeader::SetDialogToken (uint8_t dialog_token)
 }
 
 uint8_t
-FtmResponseHeader::GetDialogToken (void)
+FtmResponseHeader::GetDialogToken (void) const
 {
   return m_dialog_token;
 }
@@ -629,7 +781,7 @@ FtmResponseHeader::SetFollowUpDialogToken (uint8_t follow_up_dialog_token)
 }
 
 uint8_t
-FtmResponseHeader::GetFollowUpDialogToken (void)
+FtmResponseHeader::GetFollowUpDialogToken (void) const
 {
   return m_follow_up_dialog_token;
 }
@@ -641,7 +793,7 @@ FtmResponseHeader::SetTimeOfDeparture (uint64_t tod)
 }
 
 uint64_t
-FtmResponseHeader::GetTimeOfDeparture (void)
+FtmResponseHeader::GetTimeOfDeparture (void) const
 {
   return m_tod;
 }
@@ -653,7 +805,7 @@ FtmResponseHeader::SetTimeOfArrival (uint64_t toa)
 }
 
 uint64_t
-FtmResponseHeader::GetTimeOfArrival (void)
+FtmResponseHeader::GetTimeOfArrival (void) const
 {
   return m_toa;
 }
@@ -665,7 +817,7 @@ FtmResponseHeader::SetTimeOfDepartureError (uint16_t tod_error)
 }
 
 uint16_t
-FtmResponseHeader::GetTimeOfDepartureError (void)
+FtmResponseHeader::GetTimeOfDepartureError (void) const
 {
   return m_tod_error;
 }
@@ -677,31 +829,32 @@ FtmResponseHeader::SetTimeOfArrivalError (uint16_t toa_error)
 }
 
 uint16_t
-FtmResponseHeader::GetTimeOfArrivalError (void)
+FtmResponseHeader::GetTimeOfArrivalError (void) const
 {
   return m_toa_error;
 }
 
 void
-FtmResponseHeader::SetFtmParams (FtmParams ftm_params)
+FtmResponseHeader::SetFtmParams (const FtmParams &ftm_params)
 {
   m_ftm_params = ftm_params;
   m_ftm_params_set = true;
 }
 
 
-FtmParams
-FtmResponseHeader::GetFtmParams (void)
+const FtmParams &
+FtmResponseHeader::GetFtmParams (void) const
 {
   if (m_ftm_params_set)
     {
       return m_ftm_params;
     }
-  return FtmParams();
+  static const FtmParams unset_params;
+  return unset_params;
 }
 
 bool
-FtmResponseHeader::GetFtmParamsSet (void)
+FtmResponseHeader::GetFtmParamsSet (void) const
 {
   return m_ftm_params_set;
 }
@@ -781,4 +934,315 @@ TsfSyncInfo::GetTsfSyncInfo (void) const
   return tsf_sync_info;
 }
 
+/*
+ * 48 bit time stamps of the multi user elements are written least significant byte first
+ */
+static void
+WriteTimeStamp (Buffer::Iterator &start, uint64_t timestamp)
+{
+  for(int i = 0; i < 6; i++) {
+      start.WriteU8((timestamp >> (8 * i)) & 0xFF);
+  }
+}
+
+static uint64_t
+ReadTimeStamp (Buffer::Iterator &start)
+{
+  uint64_t timestamp = 0;
+  for(int i = 0; i < 6; i++) {
+      timestamp |= ((uint64_t) start.ReadU8()) << (8 * i);
+  }
+  return timestamp;
+}
+
+static bool
+CheckNextElement (Ptr<const Packet> packet, uint8_t element_id, uint8_t element_id_extension)
+{
+  if (packet->GetSize () < 2)
+    {
+      return false;
+    }
+  uint8_t ids[2];
+  packet->CopyData (ids, 2);
+  return ids[0] == element_id && ids[1] == element_id_extension;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (FtmMultiUserPoll);
+
+FtmMultiUserPoll::FtmMultiUserPoll ()
+{
+
+}
+
+FtmMultiUserPoll::~FtmMultiUserPoll ()
+{
+
+}
+
+TypeId
+FtmMultiUserPoll::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("FtmMultiUserPoll")
+    .SetParent<Header> ()
+    .AddConstructor<FtmMultiUserPoll> ()
+  ;
+  return tid;
+}
+
+TypeId
+FtmMultiUserPoll::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+FtmMultiUserPoll::GetSerializedSize (void) const
+{
+  //element id, extension, 2 byte user count and 6 + 1 + 6 + 6 bytes per user
+  return 4 + 19 * m_users.size ();
+}
+
+void
+FtmMultiUserPoll::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_element_id);
+  start.WriteU8 (m_element_id_extension);
+  start.WriteHtonU16 (m_users.size ());
+  for (const UserEntry &user : m_users)
+    {
+      uint8_t address[6];
+      user.address.CopyTo (address);
+      start.Write (address, 6);
+      start.WriteU8 (user.follow_up_dialog_token);
+      WriteTimeStamp (start, user.tod);
+      WriteTimeStamp (start, user.toa);
+    }
+}
+
+uint32_t
+FtmMultiUserPoll::Deserialize (Buffer::Iterator start)
+{
+  uint8_t tmp = start.ReadU8 ();
+  NS_ASSERT (tmp == m_element_id);
+  tmp = start.ReadU8 ();
+  NS_ASSERT (tmp == m_element_id_extension);
+  uint16_t count = start.ReadNtohU16 ();
+  m_users.clear ();
+  m_users.reserve (count);
+  for (uint16_t i = 0; i < count; i++)
+    {
+      UserEntry user;
+      uint8_t address[6];
+      start.Read (address, 6);
+      user.address.CopyFrom (address);
+      user.follow_up_dialog_token = start.ReadU8 ();
+      user.tod = ReadTimeStamp (start);
+      user.toa = ReadTimeStamp (start);
+      m_users.push_back (user);
+    }
+  return GetSerializedSize ();
+}
+
+void
+FtmMultiUserPoll::Print (std::ostream &os) const
+{
+  os << "users=" << m_users.size ();
+  for (const UserEntry &user : m_users)
+    {
+      os << ", [" << user.address
+          << ", FollowUpDialogToken=" << (int) user.follow_up_dialog_token
+          << ", TOD=" << user.tod << ", TOA=" << user.toa << "]";
+    }
+}
+
+void
+FtmMultiUserPoll::AddUser (Mac48Address address, uint8_t follow_up_dialog_token, uint64_t tod, uint64_t toa)
+{
+  UserEntry user;
+  user.address = address;
+  user.follow_up_dialog_token = follow_up_dialog_token;
+  user.tod = tod;
+  user.toa = toa;
+  m_users.push_back (user);
+}
+
+const std::vector<FtmMultiUserPoll::UserEntry>&
+FtmMultiUserPoll::GetUsers (void) const
+{
+  return m_users;
+}
+
+int
+FtmMultiUserPoll::GetUserIndex (Mac48Address address) const
+{
+  for (unsigned int i = 0; i < m_users.size (); i++)
+    {
+      if (m_users[i].address == address)
+        {
+          return i;
+        }
+    }
+  return -1;
+}
+
+bool
+FtmMultiUserPoll::IsNextElement (Ptr<const Packet> packet)
+{
+  return CheckNextElement (packet, m_element_id, m_element_id_extension);
+}
+
+NS_OBJECT_ENSURE_REGISTERED (FtmMultiUserReply);
+
+FtmMultiUserReply::FtmMultiUserReply ()
+{
+  m_dialog_token = 0;
+}
+
+FtmMultiUserReply::~FtmMultiUserReply ()
+{
+
+}
+
+TypeId
+FtmMultiUserReply::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("FtmMultiUserReply")
+    .SetParent<Header> ()
+    .AddConstructor<FtmMultiUserReply> ()
+  ;
+  return tid;
+}
+
+TypeId
+FtmMultiUserReply::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+FtmMultiUserReply::GetSerializedSize (void) const
+{
+  return 9;
+}
+
+void
+FtmMultiUserReply::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_element_id);
+  start.WriteU8 (m_element_id_extension);
+  uint8_t address[6];
+  m_responder.CopyTo (address);
+  start.Write (address, 6);
+  start.WriteU8 (m_dialog_token);
+}
+
+uint32_t
+FtmMultiUserReply::Deserialize (Buffer::Iterator start)
+{
+  uint8_t tmp = start.ReadU8 ();
+  NS_ASSERT (tmp == m_element_id);
+  tmp = start.ReadU8 ();
+  NS_ASSERT (tmp == m_element_id_extension);
+  uint8_t address[6];
+  start.Read (address, 6);
+  m_responder.CopyFrom (address);
+  m_dialog_token = start.ReadU8 ();
+  return GetSerializedSize ();
+}
+
+void
+FtmMultiUserReply::Print (std::ostream &os) const
+{
+  os << "responder=" << m_responder << ", DialogToken=" << (int) m_dialog_token;
+}
+
+void
+FtmMultiUserReply::SetResponder (Mac48Address responder)
+{
+  m_responder = responder;
+}
+
+Mac48Address
+FtmMultiUserReply::GetResponder (void) const
+{
+  return m_responder;
+}
+
+void
+FtmMultiUserReply::SetDialogToken (uint8_t dialog_token)
+{
+  m_dialog_token = dialog_token;
+}
+
+uint8_t
+FtmMultiUserReply::GetDialogToken (void) const
+{
+  return m_dialog_token;
+}
+
+bool
+FtmMultiUserReply::IsNextElement (Ptr<const Packet> packet)
+{
+  return CheckNextElement (packet, m_element_id, m_element_id_extension);
+}
+
+FtmResponseFrameTemplate::FtmResponseFrameTemplate ()
+{
+  //serialize the headers only once, every template starts as a copy of these bytes
+  static uint8_t prototype[m_size];
+  static bool prototype_set = false;
+  if (!prototype_set)
+    {
+      Ptr<Packet> packet = Create<Packet> ();
+      TsfSyncInfo tsf_sync;
+      packet->AddHeader (tsf_sync);
+      FtmResponseHeader ftm_res_hdr;
+      packet->AddHeader (ftm_res_hdr);
+      WifiActionHeader action_hdr;
+      WifiActionHeader::ActionValue action;
+      action.publicAction = WifiActionHeader::FTM_RESPONSE;
+      action_hdr.SetAction (WifiActionHeader::PUBLIC_ACTION, action);
+      packet->AddHeader (action_hdr);
+      NS_ASSERT (packet->GetSize () == m_size);
+      packet->CopyData (prototype, m_size);
+      prototype_set = true;
+    }
+  std::memcpy (m_buffer, prototype, m_size);
+}
+
+FtmResponseFrameTemplate::~FtmResponseFrameTemplate ()
+{
+
+}
+
+void
+FtmResponseFrameTemplate::SetDialogToken (uint8_t dialog_token)
+{
+  m_buffer[m_action_size] = dialog_token;
+}
+
+void
+FtmResponseFrameTemplate::SetFollowUp (uint8_t dialog_token, uint64_t tod, uint64_t toa)
+{
+  m_buffer[m_action_size + 1] = dialog_token;
+  WriteTimeStamp (m_action_size + 2, tod);
+  WriteTimeStamp (m_action_size + 8, toa);
+}
+
+Ptr<Packet>
+FtmResponseFrameTemplate::CreatePacket (bool add_tsf_sync) const
+{
+  if (add_tsf_sync)
+    {
+      return Create<Packet> (m_buffer, m_size);
+    }
+  return Create<Packet> (m_buffer, m_size - m_tsf_sync_size);
+}
+
+void
+FtmResponseFrameTemplate::WriteTimeStamp (uint32_t offset, uint64_t timestamp)
+{
+  StoreTimeStamp (m_buffer + offset, timestamp);
+}
+
 } /* namespace ns3 */
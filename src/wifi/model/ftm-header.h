@@ -23,6 +23,10 @@
 
 #include "ns3/header.h"
 #include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/mac48-address.h"
+#include "ns3/ftm-copy-counter.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -72,7 +76,7 @@ public:
    *
    * \return the StatusIndication field
    */
-  StatusIndication GetStatusIndication (void);
+  StatusIndication GetStatusIndication (void) const;
 
   /**
    * Set the status indication value field.
@@ -86,7 +90,7 @@ public:
    *
    * \return the status indication value
    */
-  uint8_t GetStatusIndicationValue (void);
+  uint8_t GetStatusIndicationValue (void) const;
 
   /**
    * Set the number of bursts exponent field.
@@ -100,7 +104,7 @@ public:
    *
    * \return the number of bursts exponent
    */
-  uint8_t GetNumberOfBurstsExponent (void);
+  uint8_t GetNumberOfBurstsExponent (void) const;
 
   /**
    * Set the burst duration field.
@@ -114,7 +118,7 @@ public:
    *
    * \return the burst duration
    */
-  uint8_t GetBurstDuration (void);
+  uint8_t GetBurstDuration (void) const;
 
   /**
    * Set the min delta FTM field.
@@ -128,7 +132,7 @@ public:
    *
    * \return the min delta FTM
    */
-  uint8_t GetMinDeltaFtm (void);
+  uint8_t GetMinDeltaFtm (void) const;
 
   /**
    * Set the partial TSF timer field.
@@ -142,7 +146,7 @@ public:
    *
    * \return the partial TSF timer
    */
-  uint16_t GetPartialTsfTimer (void);
+  uint16_t GetPartialTsfTimer (void) const;
 
   /**
    * Set the partial TSF no pref field.
@@ -156,7 +160,7 @@ public:
    *
    * \return the partial TSF no pref
    */
-  bool GetPartialTsfNoPref (void);
+  bool GetPartialTsfNoPref (void) const;
 
   /**
    * Set the ASAP capable field.
@@ -170,7 +174,7 @@ public:
    *
    * \return the ASAP capable
    */
-  bool GetAsapCapable (void);
+  bool GetAsapCapable (void) const;
 
   /**
    * Set the ASAP field.
@@ -184,7 +188,7 @@ public:
    *
    * \return the ASAP
    */
-  bool GetAsap (void);
+  bool GetAsap (void) const;
 
   /**
    * Set the FTMs per burst field.
@@ -198,7 +202,7 @@ public:
    *
    * \return the FTMs per burst
    */
-  uint8_t GetFtmsPerBurst (void);
+  uint8_t GetFtmsPerBurst (void) const;
 
   /**
    * Set the format and bandwidth field. This is not used in the implementation.
@@ -212,7 +216,7 @@ public:
    *
    * \return the format and bandwidth
    */
-  uint8_t GetFormatAndBandwidth (void);
+  uint8_t GetFormatAndBandwidth (void) const;
 
   /**
    * Set the burst period field.
@@ -226,7 +230,7 @@ public:
    *
    * \return the burst duration
    */
-  uint16_t GetBurstPeriod (void);
+  uint16_t GetBurstPeriod (void) const;
 
   /**
    * Returns the burst duration in micro seconds. Used to convert the header value into a Time value.
@@ -234,7 +238,7 @@ public:
    *
    * \return the decoded burst duration
    */
-  uint32_t DecodeBurstDuration (void);
+  uint32_t DecodeBurstDuration (void) const;
 
 private:
   /**
@@ -261,6 +265,67 @@ private:
   uint8_t m_ftms_per_burst;
   uint8_t m_format_and_bandwidth;
   uint16_t m_burst_period;
+#ifdef NS3_FTM_COUNT_COPIES
+  FtmCopyCounter<FtmParams> m_copy_counter; //!< Counts the copies.
+#endif
+};
+
+/**
+ * \brief Feasibility table of the FTM parameters.
+ * \ingroup FTM
+ *
+ * The timing rules of FtmSession::ValidateFtmParams. The largest feasible min delta FTM is computed at compile time
+ * for every burst duration and number of FTMs per burst, so a check is a single table lookup. The session validates
+ * the FTM parameters with it, and the sweep tooling uses it to never start a simulation with infeasible parameters.
+ *
+ * The table holds resolved values. The "no preference" values (burst duration 15, min delta FTM 0 and
+ * FTMs per burst 0) need to be replaced by the defaults before the lookup, as the session does.
+ *
+ * Besides the timing rules, the table lists the combinations that fit into the burst duration but did not start
+ * in earlier simulation sweeps: burst duration 11 with min delta FTM 5 or 10, and burst duration 11 with 2 or 3
+ * FTMs per burst and min delta FTM 640, which is 128 in the 8 bit field.
+ */
+class FtmParamsFeasibility
+{
+public:
+  /**
+   * The result of the feasibility check.
+   */
+  enum Result
+  {
+    FEASIBLE = 0,
+    RESERVED_BURST_DURATION = 1, //!< Burst duration is a reserved value.
+    BURST_TOO_SHORT = 2, //!< The FTMs with min delta FTM spacing do not fit into the burst duration.
+    SINGLE_FTM = 3, //!< 1 FTM per burst and 1 burst, which can not produce a measurement.
+    FAILED_IN_SWEEPS = 4 //!< Fits into the burst duration, but the session did not start in earlier sweeps.
+  };
+
+  /**
+   * Looks up the feasibility of the timing parameters.
+   *
+   * \param burst_duration the encoded burst duration
+   * \param min_delta_ftm the min delta FTM in 100 us
+   * \param ftms_per_burst the FTMs per burst
+   * \param single_burst if the number of bursts exponent is 0
+   * \return the result of the check
+   */
+  static Result Check (uint8_t burst_duration, uint8_t min_delta_ftm, uint8_t ftms_per_burst, bool single_burst);
+
+  /**
+   * Looks up the feasibility of the timing parameters of an FtmParams header.
+   *
+   * \param params the FTM parameters, with resolved "no preference" values
+   * \return the result of the check
+   */
+  static Result Check (const FtmParams &params);
+
+  /**
+   * Returns a description of a check result, for error messages.
+   *
+   * \param result the result
+   * \return the description
+   */
+  static const char * GetDescription (Result result);
 };
 
 /**
@@ -287,14 +352,14 @@ public:
     *
     * \param params the FtmParams to set
     */
-   void SetFtmParams (FtmParams params);
+   void SetFtmParams (const FtmParams &params);
 
    /**
     * Get the FTM parameters.
     *
     * \return the FtmParams
     */
-   FtmParams GetFtmParams (void);
+   const FtmParams & GetFtmParams (void) const;
 
 private:
    FtmParams m_ftm_params; //!< FtmParams
@@ -336,33 +401,36 @@ public:
    *
    * \return the trigger
    */
-  uint8_t GetTrigger (void);
+  uint8_t GetTrigger (void) const;
 
   /**
    * Set the FTM parameters.
    *
    * \param ftm_params the FtmParams
    */
-  void SetFtmParams (FtmParams ftm_params);
+  void SetFtmParams (const FtmParams &ftm_params);
 
   /**
    * Returns the FTM parameters, if set.
    *
    * \return the FtmParams
    */
-  FtmParams GetFtmParams (void);
+  const FtmParams & GetFtmParams (void) const;
 
   /**
    * Returns true if the FTM parameters have been set.
    *
    * \return if FtmParams have been set
    */
-  bool GetFtmParamsSet (void);
+  bool GetFtmParamsSet (void) const;
 
 private:
   uint8_t m_trigger;
   FtmParams m_ftm_params;
   bool m_ftm_params_set;
+#ifdef NS3_FTM_COUNT_COPIES
+  FtmCopyCounter<FtmRequestHeader> m_copy_counter; //!< Counts the copies.
+#endif
 };
 
 /**
@@ -400,7 +468,7 @@ public:
    *
    * \return the dialog token
    */
-  uint8_t GetDialogToken (void);
+  uint8_t GetDialogToken (void) const;
 
   /**
    * Set the follow up dialog token.
@@ -414,7 +482,7 @@ public:
    *
    * \return the follow up dialog token
    */
-  uint8_t GetFollowUpDialogToken (void);
+  uint8_t GetFollowUpDialogToken (void) const;
 
   /**
    * Set the time of departure.
@@ -428,7 +496,7 @@ public:
    *
    * \return the time of departure
    */
-  uint64_t GetTimeOfDeparture (void);
+  uint64_t GetTimeOfDeparture (void) const;
 
   /**
    * Set the time of arrival.
@@ -442,7 +510,7 @@ public:
    *
    * \return the time of arrival
    */
-  uint64_t GetTimeOfArrival (void);
+  uint64_t GetTimeOfArrival (void) const;
 
   /**
    * Set the time of departure error.
@@ -456,7 +524,7 @@ public:
    *
    * \return the time of departure error
    */
-  uint16_t GetTimeOfDepartureError (void);
+  uint16_t GetTimeOfDepartureError (void) const;
 
   /**
    * Set the time of arrival error.
@@ -470,28 +538,28 @@ public:
    *
    * \return the time of arrival error
    */
-  uint16_t GetTimeOfArrivalError (void);
+  uint16_t GetTimeOfArrivalError (void) const;
 
   /**
    * Set the FTM parameters.
    *
    * \param ftm_params the FtmParams
    */
-  void SetFtmParams (FtmParams ftm_params);
+  void SetFtmParams (const FtmParams &ftm_params);
 
   /**
    * Returns the FTM parameters.
    *
    * \return the FtmParams
    */
-  FtmParams GetFtmParams (void);
+  const FtmParams & GetFtmParams (void) const;
 
   /**
    * Returns true if the FTM parameters have been set.
    *
    * \return if FtmParams have been set
    */
-  bool GetFtmParamsSet (void);
+  bool GetFtmParamsSet (void) const;
 
 private:
   uint8_t m_dialog_token;
@@ -503,8 +571,9 @@ private:
 
   FtmParams m_ftm_params;
   bool m_ftm_params_set;
-
-  bool m_big_endian; //!< If this system is big endian. Used for conversion of the 6 byte time stamps.
+#ifdef NS3_FTM_COUNT_COPIES
+  FtmCopyCounter<FtmResponseHeader> m_copy_counter; //!< Counts the copies.
+#endif
 };
 
 /**
@@ -545,8 +614,205 @@ private:
   uint32_t tsf_sync_info;
 };
 
+/**
+ * \brief Class for the multi user ranging poll element.
+ * \ingroup FTM
+ *
+ * Appended to the broadcast FTM frame that starts a multi user ranging round. It lists all the polled initiators
+ * in the order in which they reply. For every initiator whose dialog of the previous round is complete, it also
+ * carries the dialog token, the time of departure and the time of arrival of that dialog.
+ */
+class FtmMultiUserPoll : public Header
+{
+public:
+  FtmMultiUserPoll ();
+  virtual ~FtmMultiUserPoll ();
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * A polled initiator and the follow up of its previous dialog. The follow up dialog token is 0 if there is none.
+   */
+  struct UserEntry
+  {
+    Mac48Address address;
+    uint8_t follow_up_dialog_token;
+    uint64_t tod;
+    uint64_t toa;
+  };
+
+  /**
+   * Adds a polled initiator.
+   *
+   * \param address the initiator address
+   * \param follow_up_dialog_token the dialog token of the previous dialog, 0 if not complete
+   * \param tod the time of departure of the previous dialog
+   * \param toa the time of arrival of the previous dialog
+   */
+  void AddUser (Mac48Address address, uint8_t follow_up_dialog_token, uint64_t tod, uint64_t toa);
+
+  /**
+   * Returns all the polled initiators.
+   *
+   * \return the polled initiators
+   */
+  const std::vector<UserEntry>& GetUsers (void) const;
+
+  /**
+   * Returns the position of the initiator in the poll, which is also its reply order.
+   *
+   * \param address the initiator address
+   * \return the position, -1 if the initiator is not polled
+   */
+  int GetUserIndex (Mac48Address address) const;
+
+  /**
+   * Checks if the next element in the packet is a multi user poll.
+   *
+   * \param packet the packet with all previous headers removed
+   * \return true if the next element is a multi user poll
+   */
+  static bool IsNextElement (Ptr<const Packet> packet);
+
+private:
+  static const uint8_t m_element_id = 255; //!< Element ID for the header
+  static const uint8_t m_element_id_extension = 66; //!< Element ID extension for the header
+
+  std::vector<UserEntry> m_users; //!< The polled initiators.
+};
+
+/**
+ * \brief Class for the multi user ranging reply element.
+ * \ingroup FTM
+ *
+ * Appended to the broadcast FTM request an initiator sends as reply to a multi user poll. The responder takes
+ * the time of arrival of this frame for the dialog of the initiator.
+ */
+class FtmMultiUserReply : public Header
+{
+public:
+  FtmMultiUserReply ();
+  virtual ~FtmMultiUserReply ();
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * Set the responder this reply is meant for.
+   *
+   * \param responder the responder address
+   */
+  void SetResponder (Mac48Address responder);
+
+  /**
+   * Returns the responder this reply is meant for.
+   *
+   * \return the responder address
+   */
+  Mac48Address GetResponder (void) const;
+
+  /**
+   * Set the dialog token of the poll this reply answers.
+   *
+   * \param dialog_token the dialog token
+   */
+  void SetDialogToken (uint8_t dialog_token);
+
+  /**
+   * Returns the dialog token of the poll this reply answers.
+   *
+   * \return the dialog token
+   */
+  uint8_t GetDialogToken (void) const;
+
+  /**
+   * Checks if the next element in the packet is a multi user reply.
+   *
+   * \param packet the packet with all previous headers removed
+   * \return true if the next element is a multi user reply
+   */
+  static bool IsNextElement (Ptr<const Packet> packet);
+
+private:
+  static const uint8_t m_element_id = 255; //!< Element ID for the header
+  static const uint8_t m_element_id_extension = 67; //!< Element ID extension for the header
+
+  Mac48Address m_responder; //!< The responder address.
+  uint8_t m_dialog_token; //!< The dialog token.
+};
+
+/**
+ * \brief Pre serialized FTM response frame.
+ * \ingroup FTM
+ *
+ * Holds the serialized action header, FTM response header and TSF sync info of an FTM response without
+ * FTM parameters. Only the dialog tokens and the time stamps change between the frames of a session, so they
+ * are patched in place and the packet is created directly from the bytes, without serializing the headers again.
+ * The bytes are the same as with packet->AddHeader for every header.
+ */
+class FtmResponseFrameTemplate
+{
+public:
+  FtmResponseFrameTemplate ();
+  virtual ~FtmResponseFrameTemplate ();
+
+  /**
+   * Sets the dialog token.
+   *
+   * \param dialog_token the dialog token
+   */
+  void SetDialogToken (uint8_t dialog_token);
+
+  /**
+   * Sets the follow up dialog token, the time of departure and the time of arrival of the previous dialog.
+   *
+   * \param dialog_token the follow up dialog token, 0 if there is no follow up
+   * \param tod the time of departure
+   * \param toa the time of arrival
+   */
+  void SetFollowUp (uint8_t dialog_token, uint64_t tod, uint64_t toa);
+
+  /**
+   * Creates a packet from the current bytes of the template.
+   *
+   * \param add_tsf_sync if the TSF sync info should be added, which is only done for the first frame of a burst
+   * \return the packet
+   */
+  Ptr<Packet> CreatePacket (bool add_tsf_sync) const;
 
+private:
+  static const uint32_t m_action_size = 2; //!< Size of the action header.
+  static const uint32_t m_response_size = 18; //!< Size of the FTM response header without FTM parameters.
+  static const uint32_t m_tsf_sync_size = 7; //!< Size of the TSF sync info.
+  static const uint32_t m_size = m_action_size + m_response_size + m_tsf_sync_size; //!< Size of the whole frame.
 
+  /**
+   * Writes a 48 bit time stamp in the same byte order as FtmResponseHeader.
+   *
+   * \param offset the offset of the time stamp in the buffer
+   * \param timestamp the time stamp
+   */
+  void WriteTimeStamp (uint32_t offset, uint64_t timestamp);
+
+  uint8_t m_buffer[m_size]; //!< The serialized frame.
+};
 
 } /* namespace ns3 */
 
@@ -20,6 +20,12 @@
 
 #include "ftm-manager.h"
 #include "ns3/core-module.h"
+#include "ns3/wifi-mac-queue.h"
+#include "ns3/wifi-mac-queue-item.h"
+#include "ns3/wifi-utils.h"
+#include <fstream>
+#include <set>
+#include <map>
 
 
 namespace ns3 {
@@ -28,6 +34,18 @@ NS_LOG_COMPONENT_DEFINE ("FtmManager");
 
 NS_OBJECT_ENSURE_REGISTERED (FtmManager);
 
+static GlobalValue g_ftm_metrics_summary ("FtmMetricsSummary",
+                                          "The file the merged FTM metrics of all managers are written to at "
+                                          "Simulator::Destroy. JSON if the name ends with .json, CSV otherwise. "
+                                          "Empty to not write a summary.",
+                                          StringValue (""),
+                                          MakeStringChecker ());
+
+static std::set<FtmManager *> g_metrics_managers; //!< The managers of the current simulation.
+static FtmMetrics g_destroyed_metrics; //!< The merged metrics of the destroyed managers.
+static bool g_metrics_summary_scheduled = false; //!< If the summary is scheduled for Simulator::Destroy.
+static std::map<const WifiPhy *, FtmManager *> g_phy_managers; //!< The manager of every PHY, not owned.
+
 TypeId
 FtmManager::GetTypeId (void)
 {
@@ -35,6 +53,69 @@ FtmManager::GetTypeId (void)
     .SetParent<Object> ()
     .SetGroupName ("Wifi")
     .AddConstructor<FtmManager>()
+    .AddAttribute ("MultiUserReplySpacing",
+                   "The time between the replies of two consecutive initiators in a multi user ranging round. "
+                   "The initiator at position n of the poll replies n times this value after receiving the poll.",
+                   TimeValue (MicroSeconds (200)),
+                   MakeTimeAccessor (&FtmManager::m_mu_reply_spacing),
+                   MakeTimeChecker ())
+    .AddAttribute ("LazyPhyHooks",
+                   "Only connect the PHY trace hooks while the manager has sessions or does passive ranging, "
+                   "so that idle stations do not inspect every frame.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&FtmManager::SetLazyPhyHooks),
+                   MakeBooleanChecker ())
+    .AddAttribute ("SessionPoolSize",
+                   "The number of finished sessions kept for reuse by new sessions. 0 disables the pool.",
+                   UintegerValue (16),
+                   MakeUintegerAccessor (&FtmManager::m_session_pool_size),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("FtmPriorityLane",
+                   "Move FTM frames to the front of the Txop queue, ahead of the other management frames. "
+                   "The Txop only carries the data frames of non QoS stations, the data frames of QoS stations "
+                   "are queued in the EDCA queues and are not overtaken.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FtmManager::m_priority_lane_enabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("FtmAifsn",
+                   "The AIFSN of the Txop while it holds FTM frames. The Txop is shared with the other management "
+                   "frames, which are sent with this value as well while an FTM frame is queued. The value of the "
+                   "Txop is restored once the last queued FTM frame starts on the PHY. 0 keeps the value of the Txop.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FtmManager::m_ftm_aifsn),
+                   MakeUintegerChecker<uint32_t> (0, 15))
+    .AddAttribute ("FtmMinCw",
+                   "The minimum contention window of the Txop while it holds FTM frames, shared with the other "
+                   "management frames like FtmAifsn. 0 keeps the value of the Txop.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FtmManager::m_ftm_min_cw),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("FtmMaxCw",
+                   "The maximum contention window of the Txop while it holds FTM frames, shared with the other "
+                   "management frames like FtmAifsn. 0 keeps the value of the Txop.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FtmManager::m_ftm_max_cw),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddTraceSource ("FtmQueueLatency",
+                     "The time from handing an FTM frame to the Txop until the start of its first transmission.",
+                     MakeTraceSourceAccessor (&FtmManager::m_ftm_queue_latency_trace),
+                     "ns3::FtmManager::QueueLatencyTracedCallback")
+    .AddTraceSource ("SessionCreated",
+                     "A new FTM session has been created.",
+                     MakeTraceSourceAccessor (&FtmManager::m_session_created_trace),
+                     "ns3::FtmManager::SessionCreatedTracedCallback")
+    .AddTraceSource ("SessionOverridden",
+                     "An active responder session has been replaced, because the initiator sent a new FTM request.",
+                     MakeTraceSourceAccessor (&FtmManager::m_session_overridden_trace),
+                     "ns3::FtmSession::SessionTracedCallback")
+    .AddTraceSource ("SessionBlocked",
+                     "New sessions with a partner are blocked, because the partner requested it.",
+                     MakeTraceSourceAccessor (&FtmManager::m_session_blocked_trace),
+                     "ns3::FtmManager::SessionBlockedTracedCallback")
+    .AddTraceSource ("SessionUnblocked",
+                     "New sessions with a partner are allowed again.",
+                     MakeTraceSourceAccessor (&FtmManager::m_session_unblocked_trace),
+                     "ns3::FtmSession::SessionTracedCallback")
     ;
   return tid;
 }
@@ -45,6 +126,37 @@ FtmManager::FtmManager ()
   awaiting_ack = false;
   sent_packets = 0;
   sending_ack = false;
+  m_current_tx_packet.dialog_token = 0;
+  m_current_rx_packet.dialog_token = 0;
+  m_current_tx_frame.uid = 0;
+  m_current_tx_frame.airtime = false;
+  m_current_rx_frame.uid = 0;
+  m_current_rx_frame.airtime = false;
+  m_current_rx_frame.ack_expected = false;
+  m_current_rx_frame.ftm_ack = false;
+  m_current_rx_frame.broadcast_ftm = false;
+  m_current_rx_frame.mu_poll = false;
+  m_passive_dialog_token = 0;
+  m_passive_tod = 0;
+  m_passive_listening = false;
+  m_passive_callback = MakeNullCallback<void, Mac48Address, int64_t> ();
+  m_passive_error_model = CreateObject<FtmErrorModel> ();
+  m_mu_dialog_token = 0;
+  m_mu_rounds_remaining = 0;
+  m_priority_lane_enabled = false;
+  m_ftm_aifsn = 0;
+  m_ftm_min_cw = 0;
+  m_ftm_max_cw = 0;
+  m_ftm_channel_access_frames = 0;
+  m_txop_aifsn = 0;
+  m_txop_min_cw = 0;
+  m_txop_max_cw = 0;
+  m_priority_lane_busy = false;
+  m_priority_lane_head = 0;
+  m_lazy_phy_hooks = true;
+  m_phy_hooks_attached = false;
+  m_session_pool_size = 16;
+  RegisterMetrics ();
 }
 
 FtmManager::FtmManager (Ptr<WifiPhy> phy, Ptr<Txop> txop)
@@ -53,20 +165,68 @@ FtmManager::FtmManager (Ptr<WifiPhy> phy, Ptr<Txop> txop)
   awaiting_ack = false;
   sent_packets = 0;
   sending_ack = false;
-  phy->TraceConnectWithoutContext("PhyTxBegin", MakeCallback(&FtmManager::PhyTxBegin, this));
-  phy->TraceConnectWithoutContext("PhyRxBegin", MakeCallback(&FtmManager::PhyRxBegin, this));
-  phy->TraceConnectWithoutContext("MonitorSnifferRx", MakeCallback(&FtmManager::SnifferRxNotify, this));
+  m_current_tx_packet.dialog_token = 0;
+  m_current_rx_packet.dialog_token = 0;
+  m_current_tx_frame.uid = 0;
+  m_current_tx_frame.airtime = false;
+  m_current_rx_frame.uid = 0;
+  m_current_rx_frame.airtime = false;
+  m_current_rx_frame.ack_expected = false;
+  m_current_rx_frame.ftm_ack = false;
+  m_current_rx_frame.broadcast_ftm = false;
+  m_current_rx_frame.mu_poll = false;
+  m_passive_dialog_token = 0;
+  m_passive_tod = 0;
+  m_passive_listening = false;
+  m_passive_callback = MakeNullCallback<void, Mac48Address, int64_t> ();
+  m_passive_error_model = CreateObject<FtmErrorModel> ();
+  m_mu_dialog_token = 0;
+  m_mu_rounds_remaining = 0;
+  m_priority_lane_enabled = false;
+  m_ftm_aifsn = 0;
+  m_ftm_min_cw = 0;
+  m_ftm_max_cw = 0;
+  m_ftm_channel_access_frames = 0;
+  m_txop_aifsn = 0;
+  m_txop_min_cw = 0;
+  m_txop_max_cw = 0;
+  m_priority_lane_busy = false;
+  m_priority_lane_head = 0;
+  m_lazy_phy_hooks = true;
+  m_phy_hooks_attached = false;
+  m_session_pool_size = 16;
+  RegisterMetrics ();
+  m_phy = phy;
   m_txop = txop;
 
   m_preamble_detection_duration = phy->GetPreambleDetectionDuration();
+
+  //make the manager reachable for scenarios, e.g. to start passive ranging
+  g_phy_managers.insert ({PeekPointer (phy), this});
 }
 
 FtmManager::~FtmManager ()
 {
-  TraceDisconnectWithoutContext("PhyTxBegin", MakeCallback(&FtmManager::PhyTxBegin, this));
-  TraceDisconnectWithoutContext("PhyRxBegin", MakeCallback(&FtmManager::PhyRxBegin, this));
+  //managers that were already written to a summary must not count for the next simulation
+  if (g_metrics_managers.erase (this) > 0)
+    {
+      g_destroyed_metrics.Merge (m_metrics);
+    }
+  UnregisterPhy ();
+  ReleaseSessions ();
+  Simulator::Cancel (m_passive_event);
+  Simulator::Cancel (m_mu_event);
+  Simulator::Cancel (m_detach_event);
+  Simulator::Cancel (m_priority_lane_timeout);
+  Simulator::Cancel (m_ftm_channel_access_timeout);
+  m_session_pool.clear();
   sessions.clear();
   m_blocked_partners.clear();
+  m_passive_responders.clear();
+  m_passive_error_model = 0;
+  m_mu_group.clear();
+  m_priority_lane.clear();
+  m_ftm_enqueue_times.clear();
   m_txop = 0;
 }
 
@@ -78,6 +238,29 @@ FtmManager::PhyTxBegin(Ptr<const Packet> packet, double num)
   int64_t pico_sec = now.GetPicoSeconds();
   pico_sec &= 0x0000FFFFFFFFFFFF;
   sent_packets++;
+  m_current_tx_frame.uid = packet->GetUid ();
+  m_current_tx_frame.airtime = false;
+  m_metrics.tx_frames_inspected++;
+  if (!m_ftm_enqueue_times.empty ())
+    {
+      auto queued = m_ftm_enqueue_times.find (packet->GetUid ());
+      if (queued != m_ftm_enqueue_times.end ())
+        {
+          Time latency = now - queued->second;
+          m_metrics.queue_latency.Add (latency.GetMicroSeconds ());
+          m_ftm_queue_latency_trace (packet, latency);
+          m_ftm_enqueue_times.erase (queued);
+          if (m_ftm_channel_access_frames > 0 && --m_ftm_channel_access_frames == 0)
+            {
+              RestoreTxopChannelAccess ();
+            }
+        }
+    }
+  if (m_priority_lane_busy && packet->GetUid () == m_priority_lane_head)
+    {
+      //the FTM frame at the front is on the air, the next one can take its place
+      AdvancePriorityLane ();
+    }
   Ptr<Packet> copy = packet->Copy();
   WifiMacHeader hdr;
   copy->RemoveHeader(hdr);
@@ -86,7 +269,56 @@ FtmManager::PhyTxBegin(Ptr<const Packet> packet, double num)
       copy->RemoveHeader(action_hdr);
       if(action_hdr.GetCategory() == WifiActionHeader::PUBLIC_ACTION) {
           WifiActionHeader::ActionValue action = action_hdr.GetAction();
-          if (action.publicAction == WifiActionHeader::FTM_RESPONSE)
+          if (action.publicAction == WifiActionHeader::FTM_REQUEST
+              || action.publicAction == WifiActionHeader::FTM_RESPONSE)
+            {
+              m_metrics.tx_ftm_frames++;
+              m_current_tx_frame.airtime = true;
+              m_current_tx_frame.type = action.publicAction == WifiActionHeader::FTM_REQUEST
+                  ? FtmAirtime::FTM_REQUEST : FtmAirtime::FTM_RESPONSE;
+              m_current_tx_frame.partner = hdr.GetAddr1 ();
+            }
+          if (action.publicAction == WifiActionHeader::FTM_RESPONSE && hdr.GetAddr1 ().IsBroadcast ())
+            {
+              FtmResponseHeader ftm_resp_hdr;
+              copy->RemoveHeader(ftm_resp_hdr);
+              if (FtmMultiUserPoll::IsNextElement (copy))
+                {
+                  //one time of departure for all the polled initiators
+                  uint8_t dialog_token = ftm_resp_hdr.GetDialogToken();
+                  if (dialog_token != 0 && dialog_token == m_mu_dialog_token)
+                    {
+                      for (Mac48Address member : m_mu_group)
+                        {
+                          Ptr<FtmSession> session = FindSession (member);
+                          if (session != 0)
+                            {
+                              session->SetT1(dialog_token, pico_sec);
+                            }
+                        }
+                    }
+                }
+              else if (ftm_resp_hdr.GetDialogToken() == m_passive_dialog_token)
+                {
+                  m_passive_tod = pico_sec;
+                }
+            }
+          else if (action.publicAction == WifiActionHeader::FTM_REQUEST && hdr.GetAddr1 ().IsBroadcast ())
+            {
+              FtmRequestHeader ftm_req_hdr;
+              copy->RemoveHeader(ftm_req_hdr);
+              if (FtmMultiUserReply::IsNextElement (copy))
+                {
+                  FtmMultiUserReply reply;
+                  copy->RemoveHeader(reply);
+                  Ptr<FtmSession> session = FindSession (reply.GetResponder());
+                  if (session != 0)
+                    {
+                      session->SetT3(reply.GetDialogToken(), pico_sec);
+                    }
+                }
+            }
+          else if (action.publicAction == WifiActionHeader::FTM_RESPONSE)
             {
               Ptr<FtmSession> session = FindSession (hdr.GetAddr1());
               if (session != 0)
@@ -98,11 +330,8 @@ FtmManager::PhyTxBegin(Ptr<const Packet> packet, double num)
                   received_packets = 0;
                   awaiting_ack = true;
 
-                  PacketInPieces pieces;
-                  pieces.mac_hdr = hdr;
-                  pieces.action_hdr = action_hdr;
-                  pieces.ftm_res_hdr = ftm_resp_hdr;
-                  m_current_tx_packet = pieces;
+                  m_current_tx_packet.partner = hdr.GetAddr1();
+                  m_current_tx_packet.dialog_token = ftm_resp_hdr.GetDialogToken();
                 }
             }
       }
@@ -111,10 +340,13 @@ FtmManager::PhyTxBegin(Ptr<const Packet> packet, double num)
       if(sending_ack && sent_packets == 1) {
           if(m_ack_to == hdr.GetAddr1()) {
               sending_ack = false;
-              Ptr<FtmSession> session = FindSession (m_current_rx_packet.mac_hdr.GetAddr2());
+              m_current_tx_frame.airtime = true;
+              m_current_tx_frame.type = FtmAirtime::ACK;
+              m_current_tx_frame.partner = m_current_rx_packet.partner;
+              Ptr<FtmSession> session = FindSession (m_current_rx_packet.partner);
               if (session != 0)
                 {
-                  session->SetT3(m_current_rx_packet.ftm_res_hdr.GetDialogToken(), pico_sec);
+                  session->SetT3(m_current_rx_packet.dialog_token, pico_sec);
                 }
           }
       }
@@ -130,18 +362,90 @@ FtmManager::PhyRxBegin(Ptr<const Packet> packet, RxPowerWattPerChannelBand rxPow
   pico_sec &= 0x0000FFFFFFFFFFFF;
   Ptr<Packet> copy = packet->Copy();
   received_packets++;
+  m_current_rx_frame.uid = packet->GetUid();
+  m_current_rx_frame.airtime = false;
+  m_current_rx_frame.ack_expected = false;
+  m_current_rx_frame.ftm_ack = false;
+  m_current_rx_frame.timestamp = pico_sec;
+  m_current_rx_frame.broadcast_ftm = false;
+  m_current_rx_frame.mu_poll = false;
+  m_metrics.rx_frames_inspected++;
   WifiMacHeader hdr;
   copy->RemoveHeader(hdr);
-  if(hdr.GetAddr1() == m_mac_address){
+  if(hdr.GetAddr1().IsBroadcast() && hdr.IsMgt() && hdr.IsAction()) {
+      WifiActionHeader action_hdr;
+      copy->RemoveHeader(action_hdr);
+      if(action_hdr.GetCategory() == WifiActionHeader::PUBLIC_ACTION) {
+          Mac48Address partner = hdr.GetAddr2();
+          if(action_hdr.GetAction().publicAction == WifiActionHeader::FTM_RESPONSE) {
+              m_metrics.rx_ftm_frames++;
+              m_current_rx_frame.airtime = true;
+              m_current_rx_frame.type = FtmAirtime::FTM_RESPONSE;
+              m_current_rx_frame.partner = partner;
+              //broadcast FTM frames only belong to passive or multi user ranging, never forward them to a session
+              m_current_rx_frame.broadcast_ftm = true;
+              FtmResponseHeader ftm_res_hdr;
+              copy->RemoveHeader(ftm_res_hdr);
+              if (FtmMultiUserPoll::IsNextElement (copy))
+                {
+                  FtmMultiUserPoll poll;
+                  copy->RemoveHeader(poll);
+                  Ptr<FtmSession> session = FindSession(partner);
+                  if (session != 0 && ftm_res_hdr.GetDialogToken() != 0 && poll.GetUserIndex (m_mac_address) >= 0)
+                    {
+                      session->SetT2(ftm_res_hdr.GetDialogToken(), pico_sec, GetRxPowerDbm (rxPowersW));
+                    }
+                  //the poll is processed once it is fully received, in SnifferRxNotify
+                  m_current_rx_frame.mu_poll = true;
+                  m_current_rx_frame.ftm_res = ftm_res_hdr;
+                  m_current_rx_frame.poll = poll;
+                }
+              else if (m_passive_listening)
+                {
+                  PassiveFtmFrameReceived (partner, ftm_res_hdr, pico_sec, GetRxPowerDbm (rxPowersW));
+                }
+          }
+          else if(action_hdr.GetAction().publicAction == WifiActionHeader::FTM_REQUEST) {
+              m_metrics.rx_ftm_frames++;
+              m_current_rx_frame.airtime = true;
+              m_current_rx_frame.type = FtmAirtime::FTM_REQUEST;
+              m_current_rx_frame.partner = partner;
+              m_current_rx_frame.broadcast_ftm = true;
+              FtmRequestHeader ftm_req_hdr;
+              copy->RemoveHeader(ftm_req_hdr);
+              if (FtmMultiUserReply::IsNextElement (copy))
+                {
+                  FtmMultiUserReply reply;
+                  copy->RemoveHeader(reply);
+                  Ptr<FtmSession> session = FindSession(partner);
+                  if (session != 0 && reply.GetResponder() == m_mac_address
+                      && reply.GetDialogToken() == m_mu_dialog_token)
+                    {
+                      session->SetT4(reply.GetDialogToken(), pico_sec);
+                    }
+                }
+          }
+      }
+  }
+  else if(hdr.GetAddr1() == m_mac_address){
       if(hdr.IsMgt() && hdr.IsAction()) {
           WifiActionHeader action_hdr;
           copy->RemoveHeader(action_hdr);
           if(action_hdr.GetCategory() == WifiActionHeader::PUBLIC_ACTION) {
               Mac48Address partner = hdr.GetAddr2();
-              if(action_hdr.GetAction().publicAction == WifiActionHeader::FTM_RESPONSE) {
-                  sending_ack = true;
-                  sent_packets = 0;
-                  m_ack_to = partner;
+              if(action_hdr.GetAction().publicAction == WifiActionHeader::FTM_REQUEST) {
+                  m_metrics.rx_ftm_frames++;
+                  m_current_rx_frame.airtime = true;
+                  m_current_rx_frame.type = FtmAirtime::FTM_REQUEST;
+                  m_current_rx_frame.partner = partner;
+              }
+              else if(action_hdr.GetAction().publicAction == WifiActionHeader::FTM_RESPONSE) {
+                  m_metrics.rx_ftm_frames++;
+                  m_current_rx_frame.airtime = true;
+                  m_current_rx_frame.type = FtmAirtime::FTM_RESPONSE;
+                  m_current_rx_frame.partner = partner;
+                  //the MAC only acknowledges the frame if it is received, so the ACK is expected at its end
+                  m_current_rx_frame.ack_expected = true;
 
                   FtmResponseHeader ftm_res_hdr;
                   copy->RemoveHeader(ftm_res_hdr);
@@ -149,62 +453,105 @@ FtmManager::PhyRxBegin(Ptr<const Packet> packet, RxPowerWattPerChannelBand rxPow
                   Ptr<FtmSession> session = FindSession(partner);
                   if (session != 0 && ftm_res_hdr.GetDialogToken() != 0)
                     {
-                      session->SetT2(ftm_res_hdr.GetDialogToken(), pico_sec);
-                      PacketInPieces pieces;
-                      pieces.mac_hdr = hdr;
-                      pieces.action_hdr = action_hdr;
-                      pieces.ftm_res_hdr = ftm_res_hdr;
-                      m_current_rx_packet = pieces;
+                      //time stamp and signal strength of the same reception, set with one dialog lookup
+                      session->SetT2(ftm_res_hdr.GetDialogToken(), pico_sec, GetRxPowerDbm (rxPowersW));
+                      m_current_rx_packet.partner = partner;
+                      m_current_rx_packet.dialog_token = ftm_res_hdr.GetDialogToken();
                     }
               }
           }
       }
       if(hdr.IsAck()) {
           if(awaiting_ack && received_packets == 1) {
+              //t4 is only set once the ACK is received, an aborted reception is followed by a retransmission
               awaiting_ack = false;
-              Ptr<FtmSession> session = FindSession (m_current_tx_packet.mac_hdr.GetAddr1());
-              if (session != 0)
-                {
-                  session->SetT4(m_current_tx_packet.ftm_res_hdr.GetDialogToken(), pico_sec);
-                }
+              m_current_rx_frame.airtime = true;
+              m_current_rx_frame.type = FtmAirtime::ACK;
+              m_current_rx_frame.partner = m_current_tx_packet.partner;
+              m_current_rx_frame.ftm_ack = true;
+              m_current_rx_frame.dialog_token = m_current_tx_packet.dialog_token;
           }
           else if(awaiting_ack && received_packets > 1) { //this needs to be checked also for non ack, cause if ack never arrives but other packet, its still an error
               awaiting_ack = false;
+              m_metrics.ack_mismatches++;
           }
       }
   }
 }
 
+double
+FtmManager::GetRxPowerDbm (const RxPowerWattPerChannelBand &rxPowersW)
+{
+  //the widest band holds the power of all its sub bands, yans only reports the one band of the channel
+  double rx_power_w = 0;
+  for (auto &band : rxPowersW)
+    {
+      rx_power_w = std::max (rx_power_w, band.second);
+    }
+  return WToDbm (rx_power_w);
+}
+
 void
 FtmManager::SnifferRxNotify(Ptr<const Packet> packet, uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu, SignalNoiseDbm signalNoise, uint16_t staId)
 {
   NS_LOG_FUNCTION (this);
-  Ptr<Packet> copy = packet->Copy();
-
-  WifiMacHeader hdr;
-  copy->RemoveHeader(hdr);
-  if(hdr.GetAddr1() == m_mac_address)
+  //frames whose reception did not start with PhyRxBegin are not of interest
+  if (packet->GetUid() != m_current_rx_frame.uid)
     {
-    if(hdr.IsMgt() && hdr.IsAction())
-      {
-      WifiActionHeader action_hdr;
-      copy->RemoveHeader(action_hdr);
-      if(action_hdr.GetCategory() == WifiActionHeader::PUBLIC_ACTION)
+      return;
+    }
+  if (m_current_rx_frame.airtime)
+    {
+      Time duration = WifiPhy::CalculateTxDuration (packet->GetSize (), txVector, m_phy->GetPhyBand ());
+      //the sniffer reports received frames at their end
+      AddAirtime (m_current_rx_frame.type, m_current_rx_frame.partner, Simulator::Now () - duration, duration, false);
+    }
+  if (m_current_rx_frame.ack_expected)
+    {
+      m_current_rx_frame.ack_expected = false;
+      sending_ack = true;
+      sent_packets = 0;
+      m_ack_to = m_current_rx_frame.partner;
+    }
+  if (m_current_rx_frame.ftm_ack)
+    {
+      m_current_rx_frame.ftm_ack = false;
+      Ptr<FtmSession> session = FindSession (m_current_rx_frame.partner);
+      if (session != 0)
         {
-        Mac48Address partner = hdr.GetAddr2();
-        if(action_hdr.GetAction().publicAction == WifiActionHeader::FTM_RESPONSE)
-          {
-          FtmResponseHeader ftm_res_hdr;
-          copy->RemoveHeader(ftm_res_hdr);
-          Ptr<FtmSession> session = FindSession(partner);
-          if (session != 0 && ftm_res_hdr.GetDialogToken() != 0)
-            {
-              // set the signal strength for the current dialog
-              session->SetSignalStrength(ftm_res_hdr.GetDialogToken(), signalNoise.signal);
-            }
-          }
+          session->SetT4(m_current_rx_frame.dialog_token, m_current_rx_frame.timestamp);
         }
-      }
+    }
+  if (m_current_rx_frame.mu_poll)
+    {
+      //the poll is fully received, now the initiator can process it and reply
+      m_current_rx_frame.mu_poll = false;
+      MultiUserPollReceived (m_current_rx_frame.partner, m_current_rx_frame.ftm_res, m_current_rx_frame.poll);
+    }
+}
+
+void
+FtmManager::SnifferTxNotify(Ptr<const Packet> packet, uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu, uint16_t staId)
+{
+  NS_LOG_FUNCTION (this);
+  //PhyTxBegin already parsed the frame
+  if (packet->GetUid() != m_current_tx_frame.uid || !m_current_tx_frame.airtime)
+    {
+      return;
+    }
+  Time duration = WifiPhy::CalculateTxDuration (packet->GetSize (), txVector, m_phy->GetPhyBand ());
+  //the sniffer reports sent frames at their start
+  AddAirtime (m_current_tx_frame.type, m_current_tx_frame.partner, Simulator::Now (), duration, true);
+}
+
+void
+FtmManager::AddAirtime (FtmAirtime::FrameType type, Mac48Address partner, Time start, Time duration, bool tx)
+{
+  m_metrics.airtime.Add (type, tx, duration);
+  Ptr<FtmSession> session = FindSession (partner);
+  if (session != 0)
+    {
+      m_metrics.airtime.burst_idle += session->AddAirtime (type, tx, start, duration);
     }
 }
 
@@ -219,18 +566,44 @@ FtmManager::CreateNewSession (Mac48Address partner, FtmSession::SessionType type
 {
   if(FindSession(partner) == 0 && !CheckSessionBlocked (partner) && partner != m_mac_address)
     {
-      Ptr<FtmSession> new_session = CreateObject<FtmSession> ();
+      Ptr<FtmSession> new_session = TakePooledSession ();
+      if (new_session == 0)
+        {
+          new_session = CreateObject<FtmSession> ();
+        }
       new_session->InitSession(partner, type, MakeCallback(&FtmManager::SendPacket, this));
       new_session->SetSessionOverCallbackManager(MakeCallback(&FtmManager::SessionOver, this));
       new_session->SetBlockSessionCallback(MakeCallback(&FtmManager::BlockSession, this));
       new_session->SetOverrideCallback(MakeCallback(&FtmManager::OverrideSession, this));
       new_session->SetPreambleDetectionDuration(m_preamble_detection_duration);
+      new_session->SetMetrics(&m_metrics);
       sessions.insert({partner, new_session});
+      UpdatePhyHooks ();
+      m_session_created_trace (new_session);
+      m_metrics.sessions_created++;
       return new_session;
     }
   return 0;
 }
 
+Ptr<FtmSession>
+FtmManager::TakePooledSession (void)
+{
+  while (!m_session_pool.empty ())
+    {
+      Ptr<FtmSession> session = m_session_pool.back ();
+      m_session_pool.pop_back ();
+      //sessions the user still holds a pointer to are not reused
+      if (session->GetReferenceCount () == 1)
+        {
+          session->Reset ();
+          return session;
+        }
+      ReleaseSession (session);
+    }
+  return 0;
+}
+
 void
 FtmManager::SendPacket (Ptr<Packet> packet, WifiMacHeader hdr)
 {
@@ -240,7 +613,106 @@ FtmManager::SendPacket (Ptr<Packet> packet, WifiMacHeader hdr)
   hdr.SetDsNotTo();
   hdr.SetDsNotFrom();
 //  hdr.SetNoRetry();
+  ApplyFtmChannelAccess ();
+
+  //forget frames that never made it to the PHY, e.g. because they were dropped from the queue
+  if (m_ftm_enqueue_times.size () > 1024)
+    {
+      m_ftm_enqueue_times.erase (m_ftm_enqueue_times.begin ());
+    }
+  m_ftm_enqueue_times.insert ({packet->GetUid (), Simulator::Now ()});
+
+  if (!m_priority_lane_enabled)
+    {
+      m_txop->Queue(packet, hdr);
+      return;
+    }
+  if (m_priority_lane_busy)
+    {
+      m_priority_lane.push_back ({packet, hdr});
+      return;
+    }
+  QueueFtmFrame (packet, hdr);
+}
+
+void
+FtmManager::QueueFtmFrame (Ptr<Packet> packet, const WifiMacHeader &hdr)
+{
+  m_priority_lane_busy = true;
+  m_priority_lane_head = packet->GetUid ();
+  //a head frame that does not reach the PHY in time has been dropped, so it must not block the lane
+  m_priority_lane_timeout = Simulator::Schedule (MilliSeconds (100), &FtmManager::AdvancePriorityLane, this);
   m_txop->Queue(packet, hdr);
+  Ptr<WifiMacQueue> queue = m_txop->GetWifiMacQueue ();
+  //if the Txop already dequeued the frame, it is on its way and there is nothing to move
+  if (queue->GetNPackets () > 1 && queue->Remove (packet))
+    {
+      queue->PushFront (Create<WifiMacQueueItem> (packet, hdr));
+    }
+}
+
+void
+FtmManager::AdvancePriorityLane (void)
+{
+  Simulator::Cancel (m_priority_lane_timeout);
+  m_priority_lane_busy = false;
+  if (!m_priority_lane.empty ())
+    {
+      std::pair<Ptr<Packet>, WifiMacHeader> next = m_priority_lane.front ();
+      m_priority_lane.pop_front ();
+      QueueFtmFrame (next.first, next.second);
+    }
+}
+
+void
+FtmManager::ApplyFtmChannelAccess (void)
+{
+  if (m_ftm_aifsn == 0 && m_ftm_min_cw == 0 && m_ftm_max_cw == 0)
+    {
+      return;
+    }
+  if (m_ftm_channel_access_frames == 0)
+    {
+      m_txop_aifsn = m_txop->GetAifsn ();
+      m_txop_min_cw = m_txop->GetMinCw ();
+      m_txop_max_cw = m_txop->GetMaxCw ();
+      if (m_ftm_aifsn != 0)
+        {
+          m_txop->SetAifsn (m_ftm_aifsn);
+        }
+      if (m_ftm_min_cw != 0)
+        {
+          m_txop->SetMinCw (m_ftm_min_cw);
+        }
+      if (m_ftm_max_cw != 0)
+        {
+          m_txop->SetMaxCw (m_ftm_max_cw);
+        }
+    }
+  m_ftm_channel_access_frames++;
+  //frames dropped from the queue never start on the PHY, so they must not keep the parameters forever
+  Simulator::Cancel (m_ftm_channel_access_timeout);
+  m_ftm_channel_access_timeout = Simulator::Schedule (MilliSeconds (100), &FtmManager::RestoreTxopChannelAccess,
+                                                      this);
+}
+
+void
+FtmManager::RestoreTxopChannelAccess (void)
+{
+  Simulator::Cancel (m_ftm_channel_access_timeout);
+  m_ftm_channel_access_frames = 0;
+  if (m_ftm_aifsn != 0)
+    {
+      m_txop->SetAifsn (m_txop_aifsn);
+    }
+  if (m_ftm_min_cw != 0)
+    {
+      m_txop->SetMinCw (m_txop_min_cw);
+    }
+  if (m_ftm_max_cw != 0)
+    {
+      m_txop->SetMaxCw (m_txop_max_cw);
+    }
 }
 
 Ptr<FtmSession>
@@ -257,24 +729,58 @@ FtmManager::FindSession (Mac48Address addr)
 void
 FtmManager::SessionOver (Mac48Address addr)
 {
-//  std::cout << "erase: " << addr << " " << sessions.size()  << std::endl;
+  auto search = sessions.find (addr);
+  if (search != sessions.end ())
+    {
+      //the session still has all its RTTs, its own error models are counted even if they are shared
+      std::set<const FtmErrorModel *> counted_models;
+      m_memory_account.SampleSession (search->second->GetMemoryUsage (counted_models));
+      if (m_session_pool.size () < m_session_pool_size)
+        {
+          //the session is still running its EndSession, so it is only reset when it gets reused
+          m_session_pool.push_back (search->second);
+        }
+      else
+        {
+          ReleaseSession (search->second);
+        }
+    }
   sessions.erase (addr);
+  UpdatePhyHooks ();
 }
 
 void
-FtmManager::ReceivedFtmRequest (Mac48Address partner, FtmRequestHeader ftm_req)
+FtmManager::ReceivedFtmRequest (Mac48Address partner, const FtmRequestHeader &ftm_req)
 {
+  //the flag is only set while the PHY hooks are attached, which they are whenever a session exists
+  if (m_current_rx_frame.broadcast_ftm)
+    {
+      return;
+    }
   Ptr<FtmSession> session = FindSession (partner);
   if (session == 0)
     {
+      //only a request with FTM params starts a session, e.g. a multi user reply heard by an idle station does not
+      if (!ftm_req.GetFtmParamsSet ())
+        {
+          return;
+        }
       session = CreateNewSession(partner, FtmSession::FTM_RESPONDER);
+      if (session == 0)
+        {
+          return;
+        }
     }
   session->ProcessFtmRequest(ftm_req);
 }
 
 void
-FtmManager::ReceivedFtmResponse (Mac48Address partner, FtmResponseHeader ftm_res)
+FtmManager::ReceivedFtmResponse (Mac48Address partner, const FtmResponseHeader &ftm_res)
 {
+  if (m_current_rx_frame.broadcast_ftm)
+    {
+      return;
+    }
   Ptr<FtmSession> session = FindSession (partner);
   if (session != 0)
     {
@@ -287,6 +793,8 @@ void
 FtmManager::BlockSession (Mac48Address partner, Time duration)
 {
   m_blocked_partners.push_back (partner);
+  m_session_blocked_trace (partner, duration);
+  m_metrics.partners_blocked++;
   Simulator::Schedule(duration, &FtmManager::UnblockSession, this, partner);
 }
 
@@ -294,6 +802,7 @@ void
 FtmManager::UnblockSession (Mac48Address partner)
 {
   m_blocked_partners.remove (partner);
+  m_session_unblocked_trace (partner);
 }
 
 bool
@@ -310,11 +819,503 @@ FtmManager::CheckSessionBlocked (Mac48Address partner)
 }
 
 void
-FtmManager::OverrideSession (Mac48Address partner, FtmRequestHeader ftm_req)
+FtmManager::OverrideSession (Mac48Address partner, const FtmRequestHeader &ftm_req)
 {
-  std::cout << "override" << std::endl;
+  NS_LOG_INFO ("Session with " << partner << " overridden by a new FTM request");
+  m_session_overridden_trace (partner);
+  m_metrics.sessions_overridden++;
   Ptr<FtmSession> session = CreateNewSession (partner, FtmSession::FTM_RESPONDER);
   session->ProcessFtmRequest (ftm_req);
 }
 
+void
+FtmManager::StartPassiveRanging (Time interval)
+{
+  m_passive_interval = interval;
+  if (!Simulator::IsExpired (m_passive_event))
+    {
+      Simulator::Cancel (m_passive_event);
+    }
+  m_passive_event = Simulator::ScheduleNow (&FtmManager::SendPassiveFtmFrame, this);
+  UpdatePhyHooks ();
+}
+
+void
+FtmManager::StopPassiveRanging (void)
+{
+  Simulator::Cancel (m_passive_event);
+  UpdatePhyHooks ();
+}
+
+void
+FtmManager::EnablePassiveListening (Callback<void, Mac48Address, int64_t> callback)
+{
+  m_passive_listening = true;
+  m_passive_callback = callback;
+  UpdatePhyHooks ();
+}
+
+void
+FtmManager::DisablePassiveListening (void)
+{
+  m_passive_listening = false;
+  m_passive_responders.clear();
+  UpdatePhyHooks ();
+}
+
+void
+FtmManager::SetPassiveFtmErrorModel (Ptr<FtmErrorModel> error_model)
+{
+  m_passive_error_model = error_model;
+}
+
+void
+FtmManager::SendPassiveFtmFrame (void)
+{
+  uint8_t previous_dialog_token = m_passive_dialog_token;
+  m_passive_dialog_token++;
+  if (m_passive_dialog_token == 0)
+    {
+      m_passive_dialog_token = 1;
+    }
+
+  FtmResponseHeader ftm_res_hdr;
+  ftm_res_hdr.SetDialogToken(m_passive_dialog_token);
+  //only add the follow up if the previous frame has already left the PHY
+  if (previous_dialog_token != 0 && m_passive_tod != 0)
+    {
+      ftm_res_hdr.SetFollowUpDialogToken(previous_dialog_token);
+      ftm_res_hdr.SetTimeOfDeparture(m_passive_tod);
+    }
+  m_passive_tod = 0;
+
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader(ftm_res_hdr);
+
+  WifiActionHeader action_hdr;
+  WifiActionHeader::ActionValue action;
+  action.publicAction = WifiActionHeader::FTM_RESPONSE;
+  action_hdr.SetAction(WifiActionHeader::PUBLIC_ACTION, action);
+  packet->AddHeader(action_hdr);
+
+  WifiMacHeader mac_hdr;
+  mac_hdr.SetAddr1(Mac48Address::GetBroadcast());
+  SendPacket (packet, mac_hdr);
+
+  m_passive_event = Simulator::Schedule(m_passive_interval, &FtmManager::SendPassiveFtmFrame, this);
+}
+
+void
+FtmManager::PassiveFtmFrameReceived (Mac48Address partner, const FtmResponseHeader &ftm_res, uint64_t rx_time, double sig_str)
+{
+  auto search = m_passive_responders.find(partner);
+  if (search == m_passive_responders.end())
+    {
+      PassiveResponderState state;
+      state.dialog_token = 0;
+      state.rx_time = 0;
+      state.signal_strength = 0;
+      search = m_passive_responders.insert({partner, state}).first;
+    }
+  PassiveResponderState &state = search->second;
+
+  if (ftm_res.GetFollowUpDialogToken() != 0 && ftm_res.GetFollowUpDialogToken() == state.dialog_token
+      && state.rx_time != 0 && ftm_res.GetTimeOfDeparture() != 0)
+    {
+      int64_t diff;
+      if (state.rx_time < ftm_res.GetTimeOfDeparture()) //time stamp overflow
+        {
+          diff = (0xFFFFFFFFFFFF - ftm_res.GetTimeOfDeparture()) + state.rx_time;
+        }
+      else
+        {
+          diff = state.rx_time - ftm_res.GetTimeOfDeparture();
+        }
+      //receive time stamp is taken after the preamble detection, same as in the RTT calculation
+      diff -= m_preamble_detection_duration.GetPicoSeconds();
+      m_passive_error_model->SetPartner (partner);
+      diff += m_passive_error_model->GetFtmError(state.signal_strength);
+      if (!m_passive_callback.IsNull())
+        {
+          m_passive_callback (partner, diff);
+        }
+    }
+
+  state.dialog_token = ftm_res.GetDialogToken();
+  state.rx_time = rx_time;
+  state.signal_strength = sig_str;
+}
+
+void
+FtmManager::StartMultiUserRanging (std::list<Mac48Address> group, uint16_t rounds, Time interval)
+{
+  NS_ASSERT_MSG (rounds > 0, "A multi user ranging needs at least one round");
+  for (Mac48Address member : group)
+    {
+      if (CreateNewSession (member, FtmSession::FTM_RESPONDER) != 0)
+        {
+          m_mu_group.push_back (member);
+        }
+    }
+  m_mu_rounds_remaining = rounds;
+  m_mu_interval = interval;
+  m_mu_event = Simulator::ScheduleNow (&FtmManager::SendMultiUserPoll, this);
+}
+
+Ptr<FtmSession>
+FtmManager::JoinMultiUserRanging (Mac48Address responder)
+{
+  return CreateNewSession (responder, FtmSession::FTM_INITIATOR);
+}
+
+void
+FtmManager::SendMultiUserPoll (void)
+{
+  uint8_t previous_dialog_token = m_mu_dialog_token;
+  bool last_poll = m_mu_rounds_remaining == 0;
+  if (last_poll)
+    {
+      //the last poll only reports the dialogs of the previous round and ends the sessions
+      m_mu_dialog_token = 0;
+    }
+  else
+    {
+      m_mu_rounds_remaining--;
+      m_mu_dialog_token++;
+      if (m_mu_dialog_token == 0)
+        {
+          m_mu_dialog_token = 1;
+        }
+    }
+
+  FtmMultiUserPoll poll;
+  for (Mac48Address member : m_mu_group)
+    {
+      Ptr<FtmSession> session = FindSession (member);
+      if (session == 0)
+        {
+          continue;
+        }
+      uint64_t tod = 0;
+      uint64_t toa = 0;
+      if (previous_dialog_token != 0 && session->TakeMultiUserFollowUp (previous_dialog_token, tod, toa))
+        {
+          poll.AddUser (member, previous_dialog_token, tod, toa);
+        }
+      else
+        {
+          poll.AddUser (member, 0, 0, 0);
+        }
+      if (!last_poll)
+        {
+          session->StartMultiUserDialog (m_mu_dialog_token);
+        }
+    }
+
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader(poll);
+
+  FtmResponseHeader ftm_res_hdr;
+  ftm_res_hdr.SetDialogToken(m_mu_dialog_token);
+  packet->AddHeader(ftm_res_hdr);
+
+  WifiActionHeader action_hdr;
+  WifiActionHeader::ActionValue action;
+  action.publicAction = WifiActionHeader::FTM_RESPONSE;
+  action_hdr.SetAction(WifiActionHeader::PUBLIC_ACTION, action);
+  packet->AddHeader(action_hdr);
+
+  WifiMacHeader mac_hdr;
+  mac_hdr.SetAddr1(Mac48Address::GetBroadcast());
+  SendPacket (packet, mac_hdr);
+
+  if (last_poll)
+    {
+      std::list<Mac48Address> group = m_mu_group;
+      m_mu_group.clear();
+      for (Mac48Address member : group)
+        {
+          Ptr<FtmSession> session = FindSession (member);
+          if (session != 0)
+            {
+              session->EndMultiUserSession ();
+            }
+        }
+    }
+  else
+    {
+      m_mu_event = Simulator::Schedule(m_mu_interval, &FtmManager::SendMultiUserPoll, this);
+    }
+}
+
+void
+FtmManager::MultiUserPollReceived (Mac48Address partner, const FtmResponseHeader &ftm_res, const FtmMultiUserPoll &poll)
+{
+  int index = poll.GetUserIndex (m_mac_address);
+  Ptr<FtmSession> session = FindSession (partner);
+  if (index < 0 || session == 0)
+    {
+      return;
+    }
+  uint8_t dialog_token = ftm_res.GetDialogToken();
+  const FtmMultiUserPoll::UserEntry &user = poll.GetUsers ()[index];
+
+  //hand the poll to the session as a regular FTM response, so the RTT calculation stays in the session
+  FtmResponseHeader follow_up;
+  follow_up.SetDialogToken(dialog_token);
+  if (user.follow_up_dialog_token != 0)
+    {
+      follow_up.SetFollowUpDialogToken(user.follow_up_dialog_token);
+      follow_up.SetTimeOfDeparture(user.tod);
+      follow_up.SetTimeOfArrival(user.toa);
+    }
+  if (dialog_token != 0)
+    {
+      Simulator::Schedule(m_mu_reply_spacing * index, &FtmManager::SendMultiUserReply, this, partner, dialog_token);
+    }
+  //a dialog token of 0 ends the session after the last follow up has been processed
+  session->ProcessFtmResponse(follow_up);
+}
+
+void
+FtmManager::SendMultiUserReply (Mac48Address responder, uint8_t dialog_token)
+{
+  if (FindSession (responder) == 0)
+    {
+      return;
+    }
+  Ptr<Packet> packet = Create<Packet> ();
+  FtmMultiUserReply reply;
+  reply.SetResponder (responder);
+  reply.SetDialogToken (dialog_token);
+  packet->AddHeader(reply);
+
+  FtmRequestHeader ftm_req;
+  ftm_req.SetTrigger(1);
+  packet->AddHeader(ftm_req);
+
+  WifiActionHeader action_hdr;
+  WifiActionHeader::ActionValue action;
+  action.publicAction = WifiActionHeader::FTM_REQUEST;
+  action_hdr.SetAction(WifiActionHeader::PUBLIC_ACTION, action);
+  packet->AddHeader(action_hdr);
+
+  //broadcast, so the reply is not acknowledged
+  WifiMacHeader mac_hdr;
+  mac_hdr.SetAddr1(Mac48Address::GetBroadcast());
+  SendPacket (packet, mac_hdr);
+}
+
+const FtmMetrics &
+FtmManager::GetMetrics (void) const
+{
+  return m_metrics;
+}
+
+FtmMemoryAccount
+FtmManager::GetMemoryAccount (void) const
+{
+  std::set<const FtmErrorModel *> counted_models;
+  FtmMemoryUsage usage = GetOwnMemoryUsage ();
+  usage.AddErrorModel (m_passive_error_model, counted_models);
+  for (auto &session : sessions)
+    {
+      usage.Merge (session.second->GetMemoryUsage (counted_models));
+    }
+  for (auto &session : m_session_pool)
+    {
+      usage.Merge (session->GetMemoryUsage (counted_models));
+    }
+  m_memory_account.Sample (usage);
+  return m_memory_account;
+}
+
+FtmMemoryUsage
+FtmManager::GetOwnMemoryUsage (void) const
+{
+  FtmMemoryUsage usage;
+  usage.manager = sizeof (FtmManager)
+      + FtmMemoryUsage::TreeBytes (sessions.size (), sizeof (std::pair<Mac48Address, Ptr<FtmSession>>))
+      + m_session_pool.capacity () * sizeof (Ptr<FtmSession>)
+      + FtmMemoryUsage::ListBytes (m_blocked_partners.size (), sizeof (Mac48Address))
+      + FtmMemoryUsage::TreeBytes (m_passive_responders.size (),
+                                   sizeof (std::pair<Mac48Address, PassiveResponderState>))
+      + FtmMemoryUsage::ListBytes (m_mu_group.size (), sizeof (Mac48Address))
+      + FtmMemoryUsage::ListBytes (m_priority_lane.size (), sizeof (std::pair<Ptr<Packet>, WifiMacHeader>))
+      + FtmMemoryUsage::TreeBytes (m_ftm_enqueue_times.size (), sizeof (std::pair<uint64_t, Time>));
+  return usage;
+}
+
+FtmMetrics
+FtmManager::GetMergedMetrics (void)
+{
+  FtmMetrics merged = g_destroyed_metrics;
+  for (FtmManager *manager : g_metrics_managers)
+    {
+      merged.Merge (manager->m_metrics);
+    }
+  return merged;
+}
+
+Ptr<FtmManager>
+FtmManager::GetFtmManager (Ptr<const WifiPhy> phy)
+{
+  auto search = g_phy_managers.find (PeekPointer (phy));
+  if (search != g_phy_managers.end ())
+    {
+      return search->second;
+    }
+  return 0;
+}
+
+void
+FtmManager::UnregisterPhy (void)
+{
+  auto search = g_phy_managers.find (PeekPointer (m_phy));
+  if (search != g_phy_managers.end () && search->second == this)
+    {
+      g_phy_managers.erase (search);
+    }
+}
+
+void
+FtmManager::RegisterMetrics (void)
+{
+  g_metrics_managers.insert (this);
+  if (!g_metrics_summary_scheduled)
+    {
+      g_metrics_summary_scheduled = true;
+      Simulator::ScheduleDestroy (&FtmManager::WriteMetricsSummary);
+    }
+}
+
+void
+FtmManager::WriteMetricsSummary (void)
+{
+  StringValue path;
+  g_ftm_metrics_summary.GetValue (path);
+  std::string file_name = path.Get ();
+  if (!file_name.empty ())
+    {
+      std::ofstream file (file_name);
+      if (!file.is_open ())
+        {
+          NS_LOG_ERROR ("Could not open FTM metrics summary file " << file_name);
+        }
+      else if (file_name.size () >= 5 && file_name.compare (file_name.size () - 5, 5, ".json") == 0)
+        {
+          GetMergedMetrics ().PrintJson (file);
+        }
+      else
+        {
+          GetMergedMetrics ().PrintCsv (file);
+        }
+    }
+  //the next simulation in the same process starts with new metrics, the managers still alive have been written
+  g_metrics_managers.clear ();
+  g_destroyed_metrics = FtmMetrics ();
+  g_metrics_summary_scheduled = false;
+}
+
+void
+FtmManager::DoDispose (void)
+{
+  Simulator::Cancel (m_detach_event);
+  Simulator::Cancel (m_priority_lane_timeout);
+  Simulator::Cancel (m_ftm_channel_access_timeout);
+  m_priority_lane.clear ();
+  DetachPhyHooks (true);
+  UnregisterPhy ();
+  ReleaseSessions ();
+  m_phy = 0;
+  Object::DoDispose ();
+}
+
+void
+FtmManager::ReleaseSession (Ptr<FtmSession> session)
+{
+  session->SetMetrics (0);
+}
+
+void
+FtmManager::ReleaseSessions (void)
+{
+  //the user may hold the sessions longer than the manager exists
+  for (auto &session : sessions)
+    {
+      ReleaseSession (session.second);
+    }
+  for (auto &session : m_session_pool)
+    {
+      ReleaseSession (session);
+    }
+}
+
+void
+FtmManager::SetLazyPhyHooks (bool lazy)
+{
+  m_lazy_phy_hooks = lazy;
+  UpdatePhyHooks ();
+}
+
+bool
+FtmManager::PhyHooksNeeded (void) const
+{
+  return !m_lazy_phy_hooks || !sessions.empty() || m_passive_listening || m_passive_event.IsRunning ();
+}
+
+void
+FtmManager::UpdatePhyHooks (void)
+{
+  if (m_phy == 0)
+    {
+      return;
+    }
+  if (PhyHooksNeeded ())
+    {
+      Simulator::Cancel (m_detach_event);
+      if (!m_phy_hooks_attached)
+        {
+          AttachPhyHooks ();
+        }
+    }
+  else if (m_phy_hooks_attached && !m_detach_event.IsRunning ())
+    {
+      //the ACK of the last FTM frame and the frames still in the queue need the hooks for a bit longer
+      m_detach_event = Simulator::Schedule (MilliSeconds (100), &FtmManager::DetachPhyHooks, this, false);
+    }
+}
+
+void
+FtmManager::AttachPhyHooks (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_phy->TraceConnectWithoutContext("PhyTxBegin", MakeCallback(&FtmManager::PhyTxBegin, this));
+  m_phy->TraceConnectWithoutContext("PhyRxBegin", MakeCallback(&FtmManager::PhyRxBegin, this));
+  m_phy->TraceConnectWithoutContext("MonitorSnifferRx", MakeCallback(&FtmManager::SnifferRxNotify, this));
+  m_phy->TraceConnectWithoutContext("MonitorSnifferTx", MakeCallback(&FtmManager::SnifferTxNotify, this));
+  m_phy_hooks_attached = true;
+  //the PhyRxBegin of the frame currently received may have been missed
+  m_current_rx_frame.broadcast_ftm = false;
+}
+
+void
+FtmManager::DetachPhyHooks (bool force)
+{
+  NS_LOG_FUNCTION (this << force);
+  if (!m_phy_hooks_attached || (!force && PhyHooksNeeded ()))
+    {
+      return;
+    }
+  m_phy->TraceDisconnectWithoutContext("PhyTxBegin", MakeCallback(&FtmManager::PhyTxBegin, this));
+  m_phy->TraceDisconnectWithoutContext("PhyRxBegin", MakeCallback(&FtmManager::PhyRxBegin, this));
+  m_phy->TraceDisconnectWithoutContext("MonitorSnifferRx", MakeCallback(&FtmManager::SnifferRxNotify, this));
+  m_phy->TraceDisconnectWithoutContext("MonitorSnifferTx", MakeCallback(&FtmManager::SnifferTxNotify, this));
+  m_phy_hooks_attached = false;
+  //the ACK state and the broadcast flag belong to the frames seen while attached
+  awaiting_ack = false;
+  sending_ack = false;
+  m_current_rx_frame.broadcast_ftm = false;
+}
+
 }
@@ -25,10 +25,12 @@
 #include "ns3/wifi-phy.h"
 #include "ns3/packet.h"
 #include "ns3/ftm-session.h"
+#include "ns3/ftm-metrics.h"
 #include "ns3/wifi-mac-header.h"
 #include "ns3/qos-txop.h"
 #include "ns3/ftm-header.h"
 #include "ns3/mgt-headers.h"
+#include "ns3/traced-callback.h"
 
 
 namespace ns3 {
@@ -43,6 +45,16 @@ namespace ns3 {
  * The FTM manager connects to the PHY layer and takes time stamps whenever a packet is sent or received. Processes it
  * and if it is a FTM packet it sets the appropriate time stamps.
  * It forwards the packets to the right sessions and manages them. This means creating and deleting them.
+ *
+ * Besides the per partner sessions, the manager also offers a passive ranging mode. A responder periodically
+ * broadcasts FTM frames, each carrying the time of departure of the previous one. Any number of listening
+ * stations take their own receive time stamps and compute the time difference, without transmitting anything
+ * themselves. Scenarios reach the manager of a device with FtmManager::GetFtmManager (device->GetPhy ()).
+ *
+ * For multi user ranging, in the style of 802.11az trigger based ranging, a responder polls a group of
+ * initiators with one broadcast frame per round. All polled initiators take their time stamps from the same frame
+ * and reply with a short broadcast frame, which needs no ACK. The next poll reports the time of departure and
+ * arrival of every initiator. Each initiator still has its own FtmSession, which calculates the RTTs.
  */
 class FtmManager : public Object
 {
@@ -65,6 +77,29 @@ public:
   virtual
   ~FtmManager ();
 
+  /**
+   * TracedCallback signature for created sessions. The trace sources of the session can be connected here.
+   *
+   * \param session the new session
+   */
+  typedef void (* SessionCreatedTracedCallback)(Ptr<FtmSession> session);
+
+  /**
+   * TracedCallback signature for blocked partners.
+   *
+   * \param partner the partner address
+   * \param duration the time the partner is blocked
+   */
+  typedef void (* SessionBlockedTracedCallback)(Mac48Address partner, Time duration);
+
+  /**
+   * TracedCallback signature for the queueing latency of FTM frames.
+   *
+   * \param packet the FTM frame
+   * \param latency the time from handing the frame to the Txop until the start of its first transmission
+   */
+  typedef void (* QueueLatencyTracedCallback)(Ptr<const Packet> packet, Time latency);
+
   /**
    * Sets the own MAC address.
    *
@@ -90,29 +125,172 @@ public:
    * \param partner the partner address
    * \param ftm_req the FTM request
    */
-  void ReceivedFtmRequest (Mac48Address partner, FtmRequestHeader ftm_req);
+  void ReceivedFtmRequest (Mac48Address partner, const FtmRequestHeader &ftm_req);
 
   /**
    * Called from the RegularWifiMac when a FTM response has been received. It then gets forwarded to
    * the correct FtmSession.
    *
    * \param partner the partner address
-   * \param ftm_req the FTM response
+   * \param ftm_res the FTM response
+   */
+  void ReceivedFtmResponse (Mac48Address partner, const FtmResponseHeader &ftm_res);
+
+  /**
+   * Starts broadcasting FTM frames for passive ranging. Every frame carries the time of departure of the
+   * previous frame as follow up, so listeners can compute the time difference to their receive time stamp.
+   * The responder keeps no state per listening station.
+   *
+   * \param interval the time between two broadcast FTM frames
+   */
+  void StartPassiveRanging (Time interval);
+
+  /**
+   * Stops broadcasting FTM frames for passive ranging.
+   */
+  void StopPassiveRanging (void);
+
+  /**
+   * Enables listening to passive ranging responders. For every received broadcast FTM frame with a valid
+   * follow up, the callback gets the responder address and the measured time difference in pico seconds.
+   * The time difference is the time of flight plus the clock offset between responder and listener.
+   *
+   * \param callback the callback for the passive measurements
+   */
+  void EnablePassiveListening (Callback<void, Mac48Address, int64_t> callback);
+
+  /**
+   * Disables listening to passive ranging responders.
+   */
+  void DisablePassiveListening (void);
+
+  /**
+   * Set the FtmErrorModel used for passive measurements.
+   *
+   * \param error_model the FtmErrorModel
+   */
+  void SetPassiveFtmErrorModel (Ptr<FtmErrorModel> error_model);
+
+  /**
+   * Starts multi user ranging rounds with a group of initiators. A responder session is created for every
+   * initiator, and every round polls all of them with a single broadcast frame. The initiators need to have
+   * joined with JoinMultiUserRanging. The interval has to be larger than the group size times the
+   * MultiUserReplySpacing attribute, so that all replies arrive before the next poll.
+   *
+   * Only the downlink is shared: the poll grows by 19 bytes per initiator and every initiator still sends
+   * its own reply in its own slot, so the airtime of a round grows linearly with the group size. Sending
+   * all replies at the same time needs uplink OFDMA or NDP sounding, which the PHY does not support.
+   *
+   * \param group the initiators to poll
+   * \param rounds the number of rounds
+   * \param interval the time between two rounds
+   */
+  void StartMultiUserRanging (std::list<Mac48Address> group, uint16_t rounds, Time interval);
+
+  /**
+   * Joins the multi user ranging rounds of a responder. The returned session is set up like any other
+   * initiator session, e.g. with an error model and a session over callback, but SessionBegin must not
+   * be called. The session ends after the last round of the responder.
+   *
+   * \param responder the responder address
+   *
+   * \return the FtmSession, 0 if a session with the responder already exists
    */
-  void ReceivedFtmResponse (Mac48Address partner, FtmResponseHeader ftm_res);
+  Ptr<FtmSession> JoinMultiUserRanging (Mac48Address responder);
+
+  /**
+   * Returns the metrics of this manager and its sessions.
+   *
+   * \return the metrics
+   */
+  const FtmMetrics & GetMetrics (void) const;
+
+  /**
+   * Computes the live memory usage of this manager and its sessions, including the finished sessions kept for
+   * reuse, and updates the peaks with it. Packets waiting in the FTM queues are not included. The usage is only
+   * computed here, so the peaks are the largest usage of all calls, see FtmMemoryAccount.
+   *
+   * \return the memory account
+   */
+  FtmMemoryAccount GetMemoryAccount (void) const;
+
+  /**
+   * Sets if the PHY trace hooks are only connected while the manager needs them, i.e. while it has sessions or
+   * does passive ranging. Otherwise they are connected for the whole lifetime of the manager.
+   *
+   * \param lazy if the hooks are connected lazily
+   */
+  void SetLazyPhyHooks (bool lazy);
+
+  /**
+   * Returns the merged metrics of all managers of the current simulation, including the destroyed ones.
+   *
+   * \return the merged metrics
+   */
+  static FtmMetrics GetMergedMetrics (void);
+
+  /**
+   * Returns the manager that takes the time stamps of the PHY. The manager is not aggregated to the PHY,
+   * as the PHY would then keep the manager alive and the manager the PHY.
+   *
+   * \param phy the PHY
+   * \return the manager, 0 if the PHY has none
+   */
+  static Ptr<FtmManager> GetFtmManager (Ptr<const WifiPhy> phy);
 
 
 private:
 
   /**
-   * Structure to store all the header pieces.
+   * Structure to store the parts of an FTM response that are needed once its ack is seen.
    */
   struct PacketInPieces
   {
-    WifiMacHeader mac_hdr;
-    WifiActionHeader action_hdr;
-    FtmRequestHeader ftm_req_hdr;
-    FtmResponseHeader ftm_res_hdr;
+    Mac48Address partner; //!< The receiver of a transmitted frame or the sender of a received frame.
+    uint8_t dialog_token; //!< The dialog token of the FTM response.
+  };
+
+  /**
+   * Structure to store what PhyTxBegin found out about the frame currently sent, so its airtime can be
+   * accounted without parsing the frame again.
+   */
+  struct TxFrameInfo
+  {
+    uint64_t uid; //!< The uid of the sent packet.
+    bool airtime; //!< If the frame is an FTM frame or the ACK of one.
+    FtmAirtime::FrameType type; //!< The airtime type of the frame.
+    Mac48Address partner; //!< The receiver of the FTM frame or the partner of the acknowledged one.
+  };
+
+  /**
+   * Structure to store what PhyRxBegin found out about the frame currently received, so the end of the
+   * reception can be handled without parsing the frame again. A reception which does not end with the same
+   * uid was aborted, so everything that depends on the frame being received is only done at its end.
+   */
+  struct RxFrameInfo
+  {
+    uint64_t uid; //!< The uid of the received packet.
+    bool airtime; //!< If the frame is an FTM frame or the ACK of one.
+    FtmAirtime::FrameType type; //!< The airtime type of the frame.
+    Mac48Address partner; //!< The sender of the FTM frame or the partner of the acknowledged one.
+    bool ack_expected; //!< If the frame is an FTM response to this station, which the MAC acknowledges.
+    bool ftm_ack; //!< If the frame is the ACK of the FTM response sent last.
+    uint8_t dialog_token; //!< The dialog token of the FTM response or of the acknowledged one.
+    int64_t timestamp; //!< The time stamp of the start of the reception.
+    bool broadcast_ftm; //!< If the frame is a broadcast FTM frame, which is never forwarded to a session.
+    bool mu_poll; //!< If the frame is a multi user poll.
+    FtmResponseHeader ftm_res; //!< The FTM response of the multi user poll.
+    FtmMultiUserPoll poll; //!< The multi user poll.
+  };
+
+  /**
+   * Structure to store the last broadcast FTM frame received from a passive ranging responder.
+   */
+  struct PassiveResponderState
+  {
+    uint8_t dialog_token;
+    uint64_t rx_time;
+    double signal_strength;
   };
 
   /**
@@ -133,7 +311,8 @@ private:
 
   /**
    * Called from the PHY layer when a frame gets received and a time stamp gets taken.
-   * Time stamp then gets added to the correct session, if it is an FTM frame.
+   * This is the only place a received frame gets parsed: the time stamp and the signal strength
+   * then get added to the correct session in one go, if it is an FTM frame.
    *
    * \param packet the packet
    * \param rxPowersW the power
@@ -142,7 +321,8 @@ private:
 
   /**
    * Called from PHY when packet fully received.
-   * Used to extract the signal strength for error calculation
+   * Used to account the airtime of received FTM frames, to expect the ACK of a received FTM response, to set
+   * the time stamp of a received ACK and to process multi user polls, with what PhyRxBegin stored about the frame.
    *
    * @param packet the packet
    * @param channelFreqMhz frequency
@@ -153,6 +333,37 @@ private:
    */
   void SnifferRxNotify(Ptr<const Packet> packet, uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu, SignalNoiseDbm signalNoise, uint16_t staId);
 
+  /**
+   * Called from PHY when a packet starts transmitting, after PhyTxBegin.
+   * Used to account the airtime of sent FTM frames, with what PhyTxBegin stored about the frame.
+   *
+   * @param packet the packet
+   * @param channelFreqMhz frequency
+   * @param txVector the TX vector the packet is sent with
+   * @param aMpdu
+   * @param staId
+   */
+  void SnifferTxNotify(Ptr<const Packet> packet, uint16_t channelFreqMhz, WifiTxVector txVector, MpduInfo aMpdu, uint16_t staId);
+
+  /**
+   * Adds the airtime of an FTM frame or the ACK of one to the metrics and its session.
+   *
+   * \param type the type of the frame
+   * \param partner the partner of the session
+   * \param start the start of the frame on the channel
+   * \param duration the duration of the frame
+   * \param tx true if the frame was sent, false if it was received
+   */
+  void AddAirtime (FtmAirtime::FrameType type, Mac48Address partner, Time start, Time duration, bool tx);
+
+  /**
+   * Returns the receive power of a frame, which is the power of the widest band.
+   *
+   * \param rxPowersW the receive power per band
+   * \return the receive power [dBm]
+   */
+  static double GetRxPowerDbm (const RxPowerWattPerChannelBand &rxPowersW);
+
   /**
    * Sends the specified packet with the specified header.
    *
@@ -161,6 +372,70 @@ private:
    */
   void SendPacket (Ptr<Packet> packet, WifiMacHeader hdr);
 
+  /**
+   * Queues an FTM frame in the Txop. With the priority lane, the frame is moved to the front of the Txop queue,
+   * ahead of the other frames of the Txop. These are the management frames and, for non QoS stations, the data
+   * frames. The data frames of QoS stations are in the EDCA queues and are not overtaken. Only one FTM frame is at
+   * the front at a time, the others wait in the lane, so the FTM frames keep their order.
+   *
+   * \param packet the packet
+   * \param hdr the header
+   */
+  void QueueFtmFrame (Ptr<Packet> packet, const WifiMacHeader &hdr);
+
+  /**
+   * Frees the front of the Txop queue for the next FTM frame of the priority lane. Called when the frame at the
+   * front starts on the PHY, or 100 ms after it was queued, in case it was dropped.
+   */
+  void AdvancePriorityLane (void);
+
+  /**
+   * Applies the FtmAifsn, FtmMinCw and FtmMaxCw attributes to the Txop for an FTM frame about to be queued.
+   * The values of the Txop are saved when the first FTM frame is queued. The Txop is shared with the other
+   * management frames, so they use the FTM values as well until the parameters are restored.
+   */
+  void ApplyFtmChannelAccess (void);
+
+  /**
+   * Restores the channel access parameters of the Txop saved by ApplyFtmChannelAccess. Called when the last
+   * queued FTM frame starts on the PHY, or 100 ms after the last FTM frame was queued, in case it was dropped.
+   */
+  void RestoreTxopChannelAccess (void);
+
+  /**
+   * Takes a finished session out of the pool and resets it.
+   *
+   * \return the session or 0 if no session can be reused
+   */
+  Ptr<FtmSession> TakePooledSession (void);
+
+  /**
+   * Connects or disconnects the PHY trace hooks, depending on whether the manager needs them. Disconnecting is
+   * delayed, so that the last frames of a session are still seen.
+   */
+  void UpdatePhyHooks (void);
+
+  /**
+   * Connects the PHY trace hooks.
+   */
+  void AttachPhyHooks (void);
+
+  /**
+   * Disconnects the PHY trace hooks, if they are still not needed.
+   *
+   * \param force disconnect even if the hooks are still needed
+   */
+  void DetachPhyHooks (bool force);
+
+  /**
+   * Returns if the manager needs the PHY trace hooks.
+   *
+   * \return true if the hooks are needed
+   */
+  bool PhyHooksNeeded (void) const;
+
+  virtual void DoDispose (void);
+
   /**
    * Blocks new sessions with the partner for the given duration.
    *
@@ -198,10 +473,49 @@ private:
    * \param partner the partner address
    * \param ftm_req the FTM request
    */
-  void OverrideSession (Mac48Address partner, FtmRequestHeader ftm_req);
+  void OverrideSession (Mac48Address partner, const FtmRequestHeader &ftm_req);
+
+  /**
+   * Sends the next broadcast FTM frame for passive ranging and schedules the following one.
+   */
+  void SendPassiveFtmFrame (void);
+
+  /**
+   * Processes a broadcast FTM frame received from a passive ranging responder.
+   *
+   * \param partner the responder address
+   * \param ftm_res the FTM response
+   * \param rx_time the receive time stamp
+   * \param sig_str the signal strength of the frame
+   */
+  void PassiveFtmFrameReceived (Mac48Address partner, const FtmResponseHeader &ftm_res, uint64_t rx_time, double sig_str);
+
+  /**
+   * Sends the next multi user poll and schedules the following one.
+   */
+  void SendMultiUserPoll (void);
+
+  /**
+   * Processes a fully received multi user poll on the initiator side.
+   *
+   * \param partner the responder address
+   * \param ftm_res the FTM response of the poll
+   * \param poll the multi user poll
+   */
+  void MultiUserPollReceived (Mac48Address partner, const FtmResponseHeader &ftm_res, const FtmMultiUserPoll &poll);
+
+  /**
+   * Sends the reply to a multi user poll.
+   *
+   * \param responder the responder address
+   * \param dialog_token the dialog token of the poll
+   */
+  void SendMultiUserReply (Mac48Address responder, uint8_t dialog_token);
 
   Mac48Address m_mac_address; //!< The mac address.
   std::map<Mac48Address, Ptr<FtmSession>> sessions; //!< The FTM sessions this manager has.
+  std::vector<Ptr<FtmSession>> m_session_pool; //!< Finished sessions kept for reuse.
+  uint32_t m_session_pool_size; //!< The maximum number of pooled sessions.
   unsigned int received_packets;  //!< How many packets have been received, after transmitting a FTM frame.
   bool awaiting_ack; //!< Next packet should be ack.
 
@@ -210,14 +524,94 @@ private:
   Mac48Address m_ack_to; //!< Who the ack should go to.
 
   Ptr<Txop> m_txop; //!< The Txop.
+  Ptr<WifiPhy> m_phy; //!< The PHY the trace hooks are connected to.
+  bool m_lazy_phy_hooks; //!< If the PHY trace hooks are only connected while needed.
+  bool m_phy_hooks_attached; //!< If the PHY trace hooks are connected.
+  EventId m_detach_event; //!< Delayed disconnect of the PHY trace hooks.
+
+  bool m_priority_lane_enabled; //!< If FTM frames are moved to the front of the management Txop queue.
+  uint32_t m_ftm_aifsn; //!< The AIFSN set on the Txop, 0 to keep it.
+  uint32_t m_ftm_min_cw; //!< The min CW set on the Txop, 0 to keep it.
+  uint32_t m_ftm_max_cw; //!< The max CW set on the Txop, 0 to keep it.
+  uint32_t m_ftm_channel_access_frames; //!< FTM frames queued with the FTM channel access, not yet on the PHY.
+  uint32_t m_txop_aifsn; //!< The AIFSN of the Txop, restored after the FTM frames.
+  uint32_t m_txop_min_cw; //!< The min CW of the Txop, restored after the FTM frames.
+  uint32_t m_txop_max_cw; //!< The max CW of the Txop, restored after the FTM frames.
+  EventId m_ftm_channel_access_timeout; //!< Restores the Txop if the queued FTM frames do not reach the PHY.
+  std::list<std::pair<Ptr<Packet>, WifiMacHeader> > m_priority_lane; //!< FTM frames waiting for the front of the queue.
+  bool m_priority_lane_busy; //!< If an FTM frame of the lane is at the front of the queue.
+  uint64_t m_priority_lane_head; //!< Uid of the FTM frame at the front of the queue.
+  EventId m_priority_lane_timeout; //!< Frees the lane if the FTM frame at the front does not reach the PHY.
+  std::map<uint64_t, Time> m_ftm_enqueue_times; //!< The enqueue time of every FTM frame not yet transmitted.
 
   Time m_preamble_detection_duration; //!< The preamble detection duration.
 
   PacketInPieces m_current_tx_packet; //!< The currently transmitted packet.
   PacketInPieces m_current_rx_packet; //!< The currently received packet.
+  TxFrameInfo m_current_tx_frame; //!< What PhyTxBegin found out about the currently sent frame.
+  RxFrameInfo m_current_rx_frame; //!< What PhyRxBegin found out about the currently received frame.
 
   std::list<Mac48Address> m_blocked_partners; //!< List of all the blocked partners.
 
+
+  Time m_passive_interval; //!< The interval between broadcast FTM frames.
+  EventId m_passive_event; //!< Next broadcast FTM frame event id.
+  uint8_t m_passive_dialog_token; //!< The dialog token of the last broadcast FTM frame.
+  uint64_t m_passive_tod; //!< The time of departure of the last broadcast FTM frame.
+
+  bool m_passive_listening; //!< If passive listening is enabled.
+  Callback<void, Mac48Address, int64_t> m_passive_callback; //!< Passive measurement callback.
+  Ptr<FtmErrorModel> m_passive_error_model; //!< The error model for passive measurements.
+  std::map<Mac48Address, PassiveResponderState> m_passive_responders; //!< Last frame of every responder heard.
+
+  std::list<Mac48Address> m_mu_group; //!< The initiators polled in multi user ranging.
+  uint8_t m_mu_dialog_token; //!< The dialog token of the current multi user round.
+  uint16_t m_mu_rounds_remaining; //!< The remaining multi user rounds.
+  Time m_mu_interval; //!< The time between two multi user rounds.
+  Time m_mu_reply_spacing; //!< The time between the replies of two initiators.
+  EventId m_mu_event; //!< Next multi user poll event id.
+
+  FtmMetrics m_metrics; //!< The metrics of this manager and its sessions.
+
+  mutable FtmMemoryAccount m_memory_account; //!< The memory usage of this manager and its sessions.
+
+  /**
+   * \return the memory used by the manager itself, without its sessions and error models
+   */
+  FtmMemoryUsage GetOwnMemoryUsage (void) const;
+
+  /**
+   * Clears the pointer of the session to the metrics of this manager.
+   *
+   * \param session the session
+   */
+  void ReleaseSession (Ptr<FtmSession> session);
+
+  /**
+   * Releases all running and pooled sessions, see ReleaseSession.
+   */
+  void ReleaseSessions (void);
+
+  /**
+   * Removes this manager from the managers reachable through GetFtmManager.
+   */
+  void UnregisterPhy (void);
+
+  /**
+   * Adds this manager to the managers whose metrics are merged at Simulator::Destroy.
+   */
+  void RegisterMetrics (void);
+
+  /**
+   * Merges the metrics of all managers and writes them to the file of the FtmMetricsSummary global value.
+   */
+  static void WriteMetricsSummary (void);
+
+  TracedCallback<Ptr<FtmSession> > m_session_created_trace; //!< Session created trace.
+  TracedCallback<Mac48Address> m_session_overridden_trace; //!< Session overridden trace.
+  TracedCallback<Mac48Address, Time> m_session_blocked_trace; //!< Partner blocked trace.
+  TracedCallback<Mac48Address> m_session_unblocked_trace; //!< Partner unblocked trace.
+  TracedCallback<Ptr<const Packet>, Time> m_ftm_queue_latency_trace; //!< FTM queue latency trace.
 };
 
 }
@@ -0,0 +1,352 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *
+ * Copyright (C) 2022 Christos Laskos
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ftm-metrics.h"
+#include "ns3/ftm-error-model.h"
+#include <algorithm>
+
+
+namespace ns3 {
+
+FtmHistogram::FtmHistogram (double lower, double bucket_width, uint32_t buckets)
+  : m_lower (lower),
+    m_bucket_width (bucket_width),
+    m_buckets (buckets),
+    m_count (0),
+    m_sum (0)
+{
+}
+
+void
+FtmHistogram::Add (double value)
+{
+  double bucket = (value - m_lower) / m_bucket_width;
+  if (bucket < 0)
+    {
+      m_counts[0]++;
+    }
+  else if (bucket >= m_buckets)
+    {
+      m_counts[m_buckets + 1]++;
+    }
+  else
+    {
+      m_counts[static_cast<uint32_t> (bucket) + 1]++;
+    }
+  m_count++;
+  m_sum += value;
+}
+
+void
+FtmHistogram::Merge (const FtmHistogram &other)
+{
+  NS_ASSERT (other.m_lower == m_lower && other.m_bucket_width == m_bucket_width && other.m_buckets == m_buckets);
+  for (auto &bucket : other.m_counts)
+    {
+      m_counts[bucket.first] += bucket.second;
+    }
+  m_count += other.m_count;
+  m_sum += other.m_sum;
+}
+
+uint64_t
+FtmHistogram::GetCount (void) const
+{
+  return m_count;
+}
+
+double
+FtmHistogram::GetMean (void) const
+{
+  if (m_count == 0)
+    {
+      return 0;
+    }
+  return m_sum / m_count;
+}
+
+void
+FtmHistogram::PrintJson (std::ostream &os) const
+{
+  auto underflow = m_counts.find (0);
+  auto overflow = m_counts.find (m_buckets + 1);
+  os << "{\"count\": " << m_count << ", \"mean\": " << GetMean ()
+     << ", \"lower\": " << m_lower << ", \"bucket_width\": " << m_bucket_width
+     << ", \"underflow\": " << (underflow != m_counts.end () ? underflow->second : 0)
+     << ", \"overflow\": " << (overflow != m_counts.end () ? overflow->second : 0)
+     << ", \"buckets\": {";
+  bool first = true;
+  for (auto &bucket : m_counts)
+    {
+      if (bucket.first == 0 || bucket.first == m_buckets + 1)
+        {
+          continue;
+        }
+      os << (first ? "" : ", ") << "\"" << m_lower + (bucket.first - 1) * m_bucket_width << "\": " << bucket.second;
+      first = false;
+    }
+  os << "}}";
+}
+
+void
+FtmHistogram::PrintCsv (std::ostream &os, std::string name) const
+{
+  auto underflow = m_counts.find (0);
+  auto overflow = m_counts.find (m_buckets + 1);
+  os << name << ",-inf," << m_lower << "," << (underflow != m_counts.end () ? underflow->second : 0) << std::endl;
+  for (auto &bucket : m_counts)
+    {
+      if (bucket.first == 0 || bucket.first == m_buckets + 1)
+        {
+          continue;
+        }
+      double lower = m_lower + (bucket.first - 1) * m_bucket_width;
+      os << name << "," << lower << "," << lower + m_bucket_width << "," << bucket.second << std::endl;
+    }
+  os << name << "," << m_lower + m_buckets * m_bucket_width << ",inf,"
+     << (overflow != m_counts.end () ? overflow->second : 0) << std::endl;
+}
+
+void
+FtmAirtime::Add (FrameType type, bool tx, Time duration)
+{
+  switch (type)
+    {
+    case FTM_REQUEST:
+      (tx ? tx_requests : rx_requests) += duration;
+      break;
+    case FTM_RESPONSE:
+      (tx ? tx_responses : rx_responses) += duration;
+      break;
+    case ACK:
+      (tx ? tx_acks : rx_acks) += duration;
+      break;
+    }
+}
+
+void
+FtmAirtime::Merge (const FtmAirtime &other)
+{
+  tx_requests += other.tx_requests;
+  rx_requests += other.rx_requests;
+  tx_responses += other.tx_responses;
+  rx_responses += other.rx_responses;
+  tx_acks += other.tx_acks;
+  rx_acks += other.rx_acks;
+  burst_idle += other.burst_idle;
+}
+
+Time
+FtmAirtime::GetTotal (void) const
+{
+  return tx_requests + rx_requests + tx_responses + rx_responses + tx_acks + rx_acks;
+}
+
+FtmMetrics::FtmMetrics ()
+  : rx_frames_inspected (0),
+    rx_ftm_frames (0),
+    tx_frames_inspected (0),
+    tx_ftm_frames (0),
+    ack_mismatches (0),
+    dialogs_created (0),
+    rtts_calculated (0),
+    zero_timestamp_dialogs (0),
+    timestamp_poll_retries (0),
+    sessions_created (0),
+    sessions_accepted (0),
+    sessions_denied (0),
+    sessions_expired (0),
+    sessions_overridden (0),
+    partners_blocked (0),
+    rtt (-10000, 1000, 2010),
+    signal_strength (-120, 1, 120),
+    queue_latency (0, 10, 2000)
+{
+}
+
+void
+FtmMetrics::Merge (const FtmMetrics &other)
+{
+  rx_frames_inspected += other.rx_frames_inspected;
+  rx_ftm_frames += other.rx_ftm_frames;
+  tx_frames_inspected += other.tx_frames_inspected;
+  tx_ftm_frames += other.tx_ftm_frames;
+  ack_mismatches += other.ack_mismatches;
+  dialogs_created += other.dialogs_created;
+  rtts_calculated += other.rtts_calculated;
+  zero_timestamp_dialogs += other.zero_timestamp_dialogs;
+  timestamp_poll_retries += other.timestamp_poll_retries;
+  sessions_created += other.sessions_created;
+  sessions_accepted += other.sessions_accepted;
+  sessions_denied += other.sessions_denied;
+  sessions_expired += other.sessions_expired;
+  sessions_overridden += other.sessions_overridden;
+  partners_blocked += other.partners_blocked;
+  airtime.Merge (other.airtime);
+  rtt.Merge (other.rtt);
+  signal_strength.Merge (other.signal_strength);
+  queue_latency.Merge (other.queue_latency);
+}
+
+/*
+ * name and value of every counter, in the order they are written
+ */
+static std::vector<std::pair<std::string, uint64_t>>
+GetCounters (const FtmMetrics &metrics)
+{
+  return {
+    {"rx_frames_inspected", metrics.rx_frames_inspected},
+    {"rx_ftm_frames", metrics.rx_ftm_frames},
+    {"tx_frames_inspected", metrics.tx_frames_inspected},
+    {"tx_ftm_frames", metrics.tx_ftm_frames},
+    {"ack_mismatches", metrics.ack_mismatches},
+    {"dialogs_created", metrics.dialogs_created},
+    {"rtts_calculated", metrics.rtts_calculated},
+    {"zero_timestamp_dialogs", metrics.zero_timestamp_dialogs},
+    {"timestamp_poll_retries", metrics.timestamp_poll_retries},
+    {"sessions_created", metrics.sessions_created},
+    {"sessions_accepted", metrics.sessions_accepted},
+    {"sessions_denied", metrics.sessions_denied},
+    {"sessions_expired", metrics.sessions_expired},
+    {"sessions_overridden", metrics.sessions_overridden},
+    {"partners_blocked", metrics.partners_blocked},
+    {"airtime_tx_requests_ns", static_cast<uint64_t> (metrics.airtime.tx_requests.GetNanoSeconds ())},
+    {"airtime_rx_requests_ns", static_cast<uint64_t> (metrics.airtime.rx_requests.GetNanoSeconds ())},
+    {"airtime_tx_responses_ns", static_cast<uint64_t> (metrics.airtime.tx_responses.GetNanoSeconds ())},
+    {"airtime_rx_responses_ns", static_cast<uint64_t> (metrics.airtime.rx_responses.GetNanoSeconds ())},
+    {"airtime_tx_acks_ns", static_cast<uint64_t> (metrics.airtime.tx_acks.GetNanoSeconds ())},
+    {"airtime_rx_acks_ns", static_cast<uint64_t> (metrics.airtime.rx_acks.GetNanoSeconds ())},
+    {"airtime_burst_idle_ns", static_cast<uint64_t> (metrics.airtime.burst_idle.GetNanoSeconds ())}
+  };
+}
+
+void
+FtmMetrics::PrintJson (std::ostream &os) const
+{
+  os << "{" << std::endl;
+  for (auto counter : GetCounters (*this))
+    {
+      os << "  \"" << counter.first << "\": " << counter.second << "," << std::endl;
+    }
+  os << "  \"rtt_ps\": ";
+  rtt.PrintJson (os);
+  os << "," << std::endl << "  \"signal_strength_dbm\": ";
+  signal_strength.PrintJson (os);
+  os << "," << std::endl << "  \"queue_latency_us\": ";
+  queue_latency.PrintJson (os);
+  os << std::endl << "}" << std::endl;
+}
+
+void
+FtmMetrics::PrintCsv (std::ostream &os) const
+{
+  os << "metric,value" << std::endl;
+  for (auto counter : GetCounters (*this))
+    {
+      os << counter.first << "," << counter.second << std::endl;
+    }
+  os << "rtt_ps_mean," << rtt.GetMean () << std::endl;
+  os << "signal_strength_dbm_mean," << signal_strength.GetMean () << std::endl;
+  os << "queue_latency_us_mean," << queue_latency.GetMean () << std::endl;
+  os << std::endl << "histogram,lower,upper,count" << std::endl;
+  rtt.PrintCsv (os, "rtt_ps");
+  signal_strength.PrintCsv (os, "signal_strength_dbm");
+  queue_latency.PrintCsv (os, "queue_latency_us");
+}
+
+FtmMemoryUsage::FtmMemoryUsage ()
+  : sessions (0),
+    dialogs (0),
+    error_models (0),
+    manager (0)
+{
+}
+
+void
+FtmMemoryUsage::Merge (const FtmMemoryUsage &other)
+{
+  sessions += other.sessions;
+  dialogs += other.dialogs;
+  error_models += other.error_models;
+  manager += other.manager;
+}
+
+uint64_t
+FtmMemoryUsage::GetTotal (void) const
+{
+  return sessions + dialogs + error_models + manager;
+}
+
+void
+FtmMemoryUsage::PrintJson (std::ostream &os) const
+{
+  os << "{\"sessions\": " << sessions << ", \"dialogs\": " << dialogs << ", \"error_models\": " << error_models
+     << ", \"manager\": " << manager << ", \"total\": " << GetTotal () << "}";
+}
+
+uint64_t
+FtmMemoryUsage::ListBytes (std::size_t elements, std::size_t element_size)
+{
+  //previous and next pointer
+  return elements * (2 * sizeof (void *) + element_size);
+}
+
+uint64_t
+FtmMemoryUsage::TreeBytes (std::size_t elements, std::size_t element_size)
+{
+  //color, parent, left and right
+  return elements * (4 * sizeof (void *) + element_size);
+}
+
+void
+FtmMemoryUsage::AddErrorModel (Ptr<const FtmErrorModel> model, std::set<const FtmErrorModel *> &counted_models)
+{
+  if (model != 0 && counted_models.insert (PeekPointer (model)).second)
+    {
+      error_models += model->GetMemoryUsage ();
+    }
+}
+
+FtmMemoryAccount::FtmMemoryAccount ()
+  : peak_total (0)
+{
+}
+
+void
+FtmMemoryAccount::Sample (const FtmMemoryUsage &usage)
+{
+  live = usage;
+  peak.sessions = std::max (peak.sessions, live.sessions);
+  peak.dialogs = std::max (peak.dialogs, live.dialogs);
+  peak.error_models = std::max (peak.error_models, live.error_models);
+  peak.manager = std::max (peak.manager, live.manager);
+  peak_total = std::max (peak_total, live.GetTotal ());
+}
+
+void
+FtmMemoryAccount::SampleSession (const FtmMemoryUsage &usage)
+{
+  if (usage.GetTotal () > session_peak.GetTotal ())
+    {
+      session_peak = usage;
+    }
+}
+
+} /* namespace ns3 */
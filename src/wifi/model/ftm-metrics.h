@@ -0,0 +1,305 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *
+ * Copyright (C) 2022 Christos Laskos
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef FTM_METRICS_H_
+#define FTM_METRICS_H_
+
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include <map>
+#include <set>
+#include <string>
+#include <ostream>
+
+namespace ns3 {
+
+class FtmErrorModel;
+
+/**
+ * \brief Sparse histogram for the FTM metrics.
+ * \ingroup FTM
+ *
+ * Counts values in buckets of equal width, plus one bucket for values below and one for values above the range.
+ * Only buckets with at least one value are stored, so a wide range with fine buckets only costs memory for the
+ * buckets that are actually hit. Adding a value is one division and one map lookup.
+ */
+class FtmHistogram
+{
+public:
+  /**
+   * Creates the histogram.
+   *
+   * \param lower the lower bound of the first bucket
+   * \param bucket_width the width of every bucket
+   * \param buckets the number of buckets
+   */
+  FtmHistogram (double lower, double bucket_width, uint32_t buckets);
+
+  /**
+   * Adds a value.
+   *
+   * \param value the value
+   */
+  void Add (double value);
+
+  /**
+   * Adds all values of another histogram with the same buckets.
+   *
+   * \param other the other histogram
+   */
+  void Merge (const FtmHistogram &other);
+
+  /**
+   * Returns the number of values.
+   *
+   * \return the number of values
+   */
+  uint64_t GetCount (void) const;
+
+  /**
+   * Returns the mean of all values, 0 if there are none.
+   *
+   * \return the mean
+   */
+  double GetMean (void) const;
+
+  /**
+   * Writes the histogram as JSON object.
+   *
+   * \param os the output stream
+   */
+  void PrintJson (std::ostream &os) const;
+
+  /**
+   * Writes the histogram as CSV lines in the format name,lower,upper,count. The underflow and overflow buckets
+   * are always written, the other buckets only if they are not empty.
+   *
+   * \param os the output stream
+   * \param name the name of the histogram
+   */
+  void PrintCsv (std::ostream &os, std::string name) const;
+
+private:
+  double m_lower; //!< The lower bound of the first bucket.
+  double m_bucket_width; //!< The width of every bucket.
+  uint32_t m_buckets; //!< The number of buckets, without underflow and overflow.
+  std::map<uint32_t, uint64_t> m_counts; //!< The non empty buckets, 0 is the underflow and m_buckets + 1 the overflow.
+  uint64_t m_count; //!< The number of values.
+  double m_sum; //!< The sum of all values.
+};
+
+/**
+ * \brief Channel time used by FTM frames.
+ * \ingroup FTM
+ *
+ * The airtime of a frame is its PPDU duration for the TX vector it is sent with, counted separately for sent and
+ * received frames. ACKs are only counted if they acknowledge an FTM frame. The idle time is the time between the
+ * end of the previous frame of a session and an FTM response of the same burst.
+ */
+struct FtmAirtime
+{
+  /**
+   * The frame types with airtime.
+   */
+  enum FrameType {
+    FTM_REQUEST,
+    FTM_RESPONSE,
+    ACK
+  };
+
+  /**
+   * Adds the airtime of a frame.
+   *
+   * \param type the frame type
+   * \param tx true if the frame was sent, false if it was received
+   * \param duration the airtime of the frame
+   */
+  void Add (FrameType type, bool tx, Time duration);
+
+  /**
+   * Adds the airtime of another struct.
+   *
+   * \param other the other airtime
+   */
+  void Merge (const FtmAirtime &other);
+
+  /**
+   * \return the airtime of all frames, without the idle time
+   */
+  Time GetTotal (void) const;
+
+  Time tx_requests; //!< Sent FTM requests.
+  Time rx_requests; //!< Received FTM requests.
+  Time tx_responses; //!< Sent FTM responses.
+  Time rx_responses; //!< Received FTM responses.
+  Time tx_acks; //!< Sent ACKs of FTM frames.
+  Time rx_acks; //!< Received ACKs of FTM frames.
+  Time burst_idle; //!< Idle time between the frames of a burst.
+};
+
+/**
+ * \brief Aggregate FTM metrics of one FtmManager and its sessions.
+ * \ingroup FTM
+ *
+ * Plain counters and sparse histograms, which are always collected. The metrics of all managers are
+ * merged at Simulator::Destroy and written to the file given by the global value FtmMetricsSummary.
+ */
+struct FtmMetrics
+{
+  FtmMetrics ();
+
+  /**
+   * Adds all metrics of another struct.
+   *
+   * \param other the other metrics
+   */
+  void Merge (const FtmMetrics &other);
+
+  /**
+   * Writes the metrics as one JSON object.
+   *
+   * \param os the output stream
+   */
+  void PrintJson (std::ostream &os) const;
+
+  /**
+   * Writes the metrics as CSV, with the counters as name,value lines followed by the histogram buckets.
+   *
+   * \param os the output stream
+   */
+  void PrintCsv (std::ostream &os) const;
+
+  uint64_t rx_frames_inspected; //!< Frames seen in PhyRxBegin.
+  uint64_t rx_ftm_frames; //!< FTM frames processed in PhyRxBegin.
+  uint64_t tx_frames_inspected; //!< Frames seen in PhyTxBegin.
+  uint64_t tx_ftm_frames; //!< FTM frames processed in PhyTxBegin.
+  uint64_t ack_mismatches; //!< Other frames received while waiting for the ACK of an FTM frame.
+  uint64_t dialogs_created; //!< Dialogs created.
+  uint64_t rtts_calculated; //!< Dialogs with a calculated RTT.
+  uint64_t zero_timestamp_dialogs; //!< Dialogs dropped because a time stamp was not set.
+  uint64_t timestamp_poll_retries; //!< Times an FTM was delayed because the time stamps were not set yet.
+  uint64_t sessions_created; //!< Sessions created.
+  uint64_t sessions_accepted; //!< Sessions accepted.
+  uint64_t sessions_denied; //!< Sessions denied.
+  uint64_t sessions_expired; //!< Sessions expired.
+  uint64_t sessions_overridden; //!< Responder sessions overridden by a new FTM request.
+  uint64_t partners_blocked; //!< Partners blocked after a failed request.
+  FtmAirtime airtime; //!< Airtime of the FTM frames and their ACKs.
+  FtmHistogram rtt; //!< RTT distribution, 1 ns buckets from -10 ns to 2 us, in pico seconds.
+  FtmHistogram signal_strength; //!< Signal strength distribution, 1 dB buckets from -120 dBm to 0 dBm.
+  FtmHistogram queue_latency; //!< Enqueue to PHY start latency of FTM frames, 10 us buckets up to 20 ms, in micro seconds.
+};
+
+/**
+ * \brief Memory used by the FTM objects, in bytes per category.
+ * \ingroup FTM
+ *
+ * The objects are counted with their size plus the elements of their containers, node based containers with the
+ * pointers of a node in addition. The values are an estimate of the heap usage, allocator overhead is not
+ * included. Error models can be shared, they are counted once per model, not per holder. FtmMaps are shared
+ * between error models and are not included, see FtmMap::GetMemoryUsage.
+ */
+struct FtmMemoryUsage
+{
+  FtmMemoryUsage ();
+
+  /**
+   * Adds the usage of another struct.
+   *
+   * \param other the other usage
+   */
+  void Merge (const FtmMemoryUsage &other);
+
+  /**
+   * \return the sum of all categories
+   */
+  uint64_t GetTotal (void) const;
+
+  /**
+   * Writes the usage as one JSON object.
+   *
+   * \param os the output stream
+   */
+  void PrintJson (std::ostream &os) const;
+
+  /**
+   * \param elements the number of elements of a std::list
+   * \param element_size the size of an element
+   * \return the memory used by the nodes of the list
+   */
+  static uint64_t ListBytes (std::size_t elements, std::size_t element_size);
+
+  /**
+   * \param elements the number of elements of a std::map or std::set
+   * \param element_size the size of an element, key and value for maps
+   * \return the memory used by the nodes of the tree
+   */
+  static uint64_t TreeBytes (std::size_t elements, std::size_t element_size);
+
+  /**
+   * Adds the memory of an error model, if it was not counted before.
+   *
+   * \param model the error model, may be 0
+   * \param counted_models the error models counted so far, the model is added
+   */
+  void AddErrorModel (Ptr<const FtmErrorModel> model, std::set<const FtmErrorModel *> &counted_models);
+
+  uint64_t sessions; //!< FtmSession objects with their lists, maps and buffers.
+  uint64_t dialogs; //!< FtmDialog objects, including the ones kept for reuse.
+  uint64_t error_models; //!< FtmErrorModel objects of the sessions, including the random generator state.
+  uint64_t manager; //!< FtmManager objects with their session maps, lists and queues.
+};
+
+/**
+ * \brief Live and peak memory usage of one FtmManager and its sessions.
+ * \ingroup FTM
+ *
+ * The usage is not tracked while the sessions run, it is computed when the account is read with
+ * FtmManager::GetMemoryAccount, which also updates the peaks. The peaks are the largest usage of all reads, so a
+ * scenario which needs them reads the account periodically. In addition every session is measured when it ends,
+ * with all its RTTs, which gives the peak of a single session.
+ */
+struct FtmMemoryAccount
+{
+  FtmMemoryAccount ();
+
+  /**
+   * Sets the live usage and updates the peaks.
+   *
+   * \param usage the current usage of the manager and its sessions
+   */
+  void Sample (const FtmMemoryUsage &usage);
+
+  /**
+   * Updates the peak of a single session.
+   *
+   * \param usage the usage of an ending session
+   */
+  void SampleSession (const FtmMemoryUsage &usage);
+
+  FtmMemoryUsage live; //!< The usage at the last read.
+  FtmMemoryUsage peak; //!< The peak usage of every category.
+  uint64_t peak_total; //!< The peak of the total usage.
+  FtmMemoryUsage session_peak; //!< The usage of the largest session when it ended.
+};
+
+} /* namespace ns3 */
+
+#endif /* FTM_METRICS_H_ */
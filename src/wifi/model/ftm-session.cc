@@ -23,12 +23,16 @@
 #include "ns3/core-module.h"
 #include "ns3/mgt-headers.h"
 #include "ns3/wifi-mac-header.h"
+#include <algorithm>
 
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("FtmSession");
 
+/// Maximum number of deleted dialogs a session keeps for reuse.
+static const std::size_t FREE_DIALOGS_MAX = 64;
+
 NS_OBJECT_ENSURE_REGISTERED (FtmSession);
 
 TypeId
@@ -49,6 +53,34 @@ FtmSession::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&FtmSession::SetDefaultFtmParamsHolder),
                    MakePointerChecker<FtmParamsHolder> ())
+    .AddTraceSource ("DialogCreated",
+                     "A new dialog has been created.",
+                     MakeTraceSourceAccessor (&FtmSession::m_dialog_created_trace),
+                     "ns3::FtmSession::DialogTracedCallback")
+    .AddTraceSource ("TimestampSet",
+                     "One of the time stamps T1 to T4 of a dialog has been set.",
+                     MakeTraceSourceAccessor (&FtmSession::m_timestamp_trace),
+                     "ns3::FtmSession::TimestampTracedCallback")
+    .AddTraceSource ("RttCalculated",
+                     "The RTT of a dialog has been calculated, with the error of the error model.",
+                     MakeTraceSourceAccessor (&FtmSession::m_rtt_trace),
+                     "ns3::FtmSession::RttTracedCallback")
+    .AddTraceSource ("DialogDropped",
+                     "A dialog has been dropped, because at least one of its time stamps was not set.",
+                     MakeTraceSourceAccessor (&FtmSession::m_dialog_dropped_trace),
+                     "ns3::FtmSession::DialogTracedCallback")
+    .AddTraceSource ("SessionAccepted",
+                     "The responder has accepted the FTM parameters of the session.",
+                     MakeTraceSourceAccessor (&FtmSession::m_session_accepted_trace),
+                     "ns3::FtmSession::SessionTracedCallback")
+    .AddTraceSource ("SessionDenied",
+                     "The responder has denied the FTM parameters of the session.",
+                     MakeTraceSourceAccessor (&FtmSession::m_session_denied_trace),
+                     "ns3::FtmSession::SessionTracedCallback")
+    .AddTraceSource ("SessionExpired",
+                     "The session has expired or the responder did not answer the FTM request in time.",
+                     MakeTraceSourceAccessor (&FtmSession::m_session_expired_trace),
+                     "ns3::FtmSession::SessionTracedCallback")
   ;
   return tid;
 }
@@ -63,6 +95,8 @@ FtmSession::FtmSession ()
   m_live_rtt_enabled = false;
   m_timestamp_set_checks_next_frame = 0;
   m_timestamp_set_checks_last_frame = 0;
+  m_trigger_set = false;
+  m_metrics = 0;
   CreateDefaultFtmParams ();
 
   send_packet = MakeNullCallback <void, Ptr<Packet>, WifiMacHeader> ();
@@ -70,7 +104,7 @@ FtmSession::FtmSession ()
   session_over_callback = MakeNullCallback<void, FtmSession> ();
   block_session = MakeNullCallback<void, Mac48Address, Time> ();
   live_rtt = MakeNullCallback<void, int64_t> ();
-  session_override = MakeNullCallback<void, Mac48Address, FtmRequestHeader> ();
+  session_override = MakeNullCallback<void, Mac48Address, const FtmRequestHeader &> ();
 }
 
 FtmSession::~FtmSession ()
@@ -87,7 +121,60 @@ FtmSession::~FtmSession ()
   session_over_callback = MakeNullCallback<void, FtmSession> ();
   block_session = MakeNullCallback<void, Mac48Address, Time> ();
   live_rtt = MakeNullCallback<void, int64_t> ();
-  session_override = MakeNullCallback<void, Mac48Address, FtmRequestHeader> ();
+  session_override = MakeNullCallback<void, Mac48Address, const FtmRequestHeader &> ();
+}
+
+void
+FtmSession::NotifyConstructionCompleted (void)
+{
+  m_initial_ftm_error_model = m_ftm_error_model;
+  m_initial_default_ftm_params = m_default_ftm_params;
+  Object::NotifyConstructionCompleted ();
+}
+
+void
+FtmSession::Reset (void)
+{
+  Simulator::Cancel (m_session_expire_event);
+  Simulator::Cancel (m_session_active_check_event);
+  Simulator::Cancel (m_next_burst_event);
+  Simulator::Cancel (m_next_packet_event);
+
+  for (auto &entry : m_ftm_dialogs)
+    {
+      if (m_free_dialogs.size () < FREE_DIALOGS_MAX)
+        {
+          m_free_dialogs.push_back (entry.second);
+        }
+    }
+  m_ftm_dialogs.clear ();
+  m_current_dialog = 0;
+  m_rtt_list.clear ();
+  m_sig_str_list.clear ();
+
+  m_session_type = FTM_UNINITIALIZED;
+  m_ftm_params = FtmParams ();
+  m_default_ftm_params = m_initial_default_ftm_params;
+  m_ftm_error_model = m_initial_ftm_error_model;
+  m_session_over_callback_set = false;
+  m_dialog_token_overflow = false;
+  m_session_active = false;
+  m_live_rtt_enabled = false;
+  m_timestamp_set_checks_next_frame = 0;
+  m_timestamp_set_checks_last_frame = 0;
+  session_over_callback = MakeNullCallback<void, FtmSession> ();
+  live_rtt = MakeNullCallback<void, int64_t> ();
+
+  m_dialog_created_trace = TracedCallback<Mac48Address, uint8_t> ();
+  m_timestamp_trace = TracedCallback<Mac48Address, uint8_t, uint8_t, uint64_t> ();
+  m_rtt_trace = TracedCallback<Mac48Address, uint8_t, int64_t, int64_t> ();
+  m_dialog_dropped_trace = TracedCallback<Mac48Address, uint8_t> ();
+  m_session_accepted_trace = TracedCallback<Mac48Address> ();
+  m_session_denied_trace = TracedCallback<Mac48Address> ();
+  m_session_expired_trace = TracedCallback<Mac48Address> ();
+  m_airtime = FtmAirtime ();
+  m_last_frame_end = Time ();
+  m_burst_start = Time ();
 }
 
 void
@@ -96,6 +183,10 @@ FtmSession::InitSession (Mac48Address partner_addr, SessionType type, Callback <
   m_partner_addr = partner_addr;
   m_session_type = type;
   send_packet = callback;
+  if (m_ftm_error_model != 0)
+    {
+      m_ftm_error_model->SetPartner (m_partner_addr);
+    }
   if (type == FTM_INITIATOR)
     {
       UseDefaultFtmParams ();
@@ -109,19 +200,19 @@ FtmSession::SetPreambleDetectionDuration (Time duration)
 }
 
 void
-FtmSession::SetFtmParams (FtmParams ftm_params)
+FtmSession::SetFtmParams (const FtmParams &ftm_params)
 {
   m_ftm_params = ftm_params;
 }
 
-FtmParams
-FtmSession::GetFtmParams (void)
+const FtmParams &
+FtmSession::GetFtmParams (void) const
 {
   return m_ftm_params;
 }
 
 void
-FtmSession::ProcessFtmRequest (FtmRequestHeader ftm_req)
+FtmSession::ProcessFtmRequest (const FtmRequestHeader &ftm_req)
 {
   if (ftm_req.GetTrigger() == 1)
     {
@@ -130,6 +221,11 @@ FtmSession::ProcessFtmRequest (FtmRequestHeader ftm_req)
           SetFtmParams(ftm_req.GetFtmParams());
           if (ValidateFtmParams()) //if parameters valid then session gets accepted
             {
+              m_session_accepted_trace (m_partner_addr);
+              if (m_metrics != 0)
+                {
+                  m_metrics->sessions_accepted++;
+                }
               m_session_active = true;
               m_ftm_params.SetStatusIndication(FtmParams::SUCCESSFUL);
               m_ftm_params.SetAsapCapable(true);
@@ -142,6 +238,11 @@ FtmSession::ProcessFtmRequest (FtmRequestHeader ftm_req)
             }
           else
             {
+              m_session_denied_trace (m_partner_addr);
+              if (m_metrics != 0)
+                {
+                  m_metrics->sessions_denied++;
+                }
               DenySession ();
             }
         }
@@ -163,7 +264,7 @@ FtmSession::ProcessFtmRequest (FtmRequestHeader ftm_req)
 }
 
 void
-FtmSession::ProcessFtmResponse (FtmResponseHeader ftm_res)
+FtmSession::ProcessFtmResponse (const FtmResponseHeader &ftm_res)
 {
   if (ftm_res.GetFtmParamsSet())
     {
@@ -171,9 +272,13 @@ FtmSession::ProcessFtmResponse (FtmResponseHeader ftm_res)
       FtmParams::StatusIndication status = m_ftm_params.GetStatusIndication();
       if (status == FtmParams::SUCCESSFUL)
         {
+          m_session_accepted_trace (m_partner_addr);
+          if (m_metrics != 0)
+            {
+              m_metrics->sessions_accepted++;
+            }
           m_session_active = true;
           Simulator::Cancel(m_session_active_check_event);
-//          std::cout << "inactive cancelled at t=" << Simulator::Now().GetSeconds() << std::endl;
 
           m_number_of_bursts_remaining = 1 << m_ftm_params.GetNumberOfBurstsExponent(); // 2 ^ Number of Bursts
           m_next_burst_period = MilliSeconds(m_ftm_params.GetBurstPeriod() * 100);
@@ -195,12 +300,16 @@ FtmSession::ProcessFtmResponse (FtmResponseHeader ftm_res)
               m_next_burst_event = Simulator::Schedule(m_next_burst_period, &FtmSession::StartNextBurst, this);
             }
           session_expire += m_number_of_bursts_remaining * m_next_burst_period;
-//          std::cout << "session expiration:" << session_expire.GetSeconds() << std::endl;
           m_session_expire_event = Simulator::Schedule(session_expire, &FtmSession::SessionExpired, this);
         }
       else if (status == FtmParams::REQUEST_FAILED)
         {
           NS_LOG_ERROR ("FTM Request Failed!");
+          m_session_denied_trace (m_partner_addr);
+          if (m_metrics != 0)
+            {
+              m_metrics->sessions_denied++;
+            }
           if (m_ftm_params.GetStatusIndicationValue () != 0)
             {
               Time timeout = Seconds (m_ftm_params.GetStatusIndicationValue());
@@ -212,6 +321,11 @@ FtmSession::ProcessFtmResponse (FtmResponseHeader ftm_res)
       else
         {
           NS_LOG_ERROR ("FTM Request Incapable!");
+          m_session_denied_trace (m_partner_addr);
+          if (m_metrics != 0)
+            {
+              m_metrics->sessions_denied++;
+            }
           EndSession ();
           return;
         }
@@ -234,6 +348,8 @@ FtmSession::ProcessFtmResponse (FtmResponseHeader ftm_res)
         {
           follow_up_dialog->t1 = ftm_res.GetTimeOfDeparture();
           follow_up_dialog->t4 = ftm_res.GetTimeOfArrival();
+          m_timestamp_trace (m_partner_addr, follow_up_dialog->dialog_token, 1, follow_up_dialog->t1);
+          m_timestamp_trace (m_partner_addr, follow_up_dialog->dialog_token, 4, follow_up_dialog->t4);
           CalculateRTT (follow_up_dialog);
           //after RTT is calculated, we are done with this dialog and can delete it from the list
           DeleteDialog(ftm_res.GetFollowUpDialogToken());
@@ -258,14 +374,7 @@ FtmSession::ValidateFtmParams (void)
     {
       m_ftm_params.SetNumberOfBurstsExponent (m_default_ftm_params.GetNumberOfBurstsExponent ());
     }
-  uint8_t burst_duration = m_ftm_params.GetBurstDuration ();
-  if (burst_duration <= 1 || (burst_duration >= 12 && burst_duration <= 14))
-    {
-      NS_LOG_ERROR ("FTM session denied! Burst duration set to a reserved value. Should be in range [2, 11] "
-          "or 15 if no preference.");
-      return false;
-    }
-  if (burst_duration == 15)
+  if (m_ftm_params.GetBurstDuration () == 15)
     {
       m_ftm_params.SetBurstDuration (m_default_ftm_params.GetBurstDuration ());
     }
@@ -299,19 +408,12 @@ FtmSession::ValidateFtmParams (void)
     {
       m_ftm_params.SetBurstPeriod (m_default_ftm_params.GetBurstPeriod ());
     }
-  //validate if burst duration is enough to fit all packets with min delta ftm spacing
-  //if it is not enough, we cant accept this session
-  unsigned int min_required_burst_duration = (m_ftm_params.GetFtmsPerBurst() + 1) * m_ftm_params.GetMinDeltaFtm() * 100;
-  if (min_required_burst_duration > m_ftm_params.DecodeBurstDuration())
-    {
-      NS_LOG_ERROR ("FTM session denied! This may be caused by a too small burst duration, too many FTMs per burst "
-          "for the specified burst duration or a too large min delta FTM for the specified burst duration and "
-          "FTMs per burst.");
-      return false;
-    }
-  if (m_ftm_params.GetFtmsPerBurst() == 1 && m_ftm_params.GetNumberOfBurstsExponent() == 0)
+  //validate if the burst duration is valid and enough to fit all packets with min delta ftm spacing
+  //if it is not, we cant accept this session
+  FtmParamsFeasibility::Result result = FtmParamsFeasibility::Check (m_ftm_params);
+  if (result != FtmParamsFeasibility::FEASIBLE)
     {
-      NS_LOG_ERROR ("FTM session denied! Can not do anything useful with 1 FTM per burst and 1 burst.");
+      NS_LOG_ERROR ("FTM session denied! " << FtmParamsFeasibility::GetDescription (result));
       return false;
     }
   return true;
@@ -343,7 +445,7 @@ FtmSession::CreateDefaultFtmParams (void)
 }
 
 void
-FtmSession::SetDefaultFtmParams (FtmParams params)
+FtmSession::SetDefaultFtmParams (const FtmParams &params)
 {
   m_default_ftm_params = params;
 }
@@ -383,7 +485,6 @@ FtmSession::SessionBegin (void)
 
       Time check_active = MilliSeconds(50);
       m_session_active_check_event = Simulator::Schedule(check_active, &FtmSession::CheckSessionActive, this);
-//      std::cout << "inactive timeout start at t=" << Simulator::Now().GetSeconds() << std::endl;
     }
   else if (m_session_type == FTM_RESPONDER)
     {
@@ -438,7 +539,6 @@ FtmSession::SessionBegin (void)
       packet->AddHeader(hdr);
 
       session_expire += m_number_of_bursts_remaining * m_next_burst_period;
-//      std::cout << "session expiration:" << session_expire.GetSeconds() << std::endl;
       m_session_expire_event = Simulator::Schedule(session_expire, &FtmSession::SessionExpired, this);
     }
   else
@@ -465,6 +565,10 @@ FtmSession::SendNextFtmPacket (void)
         {
           m_next_packet_event = Simulator::Schedule(m_next_ftm_packet / 4, &FtmSession::SendNextFtmPacket, this);
           m_timestamp_set_checks_next_frame++;
+          if (m_metrics != 0)
+            {
+              m_metrics->timestamp_poll_retries++;
+            }
           return;
         }
       bool add_tsf_sync = false;
@@ -491,31 +595,20 @@ FtmSession::SendNextFtmPacket (void)
       m_ftm_dialogs.insert({m_current_dialog_token, new_dialog});
 
       Ptr<FtmDialog> previous_dialog = FindDialog (m_previous_dialog_token);
-      FtmResponseHeader ftm_res_hdr;
-      ftm_res_hdr.SetDialogToken(m_current_dialog_token);
+      m_response_template.SetDialogToken(m_current_dialog_token);
       if(previous_dialog != 0)
         {
-          ftm_res_hdr.SetFollowUpDialogToken(m_previous_dialog_token);
-          ftm_res_hdr.SetTimeOfDeparture(previous_dialog->t1);
-          ftm_res_hdr.SetTimeOfArrival(previous_dialog->t4);
+          m_response_template.SetFollowUp(m_previous_dialog_token, previous_dialog->t1, previous_dialog->t4);
         }
-      if (m_ftms_per_burst_remaining <= 0 && m_number_of_bursts_remaining <= 0)
+      else
         {
-          ftm_res_hdr.SetDialogToken(0);
+          m_response_template.SetFollowUp(0, 0, 0);
         }
-      Ptr<Packet> packet = Create<Packet> ();
-      if (add_tsf_sync)
+      if (m_ftms_per_burst_remaining <= 0 && m_number_of_bursts_remaining <= 0)
         {
-          TsfSyncInfo tsf_sync;
-          packet->AddHeader (tsf_sync);
+          m_response_template.SetDialogToken(0);
         }
-      packet->AddHeader(ftm_res_hdr);
-
-      WifiActionHeader hdr;
-      WifiActionHeader::ActionValue action;
-      action.publicAction = WifiActionHeader::FTM_RESPONSE;
-      hdr.SetAction(WifiActionHeader::PUBLIC_ACTION, action);
-      packet->AddHeader(hdr);
+      Ptr<Packet> packet = m_response_template.CreatePacket (add_tsf_sync);
 
       WifiMacHeader mac_hdr;
       mac_hdr.SetAddr1(m_partner_addr);
@@ -544,6 +637,10 @@ FtmSession::SendNextFtmPacket (void)
         {
           m_next_packet_event = Simulator::Schedule(m_next_ftm_packet, &FtmSession::SendNextFtmPacket, this);
           m_timestamp_set_checks_last_frame++;
+          if (m_metrics != 0)
+            {
+              m_metrics->timestamp_poll_retries++;
+            }
           return;
         }
       /*
@@ -551,20 +648,9 @@ FtmSession::SendNextFtmPacket (void)
        * we do not have to create a new one and advance the dialog token. This is the last dialog of the session.
        */
       Ptr<FtmDialog> previous_dialog = FindDialog (m_current_dialog_token);
-      FtmResponseHeader ftm_res_hdr;
-      ftm_res_hdr.SetDialogToken(0);
-      ftm_res_hdr.SetFollowUpDialogToken(m_current_dialog_token);
-      ftm_res_hdr.SetTimeOfDeparture(previous_dialog->t1);
-      ftm_res_hdr.SetTimeOfArrival(previous_dialog->t4);
-
-      Ptr<Packet> packet = Create<Packet> ();
-      packet->AddHeader(ftm_res_hdr);
-
-      WifiActionHeader hdr;
-      WifiActionHeader::ActionValue action;
-      action.publicAction = WifiActionHeader::FTM_RESPONSE;
-      hdr.SetAction(WifiActionHeader::PUBLIC_ACTION, action);
-      packet->AddHeader(hdr);
+      m_response_template.SetDialogToken(0);
+      m_response_template.SetFollowUp(m_current_dialog_token, previous_dialog->t1, previous_dialog->t4);
+      Ptr<Packet> packet = m_response_template.CreatePacket (false);
 
       WifiMacHeader mac_hdr;
       mac_hdr.SetAddr1(m_partner_addr);
@@ -620,6 +706,7 @@ FtmSession::SetT1 (uint8_t dialog_token, uint64_t timestamp)
   if(dialog != 0)
     {
       dialog->t1 = timestamp;
+      m_timestamp_trace (m_partner_addr, dialog_token, 1, timestamp);
     }
 }
 
@@ -633,6 +720,21 @@ FtmSession::SetT2 (uint8_t dialog_token, uint64_t timestamp)
       m_ftm_dialogs.insert({dialog_token, dialog});
     }
   dialog->t2 = timestamp;
+  m_timestamp_trace (m_partner_addr, dialog_token, 2, timestamp);
+}
+
+void
+FtmSession::SetT2 (uint8_t dialog_token, uint64_t timestamp, double sig_str)
+{
+  Ptr<FtmDialog> dialog = FindDialog (dialog_token);
+  if(dialog == 0)
+    {
+      dialog = CreateNewDialog(dialog_token);
+      m_ftm_dialogs.insert({dialog_token, dialog});
+    }
+  dialog->t2 = timestamp;
+  dialog->signal_strength = sig_str;
+  m_timestamp_trace (m_partner_addr, dialog_token, 2, timestamp);
 }
 
 void
@@ -642,6 +744,7 @@ FtmSession::SetT3 (uint8_t dialog_token, uint64_t timestamp)
   if(dialog != 0)
     {
       dialog->t3 = timestamp;
+      m_timestamp_trace (m_partner_addr, dialog_token, 3, timestamp);
     }
 }
 
@@ -652,6 +755,7 @@ FtmSession::SetT4 (uint8_t dialog_token, uint64_t timestamp)
   if(dialog != 0)
     {
       dialog->t4 = timestamp;
+      m_timestamp_trace (m_partner_addr, dialog_token, 4, timestamp);
     }
 }
 
@@ -679,18 +783,46 @@ FtmSession::FindDialog (uint8_t dialog_token)
 void
 FtmSession::DeleteDialog (uint8_t dialog_token)
 {
-  m_ftm_dialogs.erase (dialog_token);
+  auto search = m_ftm_dialogs.find (dialog_token);
+  if (search == m_ftm_dialogs.end())
+    {
+      return;
+    }
+  if (m_free_dialogs.size () < FREE_DIALOGS_MAX)
+    {
+      m_free_dialogs.push_back (search->second);
+    }
+  m_ftm_dialogs.erase (search);
 }
 
 Ptr<FtmSession::FtmDialog>
 FtmSession::CreateNewDialog (uint8_t dialog_token)
 {
-  Ptr<FtmDialog> new_dialog = Create<FtmDialog> ();
+  Ptr<FtmDialog> new_dialog;
+  while (new_dialog == 0 && !m_free_dialogs.empty ())
+    {
+      //dialogs still referenced elsewhere, e.g. by a copy of the session handed to the user, are not reused
+      if (m_free_dialogs.back ()->GetReferenceCount () == 1)
+        {
+          new_dialog = m_free_dialogs.back ();
+        }
+      m_free_dialogs.pop_back ();
+    }
+  if (new_dialog == 0)
+    {
+      new_dialog = Create<FtmDialog> ();
+    }
+  new_dialog->signal_strength = 0;
   new_dialog->dialog_token = dialog_token;
   new_dialog->t1 = 0;
   new_dialog->t2 = 0;
   new_dialog->t3 = 0;
   new_dialog->t4 = 0;
+  m_dialog_created_trace (m_partner_addr, dialog_token);
+  if (m_metrics != 0)
+    {
+      m_metrics->dialogs_created++;
+    }
   return new_dialog;
 }
 
@@ -752,7 +884,11 @@ FtmSession::CalculateRTT (Ptr<FtmDialog> dialog)
   if (CheckTimeStampEqualZero(dialog)) {
       m_rtt_list.push_back (rtt);
       m_sig_str_list.push_back (0);
-//      std::cout << "time stamp is zero" << std::endl;
+      m_dialog_dropped_trace (m_partner_addr, dialog->dialog_token);
+      if (m_metrics != 0)
+        {
+          m_metrics->zero_timestamp_dialogs++;
+        }
       return;
   }
   int64_t diff_t4_t1;
@@ -780,10 +916,18 @@ FtmSession::CalculateRTT (Ptr<FtmDialog> dialog)
   rtt -= 2 * m_preamble_detection_duration;
 
   //add the error given by the current error model, by default error model is disabled
-  rtt += m_ftm_error_model->GetFtmError(dialog->signal_strength);
+  int64_t error = m_ftm_error_model->GetFtmError(dialog->signal_strength);
+  rtt += error;
 
   m_rtt_list.push_back (rtt);
   m_sig_str_list.push_back (dialog->signal_strength);
+  m_rtt_trace (m_partner_addr, dialog->dialog_token, rtt, error);
+  if (m_metrics != 0)
+    {
+      m_metrics->rtts_calculated++;
+      m_metrics->rtt.Add (rtt);
+      m_metrics->signal_strength.Add (dialog->signal_strength);
+    }
 
   if (m_live_rtt_enabled)
     {
@@ -833,7 +977,11 @@ FtmSession::CheckSessionActive (void)
 {
   if (!m_session_active)
     {
-//      std::cout << "inactive at t=" << Simulator::Now().GetSeconds() << std::endl;
+      m_session_expired_trace (m_partner_addr);
+      if (m_metrics != 0)
+        {
+          m_metrics->sessions_expired++;
+        }
       EndSession();
     }
 }
@@ -843,8 +991,11 @@ FtmSession::SessionExpired (void)
 {
   if (m_session_active)
     {
-      // m_session_type = 0 initiator, 1 = responder
-//      std::cout << "expired at t=" << Simulator::Now().GetSeconds() << " type=" << m_session_type << std::endl;
+      m_session_expired_trace (m_partner_addr);
+      if (m_metrics != 0)
+        {
+          m_metrics->sessions_expired++;
+        }
       EndSession();
     }
 }
@@ -853,7 +1004,6 @@ void
 FtmSession::EndSession (void)
 {
   m_session_active = false;
-//  if (m_session_type == FTM_RESPONDER) std::cout << test_value << std::endl;
 //  if (m_session_over_callback_set && m_session_type == FTM_INITIATOR) //to fix break from session_override
   if (m_session_over_callback_set)
     {
@@ -904,16 +1054,25 @@ FtmSession::DenySession (void)
 void
 FtmSession::SendTrigger (void)
 {
-  Ptr<Packet> packet = Create<Packet> ();
-  FtmRequestHeader ftm_req;
-  ftm_req.SetTrigger(1);
-  packet->AddHeader(ftm_req);
+  //the trigger frame never changes, so serialize it only once per session
+  if (!m_trigger_set)
+    {
+      Ptr<Packet> packet = Create<Packet> ();
+      FtmRequestHeader ftm_req;
+      ftm_req.SetTrigger(1);
+      packet->AddHeader(ftm_req);
 
-  WifiActionHeader action_hdr;
-  WifiActionHeader::ActionValue action;
-  action.publicAction = WifiActionHeader::FTM_REQUEST;
-  action_hdr.SetAction(WifiActionHeader::PUBLIC_ACTION, action);
-  packet->AddHeader(action_hdr);
+      WifiActionHeader action_hdr;
+      WifiActionHeader::ActionValue action;
+      action.publicAction = WifiActionHeader::FTM_REQUEST;
+      action_hdr.SetAction(WifiActionHeader::PUBLIC_ACTION, action);
+      packet->AddHeader(action_hdr);
+
+      NS_ASSERT (packet->GetSize () == sizeof (m_trigger));
+      packet->CopyData (m_trigger, sizeof (m_trigger));
+      m_trigger_set = true;
+    }
+  Ptr<Packet> packet = Create<Packet> (m_trigger, sizeof (m_trigger));
 
   WifiMacHeader mac_hdr;
   mac_hdr.SetAddr1(m_partner_addr);
@@ -924,6 +1083,10 @@ void
 FtmSession::SetFtmErrorModel (Ptr<FtmErrorModel> error_model)
 {
   m_ftm_error_model = error_model;
+  if (m_ftm_error_model != 0 && m_session_type != FTM_UNINITIALIZED)
+    {
+      m_ftm_error_model->SetPartner (m_partner_addr);
+    }
 }
 
 void
@@ -940,7 +1103,90 @@ FtmSession::DisableLiveRTTFeedback (void)
 }
 
 void
-FtmSession::SetOverrideCallback (Callback<void, Mac48Address, FtmRequestHeader> callback)
+FtmSession::StartMultiUserDialog (uint8_t dialog_token)
+{
+  m_session_active = true;
+  DeleteDialog (dialog_token);
+  Ptr<FtmDialog> dialog = CreateNewDialog (dialog_token);
+  m_ftm_dialogs.insert({dialog_token, dialog});
+}
+
+bool
+FtmSession::TakeMultiUserFollowUp (uint8_t dialog_token, uint64_t &tod, uint64_t &toa)
+{
+  Ptr<FtmDialog> dialog = FindDialog (dialog_token);
+  if (dialog == 0)
+    {
+      return false;
+    }
+  DeleteDialog (dialog_token);
+  if (dialog->t1 == 0 || dialog->t4 == 0)
+    {
+      return false;
+    }
+  tod = dialog->t1;
+  toa = dialog->t4;
+  return true;
+}
+
+void
+FtmSession::EndMultiUserSession (void)
+{
+  EndSession ();
+}
+
+void
+FtmSession::SetMetrics (FtmMetrics *metrics)
+{
+  m_metrics = metrics;
+}
+
+FtmMemoryUsage
+FtmSession::GetMemoryUsage (std::set<const FtmErrorModel *> &counted_models) const
+{
+  FtmMemoryUsage usage;
+  usage.sessions = sizeof (FtmSession)
+      + FtmMemoryUsage::TreeBytes (m_ftm_dialogs.size (), sizeof (std::pair<uint8_t, Ptr<FtmDialog>>))
+      + FtmMemoryUsage::ListBytes (m_rtt_list.size (), sizeof (int64_t))
+      + FtmMemoryUsage::ListBytes (m_sig_str_list.size (), sizeof (double))
+      + m_free_dialogs.capacity () * sizeof (Ptr<FtmDialog>);
+  //the current dialog is always in the map or already deleted
+  usage.dialogs = (m_ftm_dialogs.size () + m_free_dialogs.size ()) * sizeof (FtmDialog);
+  usage.AddErrorModel (m_ftm_error_model, counted_models);
+  usage.AddErrorModel (m_initial_ftm_error_model, counted_models);
+  return usage;
+}
+
+Time
+FtmSession::AddAirtime (FtmAirtime::FrameType type, bool tx, Time start, Time duration)
+{
+  m_airtime.Add (type, tx, duration);
+  Time idle;
+  if (type == FtmAirtime::FTM_RESPONSE)
+    {
+      Time burst_duration = MicroSeconds (m_ftm_params.DecodeBurstDuration ());
+      if (m_burst_start.IsStrictlyPositive () && start - m_burst_start < burst_duration)
+        {
+          idle = Max (start - m_last_frame_end, Time ());
+          m_airtime.burst_idle += idle;
+        }
+      else
+        {
+          m_burst_start = start;
+        }
+    }
+  m_last_frame_end = Max (m_last_frame_end, start + duration);
+  return idle;
+}
+
+const FtmAirtime &
+FtmSession::GetAirtime (void) const
+{
+  return m_airtime;
+}
+
+void
+FtmSession::SetOverrideCallback (Callback<void, Mac48Address, const FtmRequestHeader &> callback)
 {
   session_override = callback;
 }
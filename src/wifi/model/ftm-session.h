@@ -28,6 +28,12 @@
 #include "ns3/ftm-header.h"
 #include "ns3/nstime.h"
 #include "ns3/ftm-error-model.h"
+#include "ns3/ftm-metrics.h"
+#include "ns3/traced-callback.h"
+#include <vector>
+#include <map>
+#include <set>
+#include <ostream>
 
 
 namespace ns3 {
@@ -62,6 +68,42 @@ public:
     FTM_UNINITIALIZED
   };
 
+  /**
+   * TracedCallback signature for session events.
+   *
+   * \param partner the partner address
+   */
+  typedef void (* SessionTracedCallback)(Mac48Address partner);
+
+  /**
+   * TracedCallback signature for dialog events.
+   *
+   * \param partner the partner address
+   * \param dialog_token the dialog token
+   */
+  typedef void (* DialogTracedCallback)(Mac48Address partner, uint8_t dialog_token);
+
+  /**
+   * TracedCallback signature for time stamps.
+   *
+   * \param partner the partner address
+   * \param dialog_token the dialog token
+   * \param index the index of the time stamp, 1 for T1 to 4 for T4
+   * \param timestamp the time stamp in pico seconds
+   */
+  typedef void (* TimestampTracedCallback)(Mac48Address partner, uint8_t dialog_token, uint8_t index,
+                                           uint64_t timestamp);
+
+  /**
+   * TracedCallback signature for calculated RTTs.
+   *
+   * \param partner the partner address
+   * \param dialog_token the dialog token
+   * \param rtt the RTT in pico seconds, including the error
+   * \param error the error added by the error model in pico seconds
+   */
+  typedef void (* RttTracedCallback)(Mac48Address partner, uint8_t dialog_token, int64_t rtt, int64_t error);
+
   /**
    * \brief FTM dialog implementation.
    * \ingroup FTM
@@ -124,28 +166,28 @@ public:
    *
    * \param params the FtmParams
    */
-  void SetFtmParams (FtmParams params);
+  void SetFtmParams (const FtmParams &params);
 
   /**
    * Returns the FTM parameters of the session.
    *
    * \return the FtmParams
    */
-  FtmParams GetFtmParams (void);
+  const FtmParams & GetFtmParams (void) const;
 
   /**
    * Processes a received FTM request frame.
    *
    * \param ftm_req the FTM request
    */
-  void ProcessFtmRequest (FtmRequestHeader ftm_req);
+  void ProcessFtmRequest (const FtmRequestHeader &ftm_req);
 
   /**
    * Processes a received FTM response frame.
    *
    * \param ftm_res the FTM response
    */
-  void ProcessFtmResponse (FtmResponseHeader ftm_res);
+  void ProcessFtmResponse (const FtmResponseHeader &ftm_res);
 
   /**
    * Starts the FTM session. This should be called by the user after the setup of the session has been completed.
@@ -169,6 +211,15 @@ public:
    */
   void SetT2 (uint8_t dialog_token, uint64_t timestamp);
 
+  /**
+   * Sets T2 and the signal strength of the received FTM frame with one dialog lookup.
+   *
+   * \param dialog_token the dialog token
+   * \param timestamp the time stamp
+   * \param sig_str the signal strength
+   */
+  void SetT2 (uint8_t dialog_token, uint64_t timestamp, double sig_str);
+
   /**
    * Sets T3.
    *
@@ -252,14 +303,52 @@ public:
    *
    * \param callback the callback to the manager over ride function
    */
-  void SetOverrideCallback (Callback<void, Mac48Address, FtmRequestHeader> callback);
+  void SetOverrideCallback (Callback<void, Mac48Address, const FtmRequestHeader &> callback);
+
+  /**
+   * Set the metrics the session adds to. This is done by the FtmManager, which owns the metrics.
+   *
+   * \param metrics the metrics, 0 to disable
+   */
+  void SetMetrics (FtmMetrics *metrics);
+
+  /**
+   * Returns the memory used by this session: the session itself with its lists and maps, its dialogs including
+   * the ones kept for reuse and its error models. Error models shared with other sessions are only counted if
+   * they are not in counted_models yet.
+   *
+   * \param counted_models the error models counted so far, the ones of this session are added
+   * \return the memory usage of the session, the manager category is 0
+   */
+  FtmMemoryUsage GetMemoryUsage (std::set<const FtmErrorModel *> &counted_models) const;
+
+  /**
+   * Adds the airtime of a frame of this session. Called by the FtmManager from the PHY sniffer traces.
+   * For FTM responses the time since the end of the previous frame of the session is counted as idle time,
+   * if it is within the burst duration of the FtmParams since the first response of the burst.
+   *
+   * \param type the frame type
+   * \param tx true if the frame was sent, false if it was received
+   * \param start the time the frame started on the channel
+   * \param duration the airtime of the frame
+   *
+   * \return the idle time added
+   */
+  Time AddAirtime (FtmAirtime::FrameType type, bool tx, Time start, Time duration);
+
+  /**
+   * Returns the airtime of the FTM frames and ACKs of this session, e.g. in the session over callback.
+   *
+   * \return the airtime
+   */
+  const FtmAirtime & GetAirtime (void) const;
 
   /**
    * Set the default parameters for this session. These are used when no parameters are set.
    *
    * \param params the FtmParams
    */
-  void SetDefaultFtmParams (FtmParams params);
+  void SetDefaultFtmParams (const FtmParams &params);
 
   /**
    * Set the default parameters for this session. These are used when no parameters are set.
@@ -271,6 +360,41 @@ public:
    */
   void SetDefaultFtmParamsHolder (Ptr<FtmParamsHolder> params);
 
+  /**
+   * Creates the dialog for a multi user ranging round. Used by the FtmManager on the responder side, where the
+   * rounds are driven by the manager instead of the session. Marks the session as active.
+   *
+   * \param dialog_token the dialog token of the round
+   */
+  void StartMultiUserDialog (uint8_t dialog_token);
+
+  /**
+   * Returns the time of departure and arrival of a multi user dialog and deletes the dialog.
+   *
+   * \param dialog_token the dialog token of the round
+   * \param tod the time of departure, set if the dialog is complete
+   * \param toa the time of arrival, set if the dialog is complete
+   *
+   * \return true if the dialog is complete, false otherwise
+   */
+  bool TakeMultiUserFollowUp (uint8_t dialog_token, uint64_t &tod, uint64_t &toa);
+
+  /**
+   * Ends a session that was driven by multi user ranging rounds.
+   */
+  void EndMultiUserSession (void);
+
+  /**
+   * Resets the session to the state of a newly constructed one, so that the FtmManager can reuse it for a new
+   * partner. Pending events are canceled, user callbacks and trace sinks are removed, the FtmErrorModel and
+   * the default FtmParams are set back to the values of the attributes at construction. Dialogs are kept
+   * for reuse.
+   */
+  void Reset (void);
+
+protected:
+  virtual void NotifyConstructionCompleted (void);
+
 private:
   Mac48Address m_partner_addr; //!< The partner MAC address.
   SessionType m_session_type; //!< The session type.
@@ -281,6 +405,9 @@ private:
   Ptr<FtmDialog> m_current_dialog;  //!< The current dialog.
   uint8_t m_current_dialog_token;  //!< The current dialog token.
   uint8_t m_previous_dialog_token;  //!< The previous dialog token.
+  FtmResponseFrameTemplate m_response_template; //!< Pre serialized FTM response, only used as responder.
+  uint8_t m_trigger[3]; //!< Pre serialized trigger frame, only used as initiator.
+  bool m_trigger_set; //!< If the trigger frame has been serialized.
   uint32_t m_number_of_bursts_remaining; //!< The remaining bursts.
   uint8_t m_ftms_per_burst_remaining; //!< The remaining FTMs for the current burst.
   uint8_t m_timestamp_set_checks_next_frame; //!< The number of times we checked if the time stamp is set for the next packet.
@@ -304,7 +431,25 @@ private:
 
   bool m_session_over_callback_set; //!< If a session over callback has been specified.
 
+  TracedCallback<Mac48Address, uint8_t> m_dialog_created_trace; //!< Dialog created trace.
+  TracedCallback<Mac48Address, uint8_t, uint8_t, uint64_t> m_timestamp_trace; //!< Time stamp set trace.
+  TracedCallback<Mac48Address, uint8_t, int64_t, int64_t> m_rtt_trace; //!< RTT calculated trace.
+  TracedCallback<Mac48Address, uint8_t> m_dialog_dropped_trace; //!< Dialog dropped trace.
+  TracedCallback<Mac48Address> m_session_accepted_trace; //!< Session accepted trace.
+  TracedCallback<Mac48Address> m_session_denied_trace; //!< Session denied trace.
+  TracedCallback<Mac48Address> m_session_expired_trace; //!< Session expired trace.
+
+  FtmMetrics *m_metrics; //!< The metrics of the manager.
+
+  FtmAirtime m_airtime; //!< The airtime of the frames of this session.
+  Time m_last_frame_end; //!< The end of the last frame of this session on the channel.
+  Time m_burst_start; //!< The start of the first FTM response of the current burst.
+
   Ptr<FtmErrorModel> m_ftm_error_model; //!< The FTM error model.
+  Ptr<FtmErrorModel> m_initial_ftm_error_model; //!< The FTM error model after construction.
+  FtmParams m_initial_default_ftm_params; //!< The default FtmParams after construction.
+
+  std::vector<Ptr<FtmDialog>> m_free_dialogs; //!< Deleted dialogs kept for reuse.
 
   std::list<int64_t> m_rtt_list; //!< The RTT list.
 
@@ -424,7 +569,7 @@ private:
    */
   bool CheckTimeStampEqualZero (Ptr<FtmDialog> dialog);
 
-  Callback<void, Mac48Address, FtmRequestHeader> session_override; //!< The session over ride callback to the manager.
+  Callback<void, Mac48Address, const FtmRequestHeader &> session_override; //!< The session over ride callback to the manager.
 
   /**
    * Even number of callbacks break the code following declaration, odd number works. So this code fix callback